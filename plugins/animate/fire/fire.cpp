@@ -107,6 +107,11 @@ class fire_node_t : public wf::scene::floating_inner_node_t
         wf::scene::damage_callback push_damage,
         wf::output_t *output = nullptr) override;
 
+    bool depends_on_whole_scene() const override
+    {
+        return false;
+    }
+
     wf::geometry_t get_bounding_box() override
     {
         static constexpr int left_border   = 200;
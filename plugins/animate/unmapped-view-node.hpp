@@ -38,6 +38,11 @@ class unmapped_view_snapshot_node : public wf::scene::node_t
         instances.push_back(std::make_unique<rinstance_t>(this, push_damage, shown_on));
     }
 
+    bool depends_on_whole_scene() const override
+    {
+        return false;
+    }
+
     std::string stringify() const override
     {
         return "unmapped-view-snapshot-node " + this->stringify_flags();
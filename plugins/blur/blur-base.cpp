@@ -104,7 +104,9 @@ void wf_blur_base::render_iteration(wf::region_t blur_region,
     width  = std::max(width, 1);
     height = std::max(height, 1);
 
-    out.allocate({width, height});
+    out.allocate({width, height}, 1.0, wf::buffer_allocation_hints_t{
+        .owner = "blur",
+    });
 
     GLuint tex_id = wf::gles_texture_t::from_aux(in).tex_id;
 
@@ -164,7 +166,9 @@ wlr_box wf_blur_base::copy_region(wf::auxilliary_buffer_t& result,
     subbox = sanitize(subbox, degrade_opt, source_box);
     int degraded_width  = subbox.width / degrade_opt;
     int degraded_height = subbox.height / degrade_opt;
-    result.allocate({degraded_width, degraded_height});
+    result.allocate({degraded_width, degraded_height}, 1.0, wf::buffer_allocation_hints_t{
+        .owner = "blur",
+    });
 
     GLuint src_fb = wf::gles::ensure_render_buffer_fb_id(source);
     GLuint dst_fb = wf::gles::ensure_render_buffer_fb_id(result.get_renderbuffer());
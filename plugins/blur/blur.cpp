@@ -174,7 +174,7 @@ class blur_render_instance_t : public transformer_render_instance_t<blur_node_t>
         // Nodes below should re-render the padded areas so that we can sample from them
         damage |= padded_region;
 
-        saved_pixels->pixels.allocate(target.get_size());
+        saved_pixels->pixels.allocate(target.get_size(), 1.0, wf::buffer_allocation_hints_t{.owner = "blur"});
 
         wf::gles::run_in_context_if_gles([&]
         {
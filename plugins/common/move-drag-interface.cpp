@@ -176,6 +176,12 @@ class dragged_view_node_t : public wf::scene::node_t
             std::dynamic_pointer_cast<dragged_view_node_t>(shared_from_this()), push_damage, output));
     }
 
+    bool depends_on_whole_scene() const override
+    {
+        // The dragged views are rendered from their own subtrees, which are not below this node.
+        return true;
+    }
+
     wf::geometry_t get_bounding_box() override
     {
         wf::region_t bounding;
@@ -29,6 +29,11 @@ class simple_text_node_t : public wf::scene::node_t
         instances.push_back(std::make_unique<render_instance_t>(this, push_damage, output));
     }
 
+    bool depends_on_whole_scene() const override
+    {
+        return false;
+    }
+
     wf::geometry_t get_bounding_box() override
     {
         return wf::construct_box(position, size.value_or(cr_text.get_size()));
@@ -159,7 +159,8 @@ class workspace_wall_t::workspace_wall_node_t : public scene::node_t
                         wf::render_target_t aux{self->aux_buffers[i][j]};
                         aux.subbuffer = self->aux_buffer_current_subbox[i][j];
                         aux.geometry  = self->workspaces[i][j]->get_bounding_box();
-                        aux.scale     = self->wall->output->handle->scale;
+                        aux.scale     = self->wall->output->handle->scale *
+                            self->aux_buffers[i][j].get_allocation_scale();
 
                         render_pass_params_t params;
                         params.instances = &instances[i][j];
@@ -259,6 +260,8 @@ class workspace_wall_t::workspace_wall_node_t : public scene::node_t
                 aux_buffers[i][j].allocate(wf::dimensions(bbox), wall->output->handle->scale,
                     wf::buffer_allocation_hints_t{
                         .needs_alpha = false,
+                        .owner = "workspace-wall",
+                        .allow_downscale = true,
                     });
                 aux_buffer_damage[i][j] |= bbox;
                 aux_buffer_current_scale[i][j]  = 1.0;
@@ -290,6 +293,12 @@ class workspace_wall_t::workspace_wall_node_t : public scene::node_t
         return wall->output->get_layout_geometry();
     }
 
+    bool depends_on_whole_scene() const override
+    {
+        // The workspace streams show the views on the output.
+        return true;
+    }
+
   private:
     workspace_wall_t *wall;
     std::vector<std::vector<std::shared_ptr<workspace_stream_node_t>>> workspaces;
@@ -102,11 +102,14 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
                 {
                     const float scale = self->cube->output->handle->scale;
                     auto bbox = self->workspaces[i]->get_bounding_box();
-                    framebuffers[i].allocate(wf::dimensions(bbox), scale);
+                    framebuffers[i].allocate(wf::dimensions(bbox), scale, wf::buffer_allocation_hints_t{
+                        .owner = "cube",
+                        .allow_downscale = true,
+                    });
 
                     wf::render_target_t target{framebuffers[i]};
                     target.geometry = self->workspaces[i]->get_bounding_box();
-                    target.scale    = self->cube->output->handle->scale;
+                    target.scale    = scale * framebuffers[i].get_allocation_scale();
 
                     wf::render_pass_params_t params;
                     params.instances = &ws_instances[i];
@@ -169,6 +172,11 @@ class wayfire_cube : public wf::per_output_plugin_instance_t, public wf::pointer
             return cube->output->get_layout_geometry();
         }
 
+        bool depends_on_whole_scene() const override
+        {
+            return true;
+        }
+
       private:
         std::vector<std::shared_ptr<wf::workspace_stream_node_t>> workspaces;
         wayfire_cube *cube;
@@ -209,6 +209,11 @@ class simple_decoration_node_t : public wf::scene::node_t, public wf::pointer_in
         instances.push_back(std::make_unique<decoration_render_instance_t>(this, push_damage));
     }
 
+    bool depends_on_whole_scene() const override
+    {
+        return false;
+    }
+
     wf::geometry_t get_bounding_box() override
     {
         return wf::construct_box(get_offset(), size);
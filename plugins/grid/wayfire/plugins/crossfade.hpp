@@ -50,11 +50,14 @@ class crossfade_node_t : public scene::view_2d_transformer_t
         const wf::geometry_t bbox = root_node->get_bounding_box();
         const wf::geometry_t g    = view->get_geometry();
         const float scale = view->get_output()->handle->scale;
-        original_buffer.allocate(wf::dimensions(g), scale);
+        original_buffer.allocate(wf::dimensions(g), scale, wf::buffer_allocation_hints_t{
+            .owner = "crossfade",
+            .allow_downscale = true,
+        });
 
         wf::render_target_t target{original_buffer};
         target.geometry = view->get_geometry();
-        target.scale    = view->get_output()->handle->scale;
+        target.scale    = scale * original_buffer.get_allocation_scale();
 
         std::vector<scene::render_instance_uptr> instances;
         root_node->gen_render_instances(instances, [] (auto) {}, view->get_output());
@@ -2,6 +2,9 @@
 
 #include "ipc-rules-common.hpp"
 #include <set>
+#include <optional>
+#include <algorithm>
+#include <wayfire/util.hpp>
 #include "wayfire/plugins/ipc/ipc-method-repository.hpp"
 #include "wayfire/seat.hpp"
 #include <wayfire/per-output-plugin.hpp>
@@ -22,6 +25,8 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
     void fini_events(ipc::method_repository_t *method_repository)
     {
         method_repository->unregister_method("window-rules/events/watch");
+        flush_pending_timer.disconnect();
+        pending_events.clear();
         fini_output_tracking();
     }
 
@@ -38,7 +43,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         wf::json_t data;
         data["event"]  = "output-added";
         data["output"] = output_to_json(output);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], nullptr, output);
     }
 
     void handle_output_removed(wf::output_t *output) override
@@ -46,7 +51,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         wf::json_t data;
         data["event"]  = "output-removed";
         data["output"] = output_to_json(output);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], nullptr, output);
     }
 
     // Template FOO for efficient management of signals: ensure that only actually listened-for signals
@@ -127,9 +132,108 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         {"wset-workspace-changed", get_generic_output_registration_cb(&on_wset_workspace_changed)},
     };
 
+    /**
+     * The events a client has subscribed to, and optional filters narrowing down which views or outputs the
+     * client is interested in. Empty filters match everything.
+     */
+    struct subscription_t
+    {
+        std::set<std::string> events;
+        std::set<uint64_t> view_ids;
+        std::set<std::string> app_ids;
+        std::set<std::string> output_names;
+        std::set<uint64_t> output_ids;
+
+        /**
+         * Whether high-frequency events (see coalesced_events) for the same view should be merged and sent
+         * at most once per frame.
+         */
+        bool coalesce = false;
+
+        bool matches(const std::string& event_name, wayfire_view view, wf::output_t *output) const
+        {
+            if (!events.empty() && !events.count(event_name))
+            {
+                return false;
+            }
+
+            if (view)
+            {
+                output = view->get_output();
+                if (!view_ids.empty() && !view_ids.count(view->get_id()))
+                {
+                    return false;
+                }
+
+                if (!app_ids.empty() && !app_ids.count(view->get_app_id()))
+                {
+                    return false;
+                }
+            }
+
+            if (!output_names.empty() || !output_ids.empty())
+            {
+                if (!output)
+                {
+                    // Views without an output are not on any of the requested outputs.
+                    return !view;
+                }
+
+                return output_names.count(output->to_string()) || output_ids.count(output->get_id());
+            }
+
+            return true;
+        }
+    };
+
     // Track a list of clients which have requested watch
-    std::map<wf::ipc::client_interface_t*, std::set<std::string>> clients;
+    std::map<wf::ipc::client_interface_t*, subscription_t> clients;
+
+    /**
+     * Events which may be sent very often (for example, while a view is being moved interactively), and for
+     * which only the latest state is interesting. Clients which requested coalescing receive these events at
+     * most once per frame per view.
+     */
+    const std::set<std::string> coalesced_events = {
+        "view-geometry-changed",
+        "view-title-changed",
+        "view-app-id-changed",
+    };
+
+    template<class T, class Parse>
+    static std::optional<std::string> parse_filter(const wf::json_t& data, const char *key,
+        std::set<T>& result, Parse parse)
+    {
+        if (!data.has_member(key))
+        {
+            return {};
+        }
+
+        if (!data[key].is_array())
+        {
+            return std::string("Filter \"") + key + "\" is not an array!";
+        }
+
+        for (size_t i = 0; i < data[key].size(); i++)
+        {
+            if (!parse(data[key][i], result))
+            {
+                return std::string("Filter \"") + key + "\" contains invalid entries!";
+            }
+        }
 
+        return {};
+    }
+
+    /**
+     * Subscribe the client to events. All parameters are optional:
+     * - events: the list of events to subscribe to, by default all events.
+     * - view-ids, app-ids: only send events about views with the given ids or app-ids.
+     * - outputs: only send events about views on or outputs with the given names or ids.
+     * - coalesce: merge high-frequency events for the same view and send them at most once per frame.
+     *
+     * Calling watch again replaces the previous subscription of the client.
+     */
     wf::ipc::method_callback_full on_client_watch =
         [=] (wf::json_t data, wf::ipc::client_interface_t *client)
     {
@@ -139,7 +243,8 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
             return wf::ipc::json_error("Event list is not an array!");
         }
 
-        std::set<std::string> subscribed_to;
+        subscription_t subscription;
+        std::set<std::string>& subscribed_to = subscription.events;
         if (data.has_member(EVENTS))
         {
             for (size_t i = 0; i < data[EVENTS].size(); i++)
@@ -166,42 +271,241 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
             }
         }
 
+        auto parse_id = [] (const wf::json_reference_t& entry, std::set<uint64_t>& result)
+        {
+            if (!entry.is_uint64())
+            {
+                return false;
+            }
+
+            result.insert(entry.as_uint64());
+            return true;
+        };
+
+        auto parse_string = [] (const wf::json_reference_t& entry, std::set<std::string>& result)
+        {
+            if (!entry.is_string())
+            {
+                return false;
+            }
+
+            result.insert(entry.as_string());
+            return true;
+        };
+
+        auto parse_output = [&] (const wf::json_reference_t& entry, std::set<std::string>& names)
+        {
+            return parse_string(entry, names) || parse_id(entry, subscription.output_ids);
+        };
+
+        for (auto error : {
+            parse_filter(data, "view-ids", subscription.view_ids, parse_id),
+            parse_filter(data, "app-ids", subscription.app_ids, parse_string),
+            parse_filter(data, "outputs", subscription.output_names, parse_output),
+        })
+        {
+            if (error)
+            {
+                return wf::ipc::json_error(*error);
+            }
+        }
+
+        if (data.has_member("coalesce"))
+        {
+            if (!data["coalesce"].is_bool())
+            {
+                return wf::ipc::json_error("\"coalesce\" is not a boolean!");
+            }
+
+            subscription.coalesce = data["coalesce"].as_bool();
+        }
+
         for (auto& ev_name : subscribed_to)
         {
             signal_map[ev_name].increase_count();
         }
 
-        clients[client] = subscribed_to;
+        if (clients.count(client))
+        {
+            // The client is changing its subscription
+            for (auto& ev_name : clients[client].events)
+            {
+                signal_map[ev_name].decrease_count();
+            }
+        }
+
+        clients[client] = std::move(subscription);
         return wf::ipc::json_ok();
     };
 
     wf::signal::connection_t<wf::ipc::client_disconnected_signal> on_client_disconnected =
         [=] (wf::ipc::client_disconnected_signal *ev)
     {
-        for (auto& ev_name : clients[ev->client])
+        for (auto& ev_name : clients[ev->client].events)
         {
             signal_map[ev_name].decrease_count();
         }
 
         clients.erase(ev->client);
+        for (auto& pending : pending_events)
+        {
+            pending.clients.erase(ev->client);
+        }
     };
 
+    /**
+     * A coalesced event which has not been sent yet.
+     */
+    struct pending_event_t
+    {
+        std::string key;
+        wf::json_t data;
+        std::set<wf::ipc::client_interface_t*> clients;
+    };
+
+    /** Pending coalesced events, in the order in which they first occurred. */
+    std::vector<pending_event_t> pending_events;
+    wf::wl_timer<false> flush_pending_timer;
+
+    /**
+     * Coalesced events are sent at most once per frame of the fastest output.
+     */
+    uint32_t get_coalesce_interval()
+    {
+        int max_refresh_mhz = 0;
+        for (auto& wo : wf::get_core().output_layout->get_outputs())
+        {
+            max_refresh_mhz = std::max(max_refresh_mhz, wo->handle->refresh);
+        }
+
+        return max_refresh_mhz > 0 ? std::max(1, 1'000'000 / max_refresh_mhz) : 16;
+    }
+
+    void flush_pending_events()
+    {
+        flush_pending_timer.disconnect();
+        auto events = std::move(pending_events);
+        pending_events.clear();
+        for (auto& pending : events)
+        {
+            if (pending.clients.empty())
+            {
+                continue;
+            }
+
+            const std::string serialized = pending.data.serialize();
+            for (auto& client : pending.clients)
+            {
+                client->send_serialized(serialized, pending.key);
+            }
+        }
+    }
+
+    void coalesce_event(const wf::json_t& data, const std::string& key,
+        std::set<wf::ipc::client_interface_t*> targets)
+    {
+        auto it = std::find_if(pending_events.begin(), pending_events.end(),
+            [&] (const pending_event_t& pending) { return pending.key == key; });
+
+        if (it == pending_events.end())
+        {
+            pending_events.push_back({key, data, std::move(targets)});
+            if (!flush_pending_timer.is_connected())
+            {
+                flush_pending_timer.set_timeout(get_coalesce_interval(), [=] () { flush_pending_events(); });
+            }
+
+            return;
+        }
+
+        // The merged event describes the change from the first old state to the latest state.
+        wf::json_t merged = data;
+        if (it->data.has_member("old-geometry"))
+        {
+            merged["old-geometry"] = it->data["old-geometry"];
+        }
+
+        it->data = std::move(merged);
+        it->clients.insert(targets.begin(), targets.end());
+    }
+
+    /**
+     * Check whether any client wants to receive the given event, so that the event data does not need to be
+     * generated if it would be discarded anyway.
+     */
+    bool has_subscribers(const std::string& event_name, wayfire_view view, wf::output_t *output = nullptr)
+    {
+        return std::any_of(clients.begin(), clients.end(), [&] (const auto& entry)
+        {
+            return entry.second.matches(event_name, view, output);
+        });
+    }
+
     void send_view_to_subscribes(wayfire_view view, std::string event_name)
     {
+        if (!has_subscribers(event_name, view))
+        {
+            return;
+        }
+
         wf::json_t event;
         event["event"] = event_name;
         event["view"]  = view_to_json(view);
-        send_event_to_subscribes(event, event_name);
+        send_event_to_subscribes(event, event_name, view);
     }
 
-    void send_event_to_subscribes(const wf::json_t& data, const std::string& event_name)
+    /**
+     * Send an event to all clients which subscribed to it.
+     *
+     * @param view The view the event is about, used for filtering and coalescing.
+     * @param output The output the event is about, used for filtering if there is no view.
+     */
+    void send_event_to_subscribes(const wf::json_t& data, const std::string& event_name,
+        wayfire_view view = nullptr, wf::output_t *output = nullptr)
     {
-        for (auto& [client, events] : clients)
+        const bool can_coalesce = view && coalesced_events.count(event_name);
+        if (!can_coalesce && !pending_events.empty())
+        {
+            // Keep the order of events: coalesced events must not be overtaken by later events.
+            flush_pending_events();
+        }
+
+        // The same key is used by the IPC server when the client's send queue overflows.
+        std::string key = wf::ipc::get_event_coalesce_key(event_name);
+        if (view)
         {
-            if (events.empty() || events.count(event_name))
+            key = wf::ipc::get_event_coalesce_key(event_name, "view", view->get_id());
+        } else if (output)
+        {
+            key = wf::ipc::get_event_coalesce_key(event_name, "output", output->get_id());
+        }
+
+        std::set<wf::ipc::client_interface_t*> coalescing_clients;
+        std::optional<std::string> serialized;
+        for (auto& [client, subscription] : clients)
+        {
+            if (!subscription.matches(event_name, view, output))
+            {
+                continue;
+            }
+
+            if (can_coalesce && subscription.coalesce)
+            {
+                coalescing_clients.insert(client);
+                continue;
+            }
+
+            if (!serialized)
             {
-                client->send_json(data);
+                serialized = data.serialize();
             }
+
+            client->send_serialized(*serialized, key);
+        }
+
+        if (!coalescing_clients.empty())
+        {
+            coalesce_event(data, key, std::move(coalescing_clients));
         }
     }
 
@@ -222,17 +526,22 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         data["event"]  = "view-set-output";
         data["output"] = output_to_json(ev->output);
         data["view"]   = view_to_json(ev->view);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], ev->view);
     };
 
     wf::signal::connection_t<wf::view_geometry_changed_signal> on_view_geometry_changed =
         [=] (wf::view_geometry_changed_signal *ev)
     {
+        if (!has_subscribers("view-geometry-changed", ev->view))
+        {
+            return;
+        }
+
         wf::json_t data;
         data["event"] = "view-geometry-changed";
         data["old-geometry"] = wf::ipc::geometry_to_json(ev->old_geometry);
         data["view"] = view_to_json(ev->view);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], ev->view);
     };
 
     wf::signal::connection_t<wf::view_moved_to_wset_signal> on_view_moved_to_wset =
@@ -243,7 +552,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         data["old-wset"] = wset_to_json(ev->old_wset.get());
         data["new-wset"] = wset_to_json(ev->new_wset.get());
         data["view"]     = view_to_json(ev->view);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], ev->view);
     };
 
     wf::signal::connection_t<wf::keyboard_focus_changed_signal> on_kbfocus_changed =
@@ -260,7 +569,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         data["old-edges"] = ev->old_edges;
         data["new-edges"] = ev->new_edges;
         data["view"] = view_to_json(ev->view);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], ev->view);
     };
 
     // Minimized rule handler.
@@ -289,7 +598,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         data["from"]  = wf::ipc::point_to_json(ev->from);
         data["to"]    = wf::ipc::point_to_json(ev->to);
         data["view"]  = view_to_json(ev->view);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], ev->view);
     };
 
     wf::signal::connection_t<wf::view_title_changed_signal> on_title_changed =
@@ -313,7 +622,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         data["state"]  = ev->activated;
         data["output"] = ev->output ? (int)ev->output->get_id() : -1;
         data["output-data"] = output_to_json(ev->output);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], nullptr, ev->output);
     };
 
     wf::signal::connection_t<wf::output_gain_focus_signal> on_output_gain_focus =
@@ -322,7 +631,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         wf::json_t data;
         data["event"]  = "output-gain-focus";
         data["output"] = output_to_json(ev->output);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], nullptr, ev->output);
     };
 
     wf::signal::connection_t<wf::input_event_signal<mwlr_keyboard_modifiers_event>> on_keyboard_modifiers =
@@ -350,7 +659,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         data["output"]   = ev->output ? (int)ev->output->get_id() : -1;
         data["new-wset-data"] = wset_to_json(ev->new_wset.get());
         data["output-data"]   = output_to_json(ev->output);
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], nullptr, ev->output);
     };
 
     wf::signal::connection_t<wf::workspace_changed_signal> on_wset_workspace_changed =
@@ -365,7 +674,7 @@ class ipc_rules_events_methods_t : public wf::per_output_tracker_mixin_t<>
         data["output-data"] = output_to_json(ev->output);
         data["wset-data"]   =
             ev->output ? wset_to_json(ev->output->wset().get()) : json_t::null();
-        send_event_to_subscribes(data, data["event"]);
+        send_event_to_subscribes(data, data["event"], nullptr, ev->output);
     };
 };
 }
@@ -66,7 +66,7 @@ class ipc_rules_t : public wf::plugin_interface_t,
     wf::ipc::method_callback list_views = [=] (wf::json_t)
     {
         wf::json_t response = wf::json_t::array();
-        for (auto& view : wf::get_core().get_all_views())
+        for (auto& view : wf::get_core().get_all_views_range())
         {
             wf::json_t v = view_to_json(view);
             response.append(v);
@@ -231,7 +231,7 @@ class ipc_rules_t : public wf::plugin_interface_t,
     wf::ipc::method_callback list_wsets = [=] (wf::json_t)
     {
         wf::json_t response = wf::json_t::array();
-        for (auto& workspace_set : wf::workspace_set_t::get_all())
+        for (auto& workspace_set : wf::tracking_allocator_t<wf::workspace_set_t>::get().get_range())
         {
             response.append(wset_to_json(workspace_set.get()));
         }
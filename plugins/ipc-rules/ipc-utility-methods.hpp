@@ -4,10 +4,16 @@
 #include "wayfire/plugins/ipc/ipc-method-repository.hpp"
 #include "wayfire/debug.hpp"
 #include "wayfire/signal-definitions.hpp"
+#include <map>
 #include <set>
+#include <wayfire/frame-profiler.hpp>
+#include <wayfire/render-manager.hpp>
 #include <wayfire/plugin.hpp>
 #include <wayfire/nonstd/wlroots-full.hpp>
 #include <wayfire/output-layout.hpp>
+#include <wayfire/seat.hpp>
+#include <wayfire/toplevel-view.hpp>
+#include <wayfire/txn/transaction-object.hpp>
 #include <wayfire/config/compound-option.hpp>
 #include <wayfire/config/config-manager.hpp>
 
@@ -34,6 +40,13 @@ class ipc_rules_utility_methods_t
         method_repository->register_method("wayfire/set-config-options", set_config_options);
         method_repository->register_method("wayfire/get-keyboard-state", get_kb_state);
         method_repository->register_method("wayfire/set-keyboard-state", set_kb_state);
+        method_repository->register_method("wayfire/frame-profiler/set-enabled", set_profiler_enabled);
+        method_repository->register_method("wayfire/frame-profiler/get-frames", get_profiler_frames);
+        method_repository->register_method("wayfire/frame-profiler/chrome-trace", get_profiler_trace);
+        method_repository->register_method("wayfire/transaction-stats", get_transaction_stats);
+        method_repository->register_method("wayfire/pointer-motion-stats", get_pointer_motion_stats);
+        method_repository->register_method("wayfire/buffer-pool-stats", get_buffer_pool_stats);
+        method_repository->register_method("wayfire/buffer-memory", get_buffer_memory);
     }
 
     void fini_utility_methods(ipc::method_repository_t *method_repository)
@@ -45,6 +58,13 @@ class ipc_rules_utility_methods_t
         method_repository->unregister_method("wayfire/set-config-option");
         method_repository->unregister_method("wayfire/get-keyboard-state");
         method_repository->unregister_method("wayfire/set-keyboard-state");
+        method_repository->unregister_method("wayfire/frame-profiler/set-enabled");
+        method_repository->unregister_method("wayfire/frame-profiler/get-frames");
+        method_repository->unregister_method("wayfire/frame-profiler/chrome-trace");
+        method_repository->unregister_method("wayfire/transaction-stats");
+        method_repository->unregister_method("wayfire/pointer-motion-stats");
+        method_repository->unregister_method("wayfire/buffer-pool-stats");
+        method_repository->unregister_method("wayfire/buffer-memory");
     }
 
     wf::ipc::method_callback get_wayfire_configuration_info = [=] (wf::json_t)
@@ -340,5 +360,210 @@ class ipc_rules_utility_methods_t
             keyboard->modifiers.latched, keyboard->modifiers.locked, index);
         return wf::ipc::json_ok();
     };
+
+    /**
+     * Get the outputs selected by the optional `output-id` field, or all outputs if it is missing.
+     */
+    std::vector<wf::output_t*> get_requested_outputs(const wf::json_t& data)
+    {
+        auto output_id = wf::ipc::json_get_optional_uint64(data, "output-id");
+        if (!output_id.has_value())
+        {
+            return wf::get_core().output_layout->get_outputs();
+        }
+
+        auto wo = wf::ipc::find_output_by_id(output_id.value());
+        if (!wo)
+        {
+            throw wf::ipc::ipc_method_exception_t("output not found");
+        }
+
+        return {wo};
+    }
+
+    wf::ipc::method_callback set_profiler_enabled = [=] (const wf::json_t& data) -> json_t
+    {
+        auto enabled = wf::ipc::json_get_bool(data, "enabled");
+        for (auto wo : get_requested_outputs(data))
+        {
+            wo->render->get_frame_profiler().set_enabled(enabled);
+        }
+
+        return wf::ipc::json_ok();
+    };
+
+    wf::ipc::method_callback get_profiler_frames = [=] (const wf::json_t& data) -> json_t
+    {
+        auto count = wf::ipc::json_get_optional_uint64(data, "count").value_or(60);
+        auto response = wf::ipc::json_ok();
+        response["outputs"] = wf::json_t::array();
+        for (auto wo : get_requested_outputs(data))
+        {
+            auto& profiler = wo->render->get_frame_profiler();
+
+            wf::json_t js;
+            js["output"]  = wo->to_string();
+            js["id"]      = wo->get_id();
+            js["enabled"] = profiler.is_enabled();
+            js["skipped-frames"] = profiler.get_num_skipped_frames();
+            js["frames"]  = profiler.frames_to_json(count);
+            response["outputs"].append(js);
+        }
+
+        return response;
+    };
+
+    wf::ipc::method_callback get_profiler_trace = [=] (const wf::json_t& data) -> json_t
+    {
+        auto count = wf::ipc::json_get_optional_uint64(data, "count").value_or(60);
+        wf::json_t events = wf::json_t::array();
+        for (auto wo : get_requested_outputs(data))
+        {
+            wo->render->get_frame_profiler().append_chrome_trace_events(events, count);
+        }
+
+        wf::json_t trace;
+        trace["displayTimeUnit"] = "ms";
+        trace["traceEvents"] = events;
+
+        auto response = wf::ipc::json_ok();
+        response["trace"] = trace;
+        return response;
+    };
+
+    /**
+     * Report how fast the toplevels of each view and client become ready in transactions, in order to find
+     * out which clients hold up layout changes.
+     */
+    wf::ipc::method_callback get_transaction_stats = [=] (const wf::json_t&) -> json_t
+    {
+        static wf::option_wrapper_t<int> slow_client_timeouts{"core/transaction_slow_client_timeouts"};
+        const uint32_t threshold = std::max(0, (int)slow_client_timeouts);
+
+        struct client_stats_t
+        {
+            wf::json_t views = wf::json_t::array();
+            uint64_t commits  = 0;
+            uint64_t timeouts = 0;
+            uint64_t skipped  = 0;
+            int64_t max_latency_us = 0;
+            bool slow = false;
+        };
+
+        std::map<pid_t, client_stats_t> clients;
+        auto response = wf::ipc::json_ok();
+        response["views"] = wf::json_t::array();
+        for (auto& view : wf::get_core().get_all_views_range())
+        {
+            auto toplevel = wf::toplevel_cast(view);
+            if (!toplevel)
+            {
+                continue;
+            }
+
+            const auto& stats = toplevel->toplevel()->get_readiness_stats();
+            const pid_t pid   = get_view_pid(view);
+
+            wf::json_t js;
+            js["id"]     = view->get_id();
+            js["pid"]    = pid;
+            js["app-id"] = view->get_app_id();
+            js["commits"]  = stats.commits;
+            js["timeouts"] = stats.timeouts;
+            js["consecutive-timeouts"] = stats.consecutive_timeouts;
+            js["skipped"] = stats.skipped;
+            js["last-latency-us"]    = stats.last_latency_us;
+            js["average-latency-us"] = stats.average_latency_us;
+            js["max-latency-us"] = stats.max_latency_us;
+            js["slow"] = stats.is_slow(threshold);
+            response["views"].append(js);
+
+            auto& client = clients[pid];
+            client.views.append(view->get_id());
+            client.commits  += stats.commits;
+            client.timeouts += stats.timeouts;
+            client.skipped  += stats.skipped;
+            client.max_latency_us = std::max(client.max_latency_us, stats.max_latency_us);
+            client.slow |= stats.is_slow(threshold);
+        }
+
+        response["clients"] = wf::json_t::array();
+        for (auto& [pid, client] : clients)
+        {
+            wf::json_t js;
+            js["pid"]   = pid;
+            js["views"] = client.views;
+            js["commits"]  = client.commits;
+            js["timeouts"] = client.timeouts;
+            js["skipped"]  = client.skipped;
+            js["max-latency-us"] = client.max_latency_us;
+            js["slow"] = client.slow;
+            response["clients"].append(js);
+        }
+
+        return response;
+    };
+
+    /**
+     * Report how many pointer motion events were received and how often they caused a focus update, see the
+     * input/pointer_motion_coalescing option.
+     */
+    wf::ipc::method_callback get_pointer_motion_stats = [=] (const wf::json_t&) -> json_t
+    {
+        const auto stats = wf::get_core().seat->get_pointer_motion_stats();
+        auto response    = wf::ipc::json_ok();
+        response["motion-events"]    = stats.motion_events;
+        response["coalesced-events"] = stats.coalesced_events;
+        response["focus-updates"]    = stats.focus_updates;
+        return response;
+    };
+
+    wf::ipc::method_callback get_buffer_pool_stats = [=] (const wf::json_t&) -> json_t
+    {
+        const auto stats = wf::get_aux_buffer_pool_stats();
+        auto response    = wf::ipc::json_ok();
+        response["hits"]      = stats.hits;
+        response["misses"]    = stats.misses;
+        response["evictions"] = stats.evictions;
+        response["pooled-buffers"] = stats.pooled_buffers;
+        response["pooled-bytes"]   = stats.pooled_bytes;
+        response["budget-bytes"]   = stats.budget_bytes;
+        return response;
+    };
+
+    wf::ipc::method_callback get_buffer_memory = [=] (const wf::json_t&) -> json_t
+    {
+        const auto stats = wf::get_aux_buffer_memory_stats();
+        std::map<std::string, std::pair<uint64_t, uint64_t>> by_owner;
+        auto response = wf::ipc::json_ok();
+        response["buffers"] = wf::json_t::array();
+        for (auto& buffer : stats.buffers)
+        {
+            wf::json_t entry;
+            entry["owner"]  = buffer.owner;
+            entry["width"]  = buffer.size.width;
+            entry["height"] = buffer.size.height;
+            entry["bytes"]  = buffer.bytes;
+            response["buffers"].append(entry);
+
+            by_owner[buffer.owner].first++;
+            by_owner[buffer.owner].second += buffer.bytes;
+        }
+
+        response["owners"] = wf::json_t::array();
+        for (auto& [owner, usage] : by_owner)
+        {
+            wf::json_t entry;
+            entry["owner"]   = owner;
+            entry["buffers"] = usage.first;
+            entry["bytes"]   = usage.second;
+            response["owners"].append(entry);
+        }
+
+        response["total-bytes"]  = stats.total_bytes;
+        response["budget-bytes"] = stats.budget_bytes;
+        response["downscaled-allocations"] = stats.downscaled_allocations;
+        return response;
+    };
 };
 }
@@ -4,12 +4,15 @@
 #include <wayfire/util/log.hpp>
 #include <wayfire/core.hpp>
 #include <wayfire/plugin.hpp>
+#include <wayfire/txn/transaction-manager.hpp>
 
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <cstring>
+#include <algorithm>
 
 /**
  * Handle WL_EVENT_READABLE on the socket.
@@ -27,6 +30,11 @@ wf::ipc::server_t::server_t()
     {
         do_accept_new_client();
     };
+
+    method_repository->register_method("batch", [=] (const wf::json_t& data, client_interface_t *client)
+    {
+        return call_batch(data, client);
+    });
 }
 
 void wf::ipc::server_t::init(std::string socket_path)
@@ -45,6 +53,7 @@ void wf::ipc::server_t::init(std::string socket_path)
 
 wf::ipc::server_t::~server_t()
 {
+    method_repository->unregister_method("batch");
     if (fd != -1)
     {
         close(fd);
@@ -131,10 +140,76 @@ void wf::ipc::server_t::client_disappeared(client_t *client)
     clients.erase(it, clients.end());
 }
 
+wf::ipc::overflow_policy_t wf::ipc::server_t::get_overflow_policy()
+{
+    const std::string policy = overflow_policy;
+    if (policy == "coalesce")
+    {
+        return overflow_policy_t::COALESCE;
+    }
+
+    if (policy == "disconnect")
+    {
+        return overflow_policy_t::DISCONNECT;
+    }
+
+    return overflow_policy_t::DROP;
+}
+
+/**
+ * Get the parameters of a method call, or an empty object if the call has none.
+ */
+static wf::json_t get_call_data(const wf::json_reference_t& call)
+{
+    if (call.has_member("data"))
+    {
+        return call["data"];
+    }
+
+    wf::json_t data;
+    wf::json_t::parse_string("{}", data);
+    return data;
+}
+
 void wf::ipc::server_t::handle_incoming_message(
     client_t *client, wf::json_t message)
 {
-    client->send_json(method_repository->call_method(message["method"], message["data"], client));
+    client->send_json(method_repository->call_method(message["method"], get_call_data(message), client));
+}
+
+wf::json_t wf::ipc::server_t::call_batch(const wf::json_t& data, client_interface_t *client)
+{
+    if (!data.has_member("calls") || !data["calls"].is_array())
+    {
+        return json_error("Batch does not contain a list of calls!");
+    }
+
+    wf::json_t results = wf::json_t::array();
+    auto& tx_manager   = wf::get_core().tx_manager;
+    tx_manager->begin_batch();
+    try {
+        for (size_t i = 0; i < data["calls"].size(); i++)
+        {
+            const auto& call = data["calls"][i];
+            if (!call.is_object() || !call.has_member("method") || !call["method"].is_string())
+            {
+                results.append(json_error("Call does not contain a method to be called!"));
+                continue;
+            }
+
+            results.append(method_repository->call_method(call["method"], get_call_data(call), client));
+        }
+    } catch (...)
+    {
+        tx_manager->end_batch();
+        throw;
+    }
+
+    tx_manager->end_batch();
+
+    wf::json_t response;
+    response["results"] = results;
+    return response;
 }
 
 /* --------------------------- Per-client code ------------------------------*/
@@ -147,6 +222,8 @@ int wl_loop_handle_ipc_client_fd_event(int, uint32_t mask, void *data)
 
 static constexpr int MAX_MESSAGE_LEN = (1 << 20);
 static constexpr int HEADER_LEN = 4;
+/** Maximal number of buffers passed to a single sendmsg() call when flushing the send queue. */
+static constexpr int MAX_IOVECS = 64;
 
 wf::ipc::client_t::client_t(server_t *ipc, int fd)
 {
@@ -163,7 +240,16 @@ wf::ipc::client_t::client_t(server_t *ipc, int fd)
     buffer.resize(MAX_MESSAGE_LEN + 1);
     this->handle_fd_activity = [=] (uint32_t event_mask)
     {
-        handle_fd_incoming(event_mask);
+        const bool closed = event_mask & (WL_EVENT_ERROR | WL_EVENT_HANGUP);
+        if ((event_mask & WL_EVENT_WRITABLE) && !closed)
+        {
+            flush_send_queue();
+        }
+
+        if ((event_mask & WL_EVENT_READABLE) || closed)
+        {
+            handle_fd_incoming(event_mask);
+        }
     };
 }
 
@@ -291,49 +377,257 @@ wf::ipc::client_t::~client_t()
     close(this->fd);
 }
 
-static bool write_exact(int fd, const char *buf, ssize_t n)
+/**
+ * Write the given buffers to the socket without blocking.
+ * sendmsg() is used instead of writev() so that a client which went away does not raise SIGPIPE.
+ *
+ * @return The number of bytes written, 0 if the socket buffer is full, or -1 on error.
+ */
+static ssize_t send_iovecs(int fd, iovec *iov, size_t count)
+{
+    msghdr msg{};
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = count;
+    while (true)
+    {
+        ssize_t w = sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (w >= 0)
+        {
+            return w;
+        }
+
+        if (errno == EINTR)
+        {
+            continue;
+        }
+
+        return ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? 0 : -1;
+    }
+}
+
+/**
+ * Events of the same kind about the same view or output supersede each other when coalescing.
+ * Other messages (for example replies to method calls) have an empty key, they are never dropped or
+ * coalesced.
+ */
+static std::string get_coalesce_key(const wf::json_t& json)
 {
-    while (n > 0)
+    if (!json.has_member("event") || !json["event"].is_string())
+    {
+        return "";
+    }
+
+    // Events about a view may also contain its output, the view takes precedence.
+    for (const char *object : {"view", "output"})
     {
-        ssize_t w = write(fd, buf, n);
-        if (w <= 0)
+        if (json.has_member(object) && json[object].is_object() && json[object].has_member("id") &&
+            json[object]["id"].is_uint64())
         {
+            return wf::ipc::get_event_coalesce_key(json["event"].as_string(), object,
+                json[object]["id"].as_uint64());
+        }
+    }
+
+    return wf::ipc::get_event_coalesce_key(json["event"].as_string());
+}
+
+void wf::ipc::client_t::shutdown_connection()
+{
+    // The client will be removed once the HANGUP event arrives.
+    broken = true;
+    send_queue.clear();
+    queued_bytes = 0;
+    update_event_mask();
+    shutdown(fd, SHUT_RDWR);
+}
+
+void wf::ipc::client_t::update_event_mask()
+{
+    const bool want_writable = !send_queue.empty();
+    if (want_writable != writable_requested)
+    {
+        writable_requested = want_writable;
+        wl_event_source_fd_update(source, WL_EVENT_READABLE | (want_writable ? WL_EVENT_WRITABLE : 0));
+    }
+}
+
+bool wf::ipc::client_t::enqueue_message(uint32_t header, std::string payload, size_t sent,
+    std::string coalesce_key)
+{
+    const size_t remaining = HEADER_LEN + payload.size() - sent;
+    const size_t max_bytes = std::max(0, (int)ipc->max_queued_bytes);
+    // A partially sent message must always be queued, otherwise the stream would be corrupted.
+    const bool overflow = (sent == 0) && (queued_bytes + remaining > max_bytes);
+    if (overflow && coalesce_key.empty())
+    {
+        // Dropping a reply would make the client wait forever, and it would match the following replies to
+        // the wrong requests. Replies may exceed the limit, but only up to a point: a client which does not
+        // read the replies to its own requests is disconnected.
+        if ((ipc->get_overflow_policy() == overflow_policy_t::DISCONNECT) ||
+            (queued_bytes + remaining > 2 * max_bytes))
+        {
+            LOGW("IPC client ", this, " is not reading its messages, disconnecting it");
+            shutdown_connection();
             return false;
         }
+    } else if (overflow)
+    {
+        switch (ipc->get_overflow_policy())
+        {
+          case overflow_policy_t::COALESCE:
+            if (!coalesce_key.empty())
+            {
+                auto it = std::find_if(send_queue.rbegin(), send_queue.rend(), [&] (const auto& msg)
+                {
+                    return (msg.sent == 0) && (msg.coalesce_key == coalesce_key);
+                });
+
+                if (it != send_queue.rend())
+                {
+                    queued_bytes += payload.size();
+                    queued_bytes -= it->payload.size();
+                    it->header  = header;
+                    it->payload = std::move(payload);
+                    return true;
+                }
+            }
+
+            LOGD("IPC client ", this, " send queue is full, dropping event");
+            return false;
+
+          case overflow_policy_t::DISCONNECT:
+            LOGW("IPC client ", this, " is not reading its messages, disconnecting it");
+            shutdown_connection();
+            return false;
 
-        n   -= w;
-        buf += w;
+          case overflow_policy_t::DROP:
+            LOGD("IPC client ", this, " send queue is full, dropping event");
+            return false;
+        }
     }
 
+    queued_bytes += remaining;
+    send_queue.push_back({header, std::move(payload), sent, std::move(coalesce_key)});
+    update_event_mask();
     return true;
 }
 
-bool wf::ipc::client_t::send_json(wf::json_t json)
+bool wf::ipc::client_t::flush_send_queue()
 {
-    bool status = false;
-    json.map_serialized([&] (const char *buffer, size_t size)
+    while (!send_queue.empty())
     {
-        if (size > MAX_MESSAGE_LEN)
+        iovec iov[MAX_IOVECS];
+        size_t count = 0;
+        for (auto& msg : send_queue)
         {
-            LOGE("Error sending json to client: message too long!");
-            shutdown(fd, SHUT_RDWR);
-            return;
+            if (count + 2 > MAX_IOVECS)
+            {
+                break;
+            }
+
+            if (msg.sent < HEADER_LEN)
+            {
+                iov[count++] = {(char*)&msg.header + msg.sent, HEADER_LEN - msg.sent};
+            }
+
+            const size_t payload_sent = std::max(msg.sent, (size_t)HEADER_LEN) - HEADER_LEN;
+            iov[count++] = {msg.payload.data() + payload_sent, msg.payload.size() - payload_sent};
         }
 
-        uint32_t len = size;
-        if (!write_exact(fd, (char*)&len, 4) || !write_exact(fd, buffer, len))
+        ssize_t w = send_iovecs(fd, iov, count);
+        if (w < 0)
         {
-            LOGE("Error sending json to client!");
-            shutdown(fd, SHUT_RDWR);
-            return;
+            LOGE("Error sending json to client: ", strerror(errno));
+            shutdown_connection();
+            return false;
+        }
+
+        if (w == 0)
+        {
+            break;
         }
 
-        status = true;
+        size_t written = w;
+        queued_bytes -= written;
+        while (written > 0)
+        {
+            auto& msg = send_queue.front();
+            const size_t remaining = HEADER_LEN + msg.payload.size() - msg.sent;
+            if (written < remaining)
+            {
+                msg.sent += written;
+                break;
+            }
+
+            written -= remaining;
+            send_queue.pop_front();
+        }
+    }
+
+    update_event_mask();
+    return true;
+}
+
+bool wf::ipc::client_t::send_buffer(const char *buffer, size_t size,
+    const std::function<std::string()>& make_coalesce_key)
+{
+    if (broken)
+    {
+        return false;
+    }
+
+    if (size > MAX_MESSAGE_LEN)
+    {
+        LOGE("Error sending json to client: message too long!");
+        shutdown_connection();
+        return false;
+    }
+
+    uint32_t len = size;
+    size_t sent  = 0;
+    if (send_queue.empty())
+    {
+        // Fast path: send the message directly from the serialized buffer, without copying it.
+        iovec iov[2] = {{&len, HEADER_LEN}, {(char*)buffer, size}};
+        ssize_t w    = send_iovecs(fd, iov, 2);
+        if (w < 0)
+        {
+            LOGE("Error sending json to client: ", strerror(errno));
+            shutdown_connection();
+            return false;
+        }
+
+        sent = w;
+        if (sent == HEADER_LEN + size)
+        {
+            return true;
+        }
+    }
+
+    return enqueue_message(len, std::string(buffer, size), sent, make_coalesce_key());
+}
+
+bool wf::ipc::client_t::send_json(wf::json_t json)
+{
+    if (broken)
+    {
+        return false;
+    }
+
+    bool status = false;
+    json.map_serialized([&] (const char *buffer, size_t size)
+    {
+        status = send_buffer(buffer, size, [&] { return get_coalesce_key(json); });
     });
 
     return status;
 }
 
+bool wf::ipc::client_t::send_serialized(std::string_view json, const std::string& coalesce_key)
+{
+    return send_buffer(json.data(), json.size(), [&] { return coalesce_key; });
+}
+
 namespace wf
 {
 class ipc_plugin_t : public wf::plugin_interface_t
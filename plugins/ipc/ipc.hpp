@@ -1,7 +1,10 @@
 #pragma once
 
+#include <deque>
+#include <functional>
 #include <sys/un.h>
 #include <wayfire/object.hpp>
+#include <wayfire/option-wrapper.hpp>
 #include <wayland-server.h>
 #include <wayfire/plugins/common/shared-core-data.hpp>
 #include "wayfire/plugins/ipc/ipc-method-repository.hpp"
@@ -20,12 +23,51 @@ class client_t : public client_interface_t
     client_t(server_t *server, int client_fd);
     ~client_t();
     bool send_json(wf::json_t json) override;
+    bool send_serialized(std::string_view json, const std::string& coalesce_key = "") override;
 
   private:
     int fd;
     wl_event_source *source;
     server_t *ipc;
 
+    /**
+     * A message which could not be (fully) sent yet because the client's socket buffer was full.
+     */
+    struct queued_message_t
+    {
+        uint32_t header;
+        std::string payload;
+        /** Number of bytes (header included) which have already been sent. */
+        size_t sent = 0;
+        /** Messages with the same non-empty key replace each other when the queue is coalesced. */
+        std::string coalesce_key;
+    };
+
+    /**
+     * Messages waiting for the socket to become writable, in the order in which they have to be sent.
+     * The messages are sent in the background, so that a slow client cannot block the compositor.
+     */
+    std::deque<queued_message_t> send_queue;
+    size_t queued_bytes = 0;
+    /** Set once the connection has been shut down, messages are no longer sent to the client. */
+    bool broken = false;
+    bool writable_requested = false;
+
+    /**
+     * Send as many queued messages as possible without blocking.
+     * Returns false if the connection failed.
+     */
+    bool flush_send_queue();
+
+    /**
+     * Send a serialized message, or queue it if the socket is not writable.
+     * The coalesce key is only needed, and so only computed, if the message has to be queued.
+     */
+    bool send_buffer(const char *buffer, size_t size, const std::function<std::string()>& make_coalesce_key);
+    bool enqueue_message(uint32_t header, std::string payload, size_t sent, std::string coalesce_key);
+    void update_event_mask();
+    void shutdown_connection();
+
     int current_buffer_valid = 0;
     std::vector<char> buffer;
     int read_up_to(int n, int *available);
@@ -35,6 +77,20 @@ class client_t : public client_interface_t
     void handle_fd_incoming(uint32_t);
 };
 
+/**
+ * What happens when a client does not read its events and its send queue reaches ipc/max_queued_bytes.
+ * Replies to method calls are never dropped, a client which does not read them is disconnected.
+ */
+enum class overflow_policy_t
+{
+    /** New events are dropped until the queue drains. */
+    DROP,
+    /** Events replace older queued events of the same kind; other events are dropped. */
+    COALESCE,
+    /** The client is disconnected. */
+    DISCONNECT,
+};
+
 /**
  * The IPC server is a singleton object accessed via shared_data::ref_ptr_t.
  * It represents the IPC socket used for communication with clients.
@@ -52,6 +108,19 @@ class server_t
 
     void handle_incoming_message(client_t *client, wf::json_t message);
 
+    /**
+     * Execute a list of method calls, given as {"calls": [{"method": ..., "data": ...}, ...]}, in order, and
+     * return their results as {"results": [...]}.
+     *
+     * All transactions scheduled by the calls are merged into a single transaction, so that for example a
+     * layout configured with several window-rules/configure-view calls is applied atomically.
+     */
+    wf::json_t call_batch(const wf::json_t& data, client_interface_t *client);
+
+    wf::option_wrapper_t<int> max_queued_bytes{"ipc/max_queued_bytes"};
+    wf::option_wrapper_t<std::string> overflow_policy{"ipc/overflow_policy"};
+    overflow_policy_t get_overflow_policy();
+
     void client_disappeared(client_t *client);
 
     int fd = -1;
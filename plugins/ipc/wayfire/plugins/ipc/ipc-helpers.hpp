@@ -57,7 +57,7 @@ WFJSON_GETTER_FUNCTION(bool, bool);
 
 inline wayfire_view find_view_by_id(uint32_t id)
 {
-    for (auto view : wf::get_core().get_all_views())
+    for (auto& view : wf::get_core().get_all_views_range())
     {
         if (view->get_id() == id)
         {
@@ -83,7 +83,7 @@ inline wf::output_t *find_output_by_id(int32_t id)
 
 inline wf::workspace_set_t *find_workspace_set_by_index(int32_t index)
 {
-    for (auto wset : wf::workspace_set_t::get_all())
+    for (auto& wset : wf::tracking_allocator_t<wf::workspace_set_t>::get().get_range())
     {
         if ((int)wset->get_index() == index)
         {
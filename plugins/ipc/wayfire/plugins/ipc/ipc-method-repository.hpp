@@ -22,6 +22,24 @@ class ipc_method_exception_t : public std::exception
     }
 };
 
+/**
+ * Get the key under which queued events are coalesced, see client_interface_t::send_serialized().
+ * Events of the same kind about the same object share a key.
+ *
+ * @param object The kind of object the event is about ("view" or "output"), or nullptr if there is none.
+ * @param id The id of the object.
+ */
+inline std::string get_event_coalesce_key(const std::string& event, const char *object = nullptr,
+    uint64_t id = 0)
+{
+    if (!object)
+    {
+        return event;
+    }
+
+    return event + "/" + object + "/" + std::to_string(id);
+}
+
 /**
  * A client_interface_t represents a client which has connected to the IPC socket.
  * It can be used by plugins to send back data to a specific client.
@@ -30,6 +48,26 @@ class client_interface_t
 {
   public:
     virtual bool send_json(json_t json) = 0;
+
+    /**
+     * Send an already serialized JSON message. This allows sending the same message to many clients while
+     * serializing it only once.
+     *
+     * @param coalesce_key If not empty, a message which the client has not received yet may be replaced by a
+     *   newer message with the same key when the client is not reading fast enough. Events should always
+     *   pass a key: messages without one are treated like replies to method calls, which are never dropped.
+     */
+    virtual bool send_serialized(std::string_view json, const std::string& coalesce_key = "")
+    {
+        json_t parsed;
+        if (json_t::parse_string(json, parsed).has_value())
+        {
+            return false;
+        }
+
+        return send_json(std::move(parsed));
+    }
+
     virtual ~client_interface_t() = default;
 };
 
@@ -52,6 +90,21 @@ using method_callback = std::function<json_t(json_t)>;
  */
 using method_callback_full = std::function<wf::json_t(json_t, client_interface_t*)>;
 
+// A few helper definitions for IPC method implementations.
+inline wf::json_t json_ok()
+{
+    wf::json_t r;
+    r["result"] = "ok";
+    return r;
+}
+
+inline wf::json_t json_error(std::string msg)
+{
+    wf::json_t r;
+    r["error"] = msg;
+    return r;
+}
+
 /**
  * The IPC method repository keeps track of all registered IPC methods. It can be used even without the IPC
  * plugin itself, as it facilitates inter-plugin calls similarly to signals.
@@ -134,20 +187,5 @@ class method_repository_t : public wf::signal::provider_t
   private:
     std::map<std::string, method_callback_full> methods;
 };
-
-// A few helper definitions for IPC method implementations.
-inline wf::json_t json_ok()
-{
-    wf::json_t r;
-    r["result"] = "ok";
-    return r;
-}
-
-inline wf::json_t json_error(std::string msg)
-{
-    wf::json_t r;
-    r["error"] = msg;
-    return r;
-}
 }
 }
@@ -263,11 +263,14 @@ class title_overlay_node_t : public node_t
         std::vector<render_instance_uptr>& instances,
         damage_callback push_damage, wf::output_t *output) override;
 
+    bool depends_on_whole_scene() const override
+    {
+        return false;
+    }
+
     void do_push_damage(wf::region_t updated_region)
     {
-        node_damage_signal ev;
-        ev.region = updated_region;
-        this->emit(&ev);
+        wf::scene::damage_node(this, updated_region);
     }
 
     std::string stringify() const override
@@ -87,7 +87,7 @@ class wayfire_invert_screen : public wf::per_output_plugin_instance_t
                 output->render->rem_post(&hook);
             } else
             {
-                output->render->add_post(&hook);
+                output->render->add_post(&hook, wf::POST_HOOK_POINTWISE);
             }
 
             active = !active;
@@ -130,8 +130,15 @@ class wayfire_invert_screen : public wf::per_output_plugin_instance_t
             program.attrib_pointer("uvPosition", 2, 0, coordData);
             program.uniform1i("preserve_hue", preserve_hue);
 
+            // Each pixel is inverted on its own, so only the damaged parts need to be redrawn.
             GL_CALL(glDisable(GL_BLEND));
-            GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
+            for (const auto& box : output->render->get_swap_damage())
+            {
+                wf::gles::scissor_render_buffer(destination, wlr_box_from_pixman_box(box));
+                GL_CALL(glDrawArrays(GL_TRIANGLE_FAN, 0, 4));
+            }
+
+            GL_CALL(glDisable(GL_SCISSOR_TEST));
             GL_CALL(glEnable(GL_BLEND));
             GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
 
@@ -20,7 +20,7 @@ class wayfire_passthrough_screen : public wf::per_output_plugin_instance_t
             return;
         }
 
-        output->render->add_post(&render_hook);
+        output->render->add_post(&render_hook, wf::POST_HOOK_POINTWISE);
 
         vk_renderer = wlr_vk_renderer_create_with_drm_fd(wlr_renderer_get_drm_fd(wf::get_core().renderer));
     }
@@ -57,13 +57,15 @@ class wayfire_passthrough_screen : public wf::per_output_plugin_instance_t
         wlr_render_texture_options tex{};
         tex.texture    = vk_tex; // Use the source texture
         tex.blend_mode = WLR_RENDER_BLEND_MODE_NONE;
-        // Copy the entire source buffer to the entire destination buffer
+        // Copy the source buffer to the destination buffer. The color transform is applied to each pixel on
+        // its own, so only the damaged parts need to be copied.
+        wf::region_t damage = output->render->get_swap_damage();
         tex.src_box     = {0.0, 0.0, (double)source.get_size().width, (double)source.get_size().height};
         tex.dst_box     = {0, 0, w, h};
         tex.filter_mode = WLR_SCALE_FILTER_BILINEAR; // Use bilinear filtering for a smooth copy
         tex.transform   = WL_OUTPUT_TRANSFORM_NORMAL;
         tex.alpha = NULL;
-        tex.clip  = NULL;
+        tex.clip  = damage.to_pixman();
         wlr_render_pass_add_texture(pass, &tex);
         wlr_render_pass_submit(pass);
         wlr_texture_destroy(vk_tex);
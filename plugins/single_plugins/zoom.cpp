@@ -1,8 +1,229 @@
 #include <wayfire/per-output-plugin.hpp>
 #include <wayfire/output.hpp>
+#include <wayfire/core.hpp>
 #include <wayfire/render.hpp>
 #include <wayfire/render-manager.hpp>
+#include <wayfire/scene-operations.hpp>
+#include <wayfire/scene-render.hpp>
+#include <wayfire/signal-definitions.hpp>
+#include <wayfire/workspace-set.hpp>
+#include <wayfire/workspace-stream.hpp>
 #include <wayfire/util/duration.hpp>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace wf
+{
+namespace zoom
+{
+/**
+ * The magnified part of an output: the output-local point @origin is shown at the top-left corner of the
+ * output, and everything is scaled by @factor.
+ */
+struct viewport_t
+{
+    wf::point_t origin = {0, 0};
+    float factor = 1.0;
+
+    bool operator ==(const viewport_t& other) const
+    {
+        return (origin == other.origin) && (factor == other.factor);
+    }
+
+    bool operator !=(const viewport_t& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+/**
+ * A node which shows the current workspace of an output magnified. Instead of magnifying the final image of
+ * the output, the scenegraph is rendered directly at the magnified resolution, so only the visible part of
+ * the workspace is rendered and its contents stay sharp.
+ *
+ * The node covers the whole output, so nothing below it is rendered.
+ */
+class zoom_node_t : public wf::scene::node_t
+{
+    class zoom_render_instance_t : public wf::scene::render_instance_t
+    {
+        zoom_node_t *self;
+        wf::scene::damage_callback push_damage;
+
+        std::shared_ptr<wf::workspace_stream_node_t> stream;
+        std::vector<wf::scene::render_instance_uptr> children;
+
+        wf::signal::connection_t<wf::scene::node_damage_signal> on_zoom_damage =
+            [=] (wf::scene::node_damage_signal *ev)
+        {
+            push_damage(ev->region);
+        };
+
+        void ensure_stream()
+        {
+            auto ws = self->output->wset()->get_current_workspace();
+            if (stream && (stream->ws == ws))
+            {
+                return;
+            }
+
+            children.clear();
+            stream = std::make_shared<wf::workspace_stream_node_t>(self->output, ws);
+            stream->gen_render_instances(children, [=] (const wf::region_t& damage)
+            {
+                push_damage(self->magnify_region(damage));
+            }, self->output);
+        }
+
+      public:
+        zoom_render_instance_t(zoom_node_t *self, wf::scene::damage_callback push_damage)
+        {
+            this->self = self;
+            this->push_damage = push_damage;
+            self->connect(&on_zoom_damage);
+            ensure_stream();
+        }
+
+        void schedule_instructions(std::vector<wf::scene::render_instruction_t>& instructions,
+            const wf::render_target_t& target, wf::region_t& damage) override
+        {
+            auto bbox = self->get_bounding_box();
+            auto our_damage = damage & bbox;
+            if (our_damage.empty())
+            {
+                return;
+            }
+
+            ensure_stream();
+
+            // The output-local area shown on the output is mapped onto the whole target.
+            wf::render_target_t zoomed = target;
+            zoomed.geometry = self->get_visible_area();
+            zoomed.scale    = target.scale * self->viewport.factor;
+
+            auto local_damage = self->unmagnify_region(our_damage);
+            for (auto& ch : children)
+            {
+                ch->schedule_instructions(instructions, zoomed, local_damage);
+            }
+
+            damage ^= bbox;
+        }
+
+        void presentation_feedback(wf::output_t *output) override
+        {
+            for (auto& ch : children)
+            {
+                ch->presentation_feedback(output);
+            }
+        }
+
+        void compute_visibility(wf::output_t *output, wf::region_t& visible) override
+        {
+            wf::region_t local_visible = self->get_visible_area();
+            for (auto& ch : children)
+            {
+                ch->compute_visibility(output, local_visible);
+            }
+        }
+    };
+
+  public:
+    wf::output_t*const output;
+
+    zoom_node_t(wf::output_t *output) : node_t(false), output(output)
+    {}
+
+    void set_viewport(const viewport_t& viewport)
+    {
+        if (viewport != this->viewport)
+        {
+            this->viewport = viewport;
+            wf::scene::damage_node(this, get_bounding_box());
+        }
+    }
+
+    void gen_render_instances(std::vector<wf::scene::render_instance_uptr>& instances,
+        wf::scene::damage_callback push_damage, wf::output_t *shown_on) override
+    {
+        if (shown_on != this->output)
+        {
+            return;
+        }
+
+        instances.push_back(std::make_unique<zoom_render_instance_t>(this, push_damage));
+    }
+
+    wf::geometry_t get_bounding_box() override
+    {
+        return output->get_layout_geometry();
+    }
+
+    bool depends_on_whole_scene() const override
+    {
+        // The workspace stream shows the views on the output, so views which are mapped or unmapped while
+        // zoomed in need new instances.
+        return true;
+    }
+
+    std::string stringify() const override
+    {
+        return "zoom of output " + output->to_string();
+    }
+
+  private:
+    viewport_t viewport;
+
+    /** The output-local area which is shown on the output. */
+    wf::geometry_t get_visible_area() const
+    {
+        auto size = wf::dimensions(output->get_relative_geometry());
+        return {
+            viewport.origin.x,
+            viewport.origin.y,
+            (int)std::ceil(size.width / viewport.factor) + 1,
+            (int)std::ceil(size.height / viewport.factor) + 1,
+        };
+    }
+
+    /** Convert output-local damage to damage on the output, in layout coordinates. */
+    wf::region_t magnify_region(const wf::region_t& region) const
+    {
+        auto og = output->get_layout_geometry();
+        wf::region_t result;
+        for (const auto& box : region)
+        {
+            // Grow by a pixel on each side, since bilinear filtering blends in the neighboring pixels.
+            const int x1 = og.x + (int)std::floor((box.x1 - 1 - viewport.origin.x) * viewport.factor);
+            const int y1 = og.y + (int)std::floor((box.y1 - 1 - viewport.origin.y) * viewport.factor);
+            const int x2 = og.x + (int)std::ceil((box.x2 + 1 - viewport.origin.x) * viewport.factor);
+            const int y2 = og.y + (int)std::ceil((box.y2 + 1 - viewport.origin.y) * viewport.factor);
+            result |= wf::geometry_t{x1, y1, x2 - x1, y2 - y1};
+        }
+
+        return result & og;
+    }
+
+    /** Convert damage on the output, in layout coordinates, to the output-local area shown there. */
+    wf::region_t unmagnify_region(const wf::region_t& region) const
+    {
+        auto og = output->get_layout_geometry();
+        wf::region_t result;
+        for (const auto& box : region)
+        {
+            const int x1 = viewport.origin.x + (int)std::floor((box.x1 - og.x) / viewport.factor);
+            const int y1 = viewport.origin.y + (int)std::floor((box.y1 - og.y) / viewport.factor);
+            const int x2 = viewport.origin.x + (int)std::ceil((box.x2 - og.x) / viewport.factor);
+            const int y2 = viewport.origin.y + (int)std::ceil((box.y2 - og.y) / viewport.factor);
+            result |= wf::geometry_t{x1, y1, x2 - x1, y2 - y1};
+        }
+
+        return result;
+    }
+};
+}
+}
 
 class wayfire_zoom_screen : public wf::per_output_plugin_instance_t
 {
@@ -12,12 +233,24 @@ class wayfire_zoom_screen : public wf::per_output_plugin_instance_t
         NEAREST = 1,
     };
 
+    /**
+     * Views which are rendered to auxiliary buffers, for example during animations, allocate them at the
+     * resolution of the render target. When rendering the scenegraph magnified, this grows with the zoom
+     * factor, so above this size the final image of the output is magnified instead.
+     */
+    static constexpr int MAX_SCENE_ZOOM_SIZE = 16384;
+
     wf::option_wrapper_t<wf::keybinding_t> modifier{"zoom/modifier"};
     wf::option_wrapper_t<double> speed{"zoom/speed"};
     wf::option_wrapper_t<wf::animation_description_t> smoothing_duration{"zoom/smoothing_duration"};
     wf::option_wrapper_t<int> interpolation_method{"zoom/interpolation_method"};
+    wf::option_wrapper_t<bool> scene_rendering{"zoom/scene_rendering"};
     wf::animation::simple_animation_t progression{smoothing_duration};
     bool hook_set = false;
+    bool post_hook_set = false;
+    bool redraw_always_set = false;
+    std::shared_ptr<wf::zoom::zoom_node_t> zoom_node;
+    wf::wl_idle_call idle_unset;
 
     wf::plugin_activation_data_t grab_interface = {
         .name = "zoom",
@@ -29,6 +262,9 @@ class wayfire_zoom_screen : public wf::per_output_plugin_instance_t
     {
         progression.set(1, 1);
         output->add_axis(modifier, &axis);
+        interpolation_method.set_callback([=] { update_render_mode(); });
+        scene_rendering.set_callback([=] { update_render_mode(); });
+        output->connect(&on_workspace_changed);
     }
 
     void update_zoom_target(float delta)
@@ -44,9 +280,11 @@ class wayfire_zoom_screen : public wf::per_output_plugin_instance_t
             if (!hook_set)
             {
                 hook_set = true;
-                output->render->add_post(&render_hook);
-                output->render->set_redraw_always();
+                output->render->add_effect(&pre_hook, wf::OUTPUT_EFFECT_PRE);
             }
+
+            update_render_mode();
+            output->render->schedule_redraw();
         }
     }
 
@@ -67,6 +305,140 @@ class wayfire_zoom_screen : public wf::per_output_plugin_instance_t
         return true;
     };
 
+    /**
+     * Whether to render the scenegraph magnified, or to magnify the final image of the output in a post hook.
+     * Nearest-neighbor interpolation only makes sense for the final image.
+     */
+    bool should_render_scene()
+    {
+        const int size = std::max(output->handle->width, output->handle->height);
+        return scene_rendering &&
+               (interpolation_method == (int)interpolation_method_t::LINEAR) &&
+               (progression.end * size <= MAX_SCENE_ZOOM_SIZE);
+    }
+
+    void update_render_mode()
+    {
+        if (!hook_set)
+        {
+            return;
+        }
+
+        if (should_render_scene())
+        {
+            if (post_hook_set)
+            {
+                output->render->rem_post(&render_hook);
+                post_hook_set = false;
+            }
+
+            // The zoom node is damaged when the viewport changes, so frames are needed only while the
+            // animation runs (see pre_hook) or when the cursor moves.
+            set_redraw_always(false);
+            wf::get_core().connect(&on_motion);
+            wf::get_core().connect(&on_absolute_motion);
+
+            if (!zoom_node)
+            {
+                zoom_node = std::make_shared<wf::zoom::zoom_node_t>(output);
+                zoom_node->set_viewport(get_viewport());
+                wf::scene::add_front(wf::get_core().scene(), zoom_node);
+            }
+        } else
+        {
+            remove_zoom_node();
+            on_motion.disconnect();
+            on_absolute_motion.disconnect();
+            if (!post_hook_set)
+            {
+                output->render->add_post(&render_hook);
+                post_hook_set = true;
+            }
+
+            set_redraw_always(true);
+        }
+    }
+
+    void set_redraw_always(bool always)
+    {
+        if (always != redraw_always_set)
+        {
+            output->render->set_redraw_always(always);
+            redraw_always_set = always;
+        }
+    }
+
+    void update_viewport()
+    {
+        if (zoom_node)
+        {
+            zoom_node->set_viewport(get_viewport());
+        }
+    }
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_pointer_motion_event>> on_motion = [=] (auto)
+    {
+        update_viewport();
+    };
+
+    wf::signal::connection_t<wf::post_input_event_signal<wlr_pointer_motion_absolute_event>>
+    on_absolute_motion = [=] (auto)
+    {
+        update_viewport();
+    };
+
+    void remove_zoom_node()
+    {
+        if (zoom_node)
+        {
+            wf::scene::remove_child(zoom_node);
+            zoom_node = nullptr;
+        }
+    }
+
+    wf::zoom::viewport_t get_viewport()
+    {
+        auto oc = output->get_cursor_position();
+        double x, y;
+        wlr_box b = output->get_relative_geometry();
+        wlr_box_closest_point(&b, oc.x, oc.y, &x, &y);
+
+        // Keep the point under the cursor in place, like the post hook does.
+        const float factor = (float)progression;
+        const float scale  = (factor - 1) / factor;
+        return {{(int)std::round(x * scale), (int)std::round(y * scale)}, factor};
+    }
+
+    wf::signal::connection_t<wf::workspace_changed_signal> on_workspace_changed =
+        [=] (wf::workspace_changed_signal*)
+    {
+        if (zoom_node)
+        {
+            wf::scene::damage_node(zoom_node, zoom_node->get_bounding_box());
+        }
+    };
+
+    wf::effect_hook_t pre_hook = [=] ()
+    {
+        update_viewport();
+        if (zoom_node && progression.running())
+        {
+            output->render->schedule_redraw();
+        }
+
+        if (!progression.running() && (progression - 1 <= 0.01))
+        {
+            // The scenegraph should not be changed while rendering.
+            idle_unset.run_once([=] ()
+            {
+                if (!progression.running() && (progression - 1 <= 0.01))
+                {
+                    unset_hook();
+                }
+            });
+        }
+    };
+
     wf::post_hook_t render_hook = [=] (wf::auxilliary_buffer_t& source,
                                        const wf::render_buffer_t& destination)
     {
@@ -94,26 +466,32 @@ class wayfire_zoom_screen : public wf::per_output_plugin_instance_t
         auto filter_mode   = (interpolation_method == (int)interpolation_method_t::NEAREST) ?
             WLR_SCALE_FILTER_NEAREST : WLR_SCALE_FILTER_BILINEAR;
         destination.blit(source, {x1, y1, tw, th}, {0, 0, w, h}, filter_mode);
-        if (!progression.running() && (progression - 1 <= 0.01))
-        {
-            unset_hook();
-        }
     };
 
     void unset_hook()
     {
-        output->render->set_redraw_always(false);
-        output->render->rem_post(&render_hook);
-        hook_set = false;
-    }
+        if (!hook_set)
+        {
+            return;
+        }
 
-    void fini() override
-    {
-        if (hook_set)
+        set_redraw_always(false);
+        on_motion.disconnect();
+        on_absolute_motion.disconnect();
+        output->render->rem_effect(&pre_hook);
+        if (post_hook_set)
         {
             output->render->rem_post(&render_hook);
+            post_hook_set = false;
         }
 
+        remove_zoom_node();
+        hook_set = false;
+    }
+
+    void fini() override
+    {
+        unset_hook();
         output->rem_binding(&axis);
     }
 };
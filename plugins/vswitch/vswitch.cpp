@@ -90,6 +90,12 @@ class vswitch_overlay_node_t : public wf::scene::node_t
         }
     }
 
+    bool depends_on_whole_scene() const override
+    {
+        // The instances belong to the view's subtree, which is not below this node.
+        return true;
+    }
+
     virtual wf::geometry_t get_bounding_box()
     {
         if (auto view = _view.lock())
@@ -0,0 +1,432 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "wayfire/action/action_interface.hpp"
+#include "wayfire/condition/access_interface.hpp"
+#include "wayfire/object.hpp"
+#include "wayfire/rule/rule.hpp"
+#include "wayfire/util/log.hpp"
+#include "wayfire/variant.hpp"
+
+namespace wf
+{
+namespace window_rules
+{
+// A set of rules, one bit per rule of a signal.
+using rule_set_t = std::vector<uint64_t>;
+
+/**
+ * An access interface which reads each property of the view at most once, and records which properties
+ * were read by the rule being evaluated.
+ */
+class memoized_access_t : public access_interface_t
+{
+  public:
+    struct value_t
+    {
+        std::string identifier;
+        variant_t value;
+        bool error = false;
+
+        // The entry for this value in the engine's index, once looked up, see window_rules_engine_t.
+        rule_set_t *no_action = nullptr;
+        uint64_t no_action_epoch = 0;
+    };
+
+    access_interface_t *base = nullptr;
+
+    // The properties read since the last reset.
+    std::vector<value_t> values;
+
+    // Indices of the values read by the current rule, if recording.
+    std::vector<size_t> recorded;
+    bool recording    = false;
+    bool record_error = false;
+
+    size_t lookup_index(const std::string& identifier)
+    {
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            if (values[i].identifier == identifier)
+            {
+                return i;
+            }
+        }
+
+        value_t value;
+        value.identifier = identifier;
+        value.value = base->get(identifier, value.error);
+        values.push_back(std::move(value));
+        return values.size() - 1;
+    }
+
+    const value_t& lookup(const std::string& identifier)
+    {
+        return values[lookup_index(identifier)];
+    }
+
+    variant_t get(const std::string & identifier, bool & error) override
+    {
+        const size_t idx = lookup_index(identifier);
+        if (recording && (std::find(recorded.begin(), recorded.end(), idx) == recorded.end()))
+        {
+            recorded.push_back(idx);
+            record_error |= values[idx].error;
+        }
+
+        error = values[idx].error;
+        return values[idx].value;
+    }
+};
+
+/**
+ * An action interface which forwards actions and notes whether any action was executed.
+ */
+class recording_action_t : public action_interface_t
+{
+  public:
+    action_interface_t *base = nullptr;
+    memoized_access_t *access = nullptr;
+    bool executed = false;
+
+    bool execute(const std::string & name, const std::vector<variant_t> & args) override
+    {
+        executed = true;
+        bool error = base->execute(name, args);
+
+        // Actions change the view, so its properties have to be read again.
+        access->values.clear();
+        return error;
+    }
+};
+
+/**
+ * Used to find out which signal a rule reacts to: rules do not read any properties or execute any actions
+ * for other signals.
+ */
+class probe_interface_t : public access_interface_t, public action_interface_t
+{
+  public:
+    bool used = false;
+
+    variant_t get(const std::string&, bool & error) override
+    {
+        used  = true;
+        error = false;
+        return std::string("");
+    }
+
+    bool execute(const std::string&, const std::vector<variant_t>&) override
+    {
+        used = true;
+        return false;
+    }
+};
+
+/**
+ * The rules which are known to do nothing for a given value of a single property.
+ */
+struct property_index_t
+{
+    std::string identifier;
+    std::map<variant_t, rule_set_t> no_action;
+
+    // Incremented whenever entries are removed from no_action.
+    uint64_t epoch = 1;
+};
+
+struct signal_rules_t
+{
+    std::string signal;
+
+    // Indices into the list of all rules, in order.
+    std::vector<size_t> rules;
+    std::vector<property_index_t> properties;
+};
+
+struct cached_result_t
+{
+    // Whether the last evaluation of the rule on the view executed no actions.
+    bool no_action = false;
+
+    // The properties read during the last evaluation and their values.
+    std::vector<std::pair<std::string, variant_t>> inputs;
+};
+
+/**
+ * The results of rules which read several properties, stored on each view.
+ */
+struct view_cache_t : public custom_data_t
+{
+    uint64_t generation = 0;
+    std::vector<cached_result_t> results;
+};
+}
+
+/**
+ * Applies a list of parsed window rules to views.
+ *
+ * Rules are grouped by the signal they react to, so a signal only evaluates the rules written for it. The
+ * outcome of a rule depends only on the view properties its condition reads, so the outcomes of rules which
+ * did nothing are remembered:
+ *
+ * - If a rule read a single property, for example the app-id, it is skipped for all views where this
+ *   property has the same value. These rules are found with one lookup per property, without iterating over
+ *   them.
+ * - If a rule read several properties, it is skipped for the same view as long as these do not change.
+ *
+ * View properties are read at most once per signal, unless an action changes the view.
+ */
+class window_rules_engine_t
+{
+  public:
+    /**
+     * The signals window rules can react to.
+     */
+    static const std::vector<std::string>& get_signals()
+    {
+        static const std::vector<std::string> signals = {
+            "created", "maximized", "unmaximized", "minimized", "fullscreened"
+        };
+        return signals;
+    }
+
+    void set_rules(std::vector<std::shared_ptr<rule_t>> rules)
+    {
+        this->rules = std::move(rules);
+        this->by_signal.clear();
+        this->generation = next_generation()++;
+
+        for (auto& signal : get_signals())
+        {
+            window_rules::signal_rules_t entry;
+            entry.signal = signal;
+            for (size_t i = 0; i < this->rules.size(); i++)
+            {
+                window_rules::probe_interface_t probe;
+                this->rules[i]->apply(signal, probe, probe);
+                if (probe.used)
+                {
+                    entry.rules.push_back(i);
+                }
+            }
+
+            if (!entry.rules.empty())
+            {
+                by_signal.push_back(std::move(entry));
+            }
+        }
+    }
+
+    /**
+     * Apply the rules for the given signal to a view.
+     *
+     * @param view The object on which results for the view are cached, typically the view itself.
+     * @param access The access interface for the view's properties.
+     * @param action The action interface executing actions on the view.
+     */
+    void apply(const std::string& signal, object_base_t& view, access_interface_t& access,
+        action_interface_t& action)
+    {
+        auto it = std::find_if(by_signal.begin(), by_signal.end(), [&] (const auto& entry)
+        {
+            return entry.signal == signal;
+        });
+
+        if (it == by_signal.end())
+        {
+            return;
+        }
+
+        auto& sig = *it;
+        auto cache = view.get_data_safe<window_rules::view_cache_t>();
+        if (cache->generation != generation)
+        {
+            cache->generation = generation;
+            cache->results.clear();
+        }
+
+        window_rules::memoized_access_t memo;
+        memo.base = &access;
+        window_rules::recording_action_t recording;
+        recording.base   = &action;
+        recording.access = &memo;
+
+        // Note that actions may emit signals which apply rules again, so all state is local.
+        auto skipped = find_skipped_rules(sig, memo);
+        for (size_t i = 0; i < sig.rules.size(); i++)
+        {
+            if (skipped[i / 64] & (1ull << (i % 64)))
+            {
+                continue;
+            }
+
+            const size_t rule_idx = sig.rules[i];
+            if ((rule_idx < cache->results.size()) && cache->results[rule_idx].no_action &&
+                inputs_unchanged(cache->results[rule_idx], memo))
+            {
+                continue;
+            }
+
+            memo.recorded.clear();
+            memo.recording    = true;
+            memo.record_error = false;
+            recording.executed = false;
+            const bool error = rules[rule_idx]->apply(signal, memo, recording);
+            memo.recording = false;
+
+            if (error)
+            {
+                LOGE("Window-rules: Error while executing rule on ", signal, " signal.");
+            }
+
+            if (recording.executed)
+            {
+                // The view may have changed, so the skipped rules have to be found again.
+                skipped = find_skipped_rules(sig, memo);
+            }
+
+            if (recording.executed || error || memo.record_error)
+            {
+                if (rule_idx < cache->results.size())
+                {
+                    cache->results[rule_idx].no_action = false;
+                }
+
+                continue;
+            }
+
+            remember_no_action(sig, i, rule_idx, memo, *cache);
+        }
+    }
+
+  private:
+    std::vector<std::shared_ptr<rule_t>> rules;
+    std::vector<window_rules::signal_rules_t> by_signal;
+    uint64_t generation = 0;
+
+    // Bounds the number of values remembered for each property, for example window titles.
+    static constexpr size_t MAX_INDEXED_VALUES = 256;
+
+    static uint64_t& next_generation()
+    {
+        // Shared between all engines, so that cached results are never confused between them.
+        static uint64_t generation = 1;
+        return generation;
+    }
+
+    static window_rules::rule_set_t find_skipped_rules(const window_rules::signal_rules_t& sig,
+        window_rules::memoized_access_t& memo)
+    {
+        window_rules::rule_set_t skipped((sig.rules.size() + 63) / 64, 0);
+        for (auto& property : sig.properties)
+        {
+            const auto& value = memo.lookup(property.identifier);
+            if (value.error)
+            {
+                continue;
+            }
+
+            auto it = property.no_action.find(value.value);
+            if (it != property.no_action.end())
+            {
+                for (size_t i = 0; i < skipped.size(); i++)
+                {
+                    skipped[i] |= it->second[i];
+                }
+            }
+        }
+
+        return skipped;
+    }
+
+    static bool inputs_unchanged(const window_rules::cached_result_t& result,
+        window_rules::memoized_access_t& memo)
+    {
+        for (auto& [identifier, value] : result.inputs)
+        {
+            const auto& current = memo.lookup(identifier);
+            if (current.error || (current.value != value))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void remember_no_action(window_rules::signal_rules_t& sig, size_t i, size_t rule_idx,
+        window_rules::memoized_access_t& memo, window_rules::view_cache_t& cache)
+    {
+        if (memo.recorded.size() == 1)
+        {
+            // Rules reading the same property share the entry for its value, so look it up only once.
+            auto& input    = memo.values[memo.recorded.front()];
+            auto& property = find_property(sig, input.identifier);
+            if (!input.no_action || (input.no_action_epoch != property.epoch))
+            {
+                input.no_action = &find_no_action_set(property, sig.rules.size(), input.value);
+                input.no_action_epoch = property.epoch;
+            }
+
+            (*input.no_action)[i / 64] |= (1ull << (i % 64));
+            return;
+        }
+
+        if (cache.results.size() <= rule_idx)
+        {
+            cache.results.resize(rules.size());
+        }
+
+        auto& result = cache.results[rule_idx];
+        result.no_action = true;
+        result.inputs.clear();
+        for (auto& idx : memo.recorded)
+        {
+            result.inputs.push_back({memo.values[idx].identifier, memo.values[idx].value});
+        }
+    }
+
+    static window_rules::property_index_t& find_property(window_rules::signal_rules_t& sig,
+        const std::string& identifier)
+    {
+        auto property = std::find_if(sig.properties.begin(), sig.properties.end(), [&] (const auto& p)
+        {
+            return p.identifier == identifier;
+        });
+
+        if (property == sig.properties.end())
+        {
+            sig.properties.push_back({identifier, {}});
+            property = std::prev(sig.properties.end());
+        }
+
+        return *property;
+    }
+
+    static window_rules::rule_set_t& find_no_action_set(window_rules::property_index_t& property,
+        size_t num_rules, const variant_t& value)
+    {
+        auto it = property.no_action.find(value);
+        if (it == property.no_action.end())
+        {
+            if (property.no_action.size() >= MAX_INDEXED_VALUES)
+            {
+                property.no_action.clear();
+                property.epoch++;
+            }
+
+            it = property.no_action.emplace(value, window_rules::rule_set_t((num_rules + 63) / 64, 0)).first;
+        }
+
+        return it->second;
+    }
+};
+}
@@ -16,6 +16,7 @@
 #include <wayfire/toplevel-view.hpp>
 
 #include "lambda-rules-registration.hpp"
+#include "rules-engine.hpp"
 #include "view-action-interface.hpp"
 #include "wayfire/signal-provider.hpp"
 
@@ -61,10 +62,9 @@ class wayfire_window_rules_t : public wf::per_output_plugin_instance_t
         setup_rules_from_config();
     };
 
-    std::vector<std::shared_ptr<wf::rule_t>> _rules;
+    wf::window_rules_engine_t _engine;
 
     wf::view_access_interface_t _access_interface;
-    wf::view_action_interface_t _action_interface;
 
     nonstd::observer_ptr<wf::lambda_rules_registrations_t> _lambda_registrations;
 };
@@ -111,16 +111,11 @@ void wayfire_window_rules_t::apply(const std::string & signal, wayfire_view view
         return;
     }
 
-    for (const auto & rule : _rules)
-    {
-        _access_interface.set_view(view);
-        _action_interface.set_view(view);
-        auto error = rule->apply(signal, _access_interface, _action_interface);
-        if (error)
-        {
-            LOGE("Window-rules: Error while executing rule on ", signal, " signal.");
-        }
-    }
+    // Actions may trigger signals which apply rules again, so the interfaces are not shared between calls.
+    wf::view_access_interface_t access_interface{view};
+    wf::view_action_interface_t action_interface;
+    action_interface.set_view(view);
+    _engine.apply(signal, *view, access_interface, action_interface);
 
     auto bounds = _lambda_registrations->rules();
     auto begin  = std::get<0>(bounds);
@@ -179,8 +174,7 @@ void wayfire_window_rules_t::apply(const std::string & signal, wayfire_view view
 
 void wayfire_window_rules_t::setup_rules_from_config()
 {
-    _rules.clear();
-
+    std::vector<std::shared_ptr<wf::rule_t>> rules;
     wf::option_wrapper_t<wf::config::compound_list_t<std::string>> rule_list_option{"window-rules/rules"};
     auto rule_list = rule_list_option.value();
 
@@ -191,9 +185,11 @@ void wayfire_window_rules_t::setup_rules_from_config()
         auto rule = wf::rule_parser_t().parse(_lexer);
         if (rule != nullptr)
         {
-            _rules.push_back(rule);
+            rules.push_back(rule);
         }
     }
+
+    _engine.set_rules(std::move(rules));
 }
 
 DECLARE_WAYFIRE_PLUGIN(wf::per_output_plugin_t<wayfire_window_rules_t>);
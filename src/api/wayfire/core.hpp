@@ -10,6 +10,7 @@
 #include <limits>
 #include <vector>
 #include <wayfire/nonstd/observer_ptr.h>
+#include <wayfire/nonstd/tracking-allocator.hpp>
 
 #include <wayland-server.h>
 #include <wayfire/nonstd/wlroots.hpp>
@@ -258,13 +259,19 @@ class compositor_core_t : public wf::object_base_t, public signal::provider_t
         nonstd::observer_ptr<wf::touch::gesture_t> gesture) = 0;
 
     /**
-     * @deprecated. Use tracking_allocator_t<view_interface_t>::get_all()
+     * @deprecated. Use tracking_allocator_t<view_interface_t>::get_all() or get_range()
      *
      * @return A list of all views core manages, regardless of their output,
      *  properties, etc.
      */
     std::vector<wayfire_view> get_all_views();
 
+    /**
+     * @return A range over all views core manages, like get_all_views(), but without copying the list.
+     *  Views may be destroyed while iterating over the range, they are then skipped.
+     */
+    tracking_allocator_t<view_interface_t>::range_t get_all_views_range();
+
     /** The wayland socket name of Wayfire */
     std::string wayland_display;
 
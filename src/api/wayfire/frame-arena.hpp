@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace wf
+{
+namespace scene
+{
+struct render_instruction_t;
+}
+
+/**
+ * A frame arena keeps the temporary lists of render instructions which are needed only while a single frame
+ * is being rendered.
+ *
+ * reset() clears the lists without releasing their storage, so once the lists have grown to the size needed
+ * for a frame, following frames of similar complexity do not need any heap allocations for them.
+ *
+ * Memory which is managed by other libraries, for example the storage of pixman regions with more than one
+ * rectangle or the state of wlroots render passes, is not kept in the arena.
+ */
+class frame_arena_t
+{
+  public:
+    frame_arena_t();
+    ~frame_arena_t();
+
+    frame_arena_t(const frame_arena_t&) = delete;
+    frame_arena_t& operator =(const frame_arena_t&) = delete;
+
+    /**
+     * Get an empty list for render instructions. The list stays valid until the next reset(), which clears
+     * it but keeps its capacity for the next frame. Each call returns a different list, so that nested render
+     * passes sharing the arena do not interfere with each other.
+     */
+    std::vector<scene::render_instruction_t>& get_instruction_list();
+
+    /**
+     * Clear all instruction lists, so that they can be reused for the next frame.
+     */
+    void reset();
+
+    /**
+     * Get the arena of the frame which is currently being rendered, or nullptr if no frame is being
+     * rendered. Render passes which do not specify an arena, for example nested passes started by render
+     * instances or effect hooks, take their instruction lists from it.
+     */
+    static frame_arena_t *get_current();
+
+    /** Set the arena returned by get_current(). */
+    static void set_current(frame_arena_t *arena);
+
+  private:
+    std::vector<std::unique_ptr<std::vector<scene::render_instruction_t>>> instruction_lists;
+    size_t next_instruction_list = 0;
+};
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <wayfire/nonstd/json.hpp>
+
+namespace wf
+{
+namespace scene
+{
+class render_instance_t;
+}
+
+/**
+ * The phases of an output repaint which are measured by the frame profiler.
+ * They are listed in the order in which render_manager executes them.
+ */
+enum class frame_phase_t : uint32_t
+{
+    EFFECTS_PRE       = 0,
+    EFFECTS_DAMAGE    = 1,
+    DIRECT_SCANOUT    = 2,
+    START_FRAME       = 3,
+    START_OUTPUT_PASS = 4,
+    OVERLAY           = 5,
+    SUBMIT            = 6,
+    PASS_DONE         = 7,
+    POST_EFFECTS      = 8,
+    SW_CURSORS        = 9,
+    SWAP              = 10,
+    POST_PAINT        = 11,
+    /** Not a real phase, but a placeholder for the number of phases. */
+    TOTAL,
+};
+
+/**
+ * Get a human-readable name for the given phase, as used in the profiler's JSON output.
+ */
+const char *frame_phase_name(frame_phase_t phase);
+
+/**
+ * How a profiled frame ended.
+ */
+enum class frame_result_t : uint32_t
+{
+    /** The frame was fully rendered and submitted to the output. */
+    RENDERED,
+    /** A view was directly scanned out, no rendering happened. */
+    SCANOUT,
+    /** The output was not damaged, so the frame was skipped. Such frames are not kept in the ring buffer. */
+    SKIPPED,
+    /** Rendering or submitting the frame failed. */
+    FAILED,
+};
+
+/**
+ * A single measured interval inside a frame. All times are in nanoseconds, relative to CLOCK_MONOTONIC.
+ */
+struct frame_interval_t
+{
+    /** Start of the interval, or -1 if the interval was never entered during the frame. */
+    int64_t start_ns    = -1;
+    int64_t duration_ns = 0;
+};
+
+/**
+ * The cost of a single render instance in a frame.
+ */
+struct frame_instance_sample_t
+{
+    enum kind_t : uint32_t
+    {
+        /** Time spent in render_instance_t::schedule_instructions(). */
+        SCHEDULE,
+        /** Time spent in render_instance_t::render(). */
+        RENDER,
+    };
+
+    kind_t kind = SCHEDULE;
+    /** The instance which was measured. It may no longer exist when the sample is read! */
+    const scene::render_instance_t *instance = nullptr;
+    /** The (mangled) name of the dynamic type of the instance. */
+    const char *type_name = nullptr;
+    frame_interval_t interval;
+};
+
+/**
+ * The timeline of a single frame on an output.
+ */
+struct frame_profile_t
+{
+    /**
+     * The maximal number of instance samples kept per frame. If more instances are rendered, only the most
+     * expensive ones are kept.
+     */
+    static constexpr size_t MAX_INSTANCE_SAMPLES = 48;
+
+    /** A monotonically increasing frame number, starting from 0 when the profiler is enabled. */
+    uint64_t sequence = 0;
+    frame_result_t result = frame_result_t::SKIPPED;
+    frame_interval_t frame;
+    std::array<frame_interval_t, (size_t)frame_phase_t::TOTAL> phases;
+
+    /** The total number of render instructions executed in the main render pass. */
+    uint32_t num_instructions = 0;
+    uint32_t num_instance_samples = 0;
+    std::array<frame_instance_sample_t, MAX_INSTANCE_SAMPLES> instance_samples;
+};
+
+/**
+ * The frame profiler records a timeline of every repaint of an output in a fixed-size ring buffer.
+ *
+ * The ring buffer has a single producer (the output's render manager) which never blocks or allocates
+ * memory while a frame is being recorded. A frame becomes visible to readers only once it is finished, so
+ * readers can never observe a partially written frame.
+ *
+ * By default, the profiler is disabled and costs a single branch per phase.
+ */
+class frame_profiler_t
+{
+  public:
+    /** Number of frames kept in the ring buffer. */
+    static constexpr size_t CAPACITY = 256;
+
+    /**
+     * @param name The name of the profiled output, used for the trace output.
+     * @param id The id of the profiled output, used as process id in the Chrome trace output.
+     */
+    frame_profiler_t(std::string name, uint32_t id);
+    ~frame_profiler_t();
+
+    frame_profiler_t(const frame_profiler_t&) = delete;
+    frame_profiler_t(frame_profiler_t&&) = delete;
+    frame_profiler_t& operator =(const frame_profiler_t&) = delete;
+    frame_profiler_t& operator =(frame_profiler_t&&) = delete;
+
+    /**
+     * Enable or disable the profiler. Enabling the profiler allocates the ring buffer and clears previously
+     * recorded frames, disabling it frees the ring buffer.
+     */
+    void set_enabled(bool enabled);
+
+    bool is_enabled() const
+    {
+        return frames != nullptr;
+    }
+
+    /* ------------------------------ Producer side ------------------------------ */
+
+    /** Start recording a new frame. */
+    void begin_frame();
+
+    /**
+     * Finish the current frame and publish it to the ring buffer. Skipped frames are only counted, so that
+     * idle outputs do not push the frames which were actually rendered out of the ring buffer.
+     */
+    void end_frame(frame_result_t result);
+
+    void begin_phase(frame_phase_t phase);
+    void end_phase(frame_phase_t phase);
+
+    /** Record the cost of a render instance in the current frame. */
+    void add_instance_sample(frame_instance_sample_t::kind_t kind, const scene::render_instance_t *instance,
+        int64_t start_ns, int64_t end_ns);
+
+    /** Set the number of render instructions in the current frame. */
+    void set_num_instructions(uint32_t count);
+
+    /* ------------------------------ Consumer side ------------------------------ */
+
+    /**
+     * Get (up to) the last @max_frames finished frames, from the oldest to the newest.
+     * At most CAPACITY - 1 frames can be retrieved, because the last slot is reserved for the frame which
+     * is currently being recorded.
+     */
+    std::vector<frame_profile_t> get_frames(size_t max_frames = CAPACITY) const;
+
+    /**
+     * Serialize the last @max_frames frames as a JSON array, one object per frame.
+     */
+    wf::json_t frames_to_json(size_t max_frames = CAPACITY) const;
+
+    /**
+     * Append the last @max_frames frames as Chrome trace events (Trace Event Format, `X` events) to the
+     * given JSON array. The result can be loaded in chrome://tracing or https://ui.perfetto.dev.
+     */
+    void append_chrome_trace_events(wf::json_t& events, size_t max_frames = CAPACITY) const;
+
+    /** Get the number of frames which were skipped since the profiler was enabled. */
+    uint64_t get_num_skipped_frames() const;
+
+  private:
+    std::string name;
+    uint32_t id;
+
+    std::unique_ptr<std::array<frame_profile_t, CAPACITY>> frames;
+    /** Number of frames published so far. The frame being recorded is at slot published % CAPACITY. */
+    std::atomic<uint64_t> published{0};
+    std::atomic<uint64_t> skipped{0};
+    bool frame_active = false;
+
+    frame_profile_t& current();
+};
+}
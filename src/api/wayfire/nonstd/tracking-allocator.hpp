@@ -2,6 +2,8 @@
 #include <memory>
 #include <functional>
 #include <algorithm>
+#include <iterator>
+#include <unordered_map>
 #include <wayfire/dassert.hpp>
 #include <wayfire/nonstd/observer_ptr.h>
 #include <wayfire/signal-provider.hpp>
@@ -22,6 +24,10 @@ struct destruct_signal
  * The tracking allocator is a factory singleton for allocating objects of a certain type.
  * The objects are allocated via shared pointers, and the tracking allocator keeps a list of all allocated
  * objects, accessible by plugins.
+ *
+ * The list is kept in allocation order. Allocating and freeing objects are both amortized O(1): the
+ * allocator keeps an index from each object to its slot in the list, freed objects leave a hole in their
+ * slot, and the holes are removed once they make up half of the list, or when get_all() is called.
  */
 template<class ObjectType>
 class tracking_allocator_t
@@ -44,17 +50,163 @@ class tracking_allocator_t
             new ConcreteObjectType(std::forward<Args>(args)...),
             std::bind(&tracking_allocator_t<ObjectType>::deallocate_object, this, std::placeholders::_1));
 
+        index[ptr.get()] = allocated_objects.size();
         allocated_objects.push_back(ptr.get());
         return ptr;
     }
 
+    /**
+     * Get a list of all allocated objects, in allocation order.
+     *
+     * The list is not copied, so it must not be used after objects are allocated or freed. To iterate while
+     * objects may be freed, use get_range() instead.
+     */
     const std::vector<nonstd::observer_ptr<ObjectType>>& get_all()
     {
-        return allocated_objects;
+        if (holes == 0)
+        {
+            return allocated_objects;
+        }
+
+        if (iterating == 0)
+        {
+            remove_holes();
+            return allocated_objects;
+        }
+
+        // A range is alive, so the holes cannot be removed from the list itself.
+        live_objects.clear();
+        std::copy_if(allocated_objects.begin(), allocated_objects.end(), std::back_inserter(live_objects),
+            [] (const auto& object) { return object != nullptr; });
+        return live_objects;
+    }
+
+    /**
+     * A view over all allocated objects, in allocation order, which does not copy the list of objects.
+     *
+     * While a range is alive, objects may still be allocated and freed: freed objects are skipped, and
+     * objects allocated after the range was created may or may not be visited.
+     */
+    class range_t
+    {
+      public:
+        class iterator
+        {
+          public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = nonstd::observer_ptr<ObjectType>;
+            using difference_type = std::ptrdiff_t;
+            using pointer   = const value_type*;
+            using reference = const value_type&;
+
+            iterator(const range_t *range, size_t idx) : range(range), idx(idx)
+            {
+                skip_removed();
+            }
+
+            reference operator *() const
+            {
+                return range->allocator->allocated_objects[idx];
+            }
+
+            pointer operator ->() const
+            {
+                return &**this;
+            }
+
+            iterator& operator ++()
+            {
+                ++idx;
+                skip_removed();
+                return *this;
+            }
+
+            iterator operator ++(int)
+            {
+                auto copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            bool operator ==(const iterator& other) const
+            {
+                return idx == other.idx;
+            }
+
+            bool operator !=(const iterator& other) const
+            {
+                return idx != other.idx;
+            }
+
+          private:
+            const range_t *range;
+            size_t idx;
+
+            void skip_removed()
+            {
+                auto& objects = range->allocator->allocated_objects;
+                while ((idx < range->end_idx) && !objects[idx])
+                {
+                    ++idx;
+                }
+            }
+        };
+
+        range_t(tracking_allocator_t *allocator) : allocator(allocator)
+        {
+            ++allocator->iterating;
+            end_idx = allocator->allocated_objects.size();
+        }
+
+        range_t(const range_t& other) : range_t(other.allocator)
+        {}
+
+        range_t& operator =(const range_t&) = delete;
+
+        ~range_t()
+        {
+            allocator->finish_iteration();
+        }
+
+        iterator begin() const
+        {
+            return iterator{this, 0};
+        }
+
+        iterator end() const
+        {
+            return iterator{this, end_idx};
+        }
+
+        bool empty() const
+        {
+            return begin() == end();
+        }
+
+      private:
+        tracking_allocator_t *allocator;
+        size_t end_idx;
+    };
+
+    /**
+     * Get a range over all allocated objects, which stays valid even if objects are freed while iterating.
+     */
+    range_t get_range()
+    {
+        return range_t{this};
     }
 
   private:
     std::vector<nonstd::observer_ptr<ObjectType>> allocated_objects;
+    std::unordered_map<ObjectType*, size_t> index;
+    /** The list returned by get_all() while ranges prevent removing the holes from allocated_objects. */
+    std::vector<nonstd::observer_ptr<ObjectType>> live_objects;
+
+    /** Number of live ranges. While there are ranges, the holes in the list cannot be removed. */
+    int iterating = 0;
+    /** Number of slots of freed objects in the list. */
+    size_t holes = 0;
+
     void deallocate_object(ObjectType *obj)
     {
         if constexpr (std::is_base_of_v<wf::signal::provider_t, ObjectType>)
@@ -64,11 +216,45 @@ class tracking_allocator_t
             obj->emit(&event);
         }
 
-        auto it = std::find(allocated_objects.begin(), allocated_objects.end(),
-            nonstd::observer_ptr<ObjectType>{obj});
-        wf::dassert(it != allocated_objects.end(), "Object is not allocated?");
-        allocated_objects.erase(it);
+        auto it = index.find(obj);
+        wf::dassert(it != index.end(), "Object is not allocated?");
+        allocated_objects[it->second] = nullptr;
+        index.erase(it);
+        ++holes;
+        compact();
+
         delete obj;
     }
+
+    void finish_iteration()
+    {
+        --iterating;
+        compact();
+    }
+
+    /**
+     * Remove the holes from the list if there are many of them. Since compacting is O(n), doing it only
+     * after n / 2 objects have been freed keeps freeing amortized O(1).
+     */
+    void compact()
+    {
+        if ((iterating > 0) || (holes * 2 < allocated_objects.size()))
+        {
+            return;
+        }
+
+        remove_holes();
+    }
+
+    void remove_holes()
+    {
+        holes = 0;
+        auto it = std::remove(allocated_objects.begin(), allocated_objects.end(), nullptr);
+        allocated_objects.erase(it, allocated_objects.end());
+        for (size_t i = 0; i < allocated_objects.size(); i++)
+        {
+            index[allocated_objects[i].get()] = i;
+        }
+    }
 };
 }
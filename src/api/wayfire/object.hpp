@@ -24,9 +24,22 @@ class custom_data_t
     custom_data_t& operator =(const custom_data_t& other) = default;
 };
 
+/**
+ * Get a small integer id (slot) for custom data stored under the given name.
+ *
+ * The slots are assigned by core on first use, so that they are the same in core and in all plugins.
+ * Data stored for a type T without an explicit name uses the slot of typeid(T).name(), so typed and named
+ * accesses to the same data are interchangeable.
+ */
+uint32_t register_data_slot(const std::string& name);
+
 /**
  * A base class for "objects". Objects provide signals and ways for plugins to
  * store custom data about the object.
+ *
+ * Custom data is kept in a small flat list indexed by slot ids (see register_data_slot()). Accessing data
+ * by type (without an explicit name) looks up the slot of the type once, so repeated accesses do not hash
+ * any strings.
  */
 class object_base_t
 {
@@ -45,43 +58,49 @@ class object_base_t
      * If your type doesn't have one, use store_data + get_data
      */
     template<class T>
-    nonstd::observer_ptr<T> get_data_safe(
-        std::string name = typeid(T).name())
+    nonstd::observer_ptr<T> get_data_safe()
     {
-        auto data = get_data<T>(name);
-        if (data)
-        {
-            return data;
-        } else
-        {
-            store_data<T>(std::make_unique<T>(), name);
+        return get_data_safe<T>(data_slot<T>());
+    }
 
-            return get_data<T>(name);
-        }
+    template<class T>
+    nonstd::observer_ptr<T> get_data_safe(std::string name)
+    {
+        return get_data_safe<T>(register_data_slot(name));
     }
 
     /* Retrieve custom data stored with the given name. If no such
      * data exists, NULL is returned */
     template<class T>
-    nonstd::observer_ptr<T> get_data(
-        std::string name = typeid(T).name())
+    nonstd::observer_ptr<T> get_data()
     {
-        return nonstd::make_observer(dynamic_cast<T*>(_fetch_data(name)));
+        return nonstd::make_observer(dynamic_cast<T*>(_fetch_data(data_slot<T>())));
+    }
+
+    template<class T>
+    nonstd::observer_ptr<T> get_data(std::string name)
+    {
+        return nonstd::make_observer(dynamic_cast<T*>(_fetch_data(register_data_slot(name))));
     }
 
     /* Assigns the given data to the given name */
     template<class T>
-    void store_data(std::unique_ptr<T> stored_data,
-        std::string name = typeid(T).name())
+    void store_data(std::unique_ptr<T> stored_data)
+    {
+        _store_data(std::move(stored_data), data_slot<T>());
+    }
+
+    template<class T>
+    void store_data(std::unique_ptr<T> stored_data, std::string name)
     {
-        _store_data(std::move(stored_data), name);
+        _store_data(std::move(stored_data), register_data_slot(name));
     }
 
     /* Returns true if there is saved data under the given name */
     template<class T>
     bool has_data()
     {
-        return has_data(typeid(T).name());
+        return _fetch_data(data_slot<T>()) != nullptr;
     }
 
     /** @return true if there is saved data with the given name */
@@ -94,22 +113,20 @@ class object_base_t
     template<class T>
     void erase_data()
     {
-        erase_data(typeid(T).name());
+        _erase_data(data_slot<T>());
     }
 
     /* Erase the saved data from the store and return the pointer */
     template<class T>
-    std::unique_ptr<T> release_data(
-        std::string name = typeid(T).name())
+    std::unique_ptr<T> release_data()
     {
-        if (!has_data(name))
-        {
-            return {nullptr};
-        }
-
-        auto stored = _fetch_erase(name);
+        return release_data<T>(data_slot<T>());
+    }
 
-        return std::unique_ptr<T>(dynamic_cast<T*>(stored));
+    template<class T>
+    std::unique_ptr<T> release_data(std::string name)
+    {
+        return release_data<T>(register_data_slot(name));
     }
 
     virtual ~object_base_t();
@@ -126,14 +143,48 @@ class object_base_t
     void _clear_data();
 
   private:
-    /** Just get the data under the given name, or nullptr, if it does not exist */
-    custom_data_t *_fetch_data(std::string name);
-    /** Get the data under the given name, and release the pointer, deleting
-     * the entry in the map */
-    custom_data_t *_fetch_erase(std::string name);
-
-    /** Store the given data under the given name */
-    void _store_data(std::unique_ptr<custom_data_t> data, std::string name);
+    template<class T>
+    static inline uint32_t data_slot()
+    {
+        static const uint32_t slot = register_data_slot(typeid(T).name());
+        return slot;
+    }
+
+    template<class T>
+    nonstd::observer_ptr<T> get_data_safe(uint32_t slot)
+    {
+        if (auto data = dynamic_cast<T*>(_fetch_data(slot)))
+        {
+            return nonstd::make_observer(data);
+        }
+
+        auto data = std::make_unique<T>();
+        auto ptr  = data.get();
+        _store_data(std::move(data), slot);
+        return nonstd::make_observer(ptr);
+    }
+
+    template<class T>
+    std::unique_ptr<T> release_data(uint32_t slot)
+    {
+        if (!_fetch_data(slot))
+        {
+            return {nullptr};
+        }
+
+        return std::unique_ptr<T>(dynamic_cast<T*>(_fetch_erase(slot)));
+    }
+
+    /** Just get the data in the given slot, or nullptr, if it does not exist */
+    custom_data_t *_fetch_data(uint32_t slot);
+    /** Get the data in the given slot, and release the pointer, deleting the entry */
+    custom_data_t *_fetch_erase(uint32_t slot);
+
+    /** Store the given data in the given slot */
+    void _store_data(std::unique_ptr<custom_data_t> data, uint32_t slot);
+
+    /** Remove the data in the given slot */
+    void _erase_data(uint32_t slot);
 
     class obase_impl;
     std::unique_ptr<obase_impl> obase_priv;
@@ -7,6 +7,9 @@
 
 namespace wf
 {
+class frame_profiler_t;
+class frame_arena_t;
+
 /* Effect hooks provide the plugins with a way to execute custom code
  * at certain parts of the repaint cycle */
 using effect_hook_t = std::function<void ()>;
@@ -51,6 +54,23 @@ enum output_effect_type_t
 using post_hook_t = std::function<void (wf::auxilliary_buffer_t& source,
     const wf::render_buffer_t& destination)>;
 
+/**
+ * Flags describing a post hook, see render_manager::add_post().
+ */
+enum post_hook_flags_t
+{
+    /**
+     * Each pixel of the destination depends only on the same pixel of the
+     * source, for example when inverting colors or applying a color transform.
+     *
+     * Such hooks only need to process the damaged parts of the output, which
+     * they can get with render_manager::get_swap_damage(). The rest of the
+     * destination already contains their output from previous frames. If any
+     * hook is not pointwise, the whole output is redrawn each frame.
+     */
+    POST_HOOK_POINTWISE = (1 << 0),
+};
+
 /**
  * The frame-done signal is emitted on an output when the frame has been completed (regardless of whether new
  * content was painted or not).
@@ -112,8 +132,9 @@ class render_manager
      * Add a new post hook.
      *
      * @param hook The hook callback
+     * @param flags A bitmask of post_hook_flags_t describing the hook.
      */
-    void add_post(post_hook_t *hook);
+    void add_post(post_hook_t *hook, uint32_t flags = 0);
 
     /**
      * Remove a post hook. No-op if hook isn't active.
@@ -194,6 +215,18 @@ class render_manager
      */
     void set_require_depth_buffer(bool require);
 
+    /**
+     * Get the frame profiler of the output, which can record a timeline of each repaint.
+     * The profiler is disabled by default.
+     */
+    wf::frame_profiler_t& get_frame_profiler();
+
+    /**
+     * Get the arena for the render instructions of the frame which is currently being rendered. It is reset
+     * after the frame has been submitted, so lists taken from it must not be used after the current frame.
+     */
+    wf::frame_arena_t& get_frame_arena();
+
   public:
     class impl;
     std::unique_ptr<impl> pimpl;
@@ -11,6 +11,8 @@
 namespace wf
 {
 class output_t;
+class frame_profiler_t;
+class frame_arena_t;
 
 /**
  * A simple, non-owning wrapper for a wlr_texture + source box.
@@ -92,6 +94,18 @@ struct render_buffer_t
 struct buffer_allocation_hints_t
 {
     bool needs_alpha = true;
+
+    /**
+     * Who uses the buffer, for example the name of the plugin. Used to show where offscreen memory is used,
+     * see get_aux_buffer_memory_stats().
+     */
+    const char *owner = nullptr;
+
+    /**
+     * Whether the buffer may be allocated at a lower resolution when it does not fit in the offscreen memory
+     * budget. Users of such buffers have to take get_allocation_scale() into account when rendering to them.
+     */
+    bool allow_downscale = false;
 };
 
 /**
@@ -133,6 +147,9 @@ struct auxilliary_buffer_t
      * @param scale The desired scale, so that the final size will be
      *              ceil(width * scale) x ceil(height * scale).
      *
+     * The allocated buffer may be smaller than requested, if the requested size is too large or does not fit
+     * in the offscreen memory budget, see get_allocation_scale().
+     *
      * @return The result of the reallocation operation.
      */
     buffer_reallocation_result_t allocate(wf::dimensions_t size, float scale = 1.0,
@@ -154,6 +171,13 @@ struct auxilliary_buffer_t
      */
     wf::dimensions_t get_size() const;
 
+    /**
+     * Get the scale at which the buffer was allocated relative to the size requested in the last allocate()
+     * call, or 1 if the buffer was allocated with the requested size. The scale is the same for both axes:
+     * the allocated size is the requested size multiplied by it and rounded up.
+     */
+    float get_allocation_scale() const;
+
     /**
      * Get the current buffer and size as a renderbuffer.
      */
@@ -170,8 +194,72 @@ struct auxilliary_buffer_t
 
     // The wlr_texture creating from this framebuffer.
     wlr_texture *texture = NULL;
+
+    // The DRM format of the buffer, so that it can be reused for allocations with the same format.
+    uint32_t drm_format = 0;
+
+    // The size passed to the last successful allocate() call, after applying the scale.
+    wf::dimensions_t requested_size = {0, 0};
+
+    // The scale at which the buffer was allocated, if it was smaller than requested_size.
+    float allocation_scale = 1.0;
+};
+
+/**
+ * Statistics of the pool where freed auxilliary buffers are kept, so that later allocations with the same
+ * size and format can reuse them instead of allocating new buffers.
+ */
+struct aux_buffer_pool_stats_t
+{
+    // Allocations which reused a buffer from the pool.
+    uint64_t hits = 0;
+    // Allocations which needed a new buffer.
+    uint64_t misses = 0;
+    // Buffers dropped from the pool because they were unused for a while or did not fit in the budget.
+    uint64_t evictions = 0;
+    // Buffers currently in the pool, and their approximate size in bytes.
+    uint64_t pooled_buffers = 0;
+    uint64_t pooled_bytes   = 0;
+    // The maximum size of the pool in bytes, see the core/buffer_pool_size option.
+    uint64_t budget_bytes = 0;
+};
+
+/**
+ * Get statistics of the pool of freed auxilliary buffers.
+ */
+aux_buffer_pool_stats_t get_aux_buffer_pool_stats();
+
+/**
+ * An allocated auxilliary buffer.
+ */
+struct aux_buffer_info_t
+{
+    // The owner given in the allocation hints, or "unknown".
+    std::string owner;
+    wf::dimensions_t size;
+    // The approximate size of the buffer in memory.
+    uint64_t bytes;
+};
+
+/**
+ * Memory used by auxilliary buffers.
+ * Buffers kept for reuse are not included, see get_aux_buffer_pool_stats(), but count against the budget.
+ */
+struct aux_buffer_memory_stats_t
+{
+    std::vector<aux_buffer_info_t> buffers;
+    uint64_t total_bytes = 0;
+    // The maximum memory for auxilliary buffers, see the core/buffer_memory_budget option. Zero if unlimited.
+    uint64_t budget_bytes = 0;
+    // Allocations which were made smaller than requested to fit in the budget.
+    uint64_t downscaled_allocations = 0;
 };
 
+/**
+ * Get the memory used by all currently allocated auxilliary buffers.
+ */
+aux_buffer_memory_stats_t get_aux_buffer_memory_stats();
+
 /**
  * A render target contains a render buffer and information on how to map
  * coordinates from the logical coordinate space (output-local coordinates, etc.)
@@ -313,6 +401,20 @@ struct render_pass_params_t
      */
     wlr_buffer_pass_options *pass_opts = nullptr;
 
+    /**
+     * If set, the time each instance spends scheduling and rendering instructions is recorded in the
+     * profiler's current frame.
+     */
+    frame_profiler_t *profiler = nullptr;
+
+    /**
+     * If set, the render instructions are stored in a list taken from the arena, which is reused in the next
+     * frames instead of being allocated anew. The arena must not be reset before the render pass is done.
+     * By default, the arena of the frame which is currently being rendered is used, if any (see
+     * frame_arena_t::get_current()).
+     */
+    frame_arena_t *arena = nullptr;
+
     /**
      * Flags for this render pass, see @render_pass_flags.
      */
@@ -89,7 +89,8 @@ class render_instance_t
      *   auxiliary buffers.
      * @param damage The damaged region of the node, in node-local coordinates.
      *   Nodes may subtract from the damage, to prevent rendering below opaque
-     *   regions, or expand it for certain special effects like blur.
+     *   regions, or expand it for certain special effects like blur. Once the
+     *   damage is empty, the remaining children need not be scheduled.
      */
     virtual void schedule_instructions(
         std::vector<render_instruction_t>& instructions,
@@ -154,6 +155,9 @@ struct node_damage_signal
     wf::region_t region;
 };
 
+// See scene.hpp
+void invalidate_bounding_boxes(node_t *node);
+
 /**
  * A helper function to emit the damage signal on a node.
  */
@@ -162,6 +166,7 @@ inline void damage_node(NodePtr node, wf::region_t damage)
 {
     node_damage_signal data;
     data.region = damage;
+    invalidate_bounding_boxes(&*node);
     node->emit(&data);
 }
 
@@ -201,11 +206,15 @@ class simple_render_instance_t : public render_instance_t
     void schedule_instructions(std::vector<render_instruction_t>& instructions,
         const wf::render_target_t& target, wf::region_t& damage) override
     {
-        instructions.push_back(render_instruction_t{
-                    .instance = this,
-                    .target   = target,
-                    .damage   = damage & self->get_bounding_box(),
-                });
+        wf::region_t our_damage = damage & self->get_bounding_box();
+        if (!our_damage.empty())
+        {
+            instructions.push_back(render_instruction_t{
+                        .instance = this,
+                        .target   = target,
+                        .damage   = std::move(our_damage),
+                    });
+        }
     }
 
   protected:
@@ -229,5 +238,21 @@ struct node_regen_instances_signal
 {};
 
 uint32_t optimize_nested_render_instances(wf::scene::node_ptr node, uint32_t flags);
+
+/**
+ * Regenerate the render instances of a node after a structural change in its subtree.
+ *
+ * @param instances The list of render instances previously generated by node->gen_render_instances() with
+ *   the same @push_damage and @output arguments (or an empty list). It is replaced with the new instances.
+ *
+ * The result is the same as clearing the list and calling node->gen_render_instances(), however, the render
+ * instances of subtrees which did not change structurally (see node_t::get_structure_serial()) are kept and
+ * spliced into the new list. This is possible for all nodes which use the default implementation of
+ * node_t::gen_render_instances() and for output nodes, so typically, only the instances of the changed nodes
+ * are regenerated. Nodes with their own gen_render_instances() are regenerated after every change unless they
+ * declare that they show only their own subtree, see node_t::depends_on_whole_scene().
+ */
+void regen_render_instances(wf::scene::node_ptr node, std::vector<render_instance_uptr>& instances,
+    damage_callback push_damage, wf::output_t *output);
 }
 }
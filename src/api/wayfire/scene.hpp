@@ -284,6 +284,10 @@ class node_t : public std::enable_shared_from_this<node_t>,
      * and does not apply any transformations which may be implemented by the
      * node. It is simply the bounding box of the bounding boxes of the children
      * as reported by their get_bounding_box() method.
+     *
+     * The result is cached until @invalidate_bounding_boxes() is called for the
+     * node or one of its descendants, which core does whenever a node is damaged
+     * or updated.
      */
     wf::geometry_t get_children_bounding_box();
 
@@ -352,6 +356,35 @@ class node_t : public std::enable_shared_from_this<node_t>,
      */
     virtual uint32_t optimize_update(uint32_t update_flags);
 
+    /**
+     * Get the structure serial of the node. It is increased every time a structural update (an update with
+     * the CHILDREN_LIST or ENABLED flags, see @scene::update()) of the node or one of its descendants is
+     * propagated to the node.
+     *
+     * If the serial did not change, the render instances previously generated by the node's subtree are
+     * still valid and can be reused, see @regen_render_instances().
+     */
+    uint64_t get_structure_serial() const
+    {
+        return structure_serial;
+    }
+
+    /**
+     * Whether the render instances of the node may show parts of the scenegraph outside of the node's own
+     * subtree, for example a workspace stream or a view which is rendered elsewhere. The instances of such
+     * nodes are never reused by @regen_render_instances(), they are regenerated after every structural
+     * change of the scenegraph.
+     *
+     * Only nodes which override gen_render_instances() are asked, the default implementation shows only
+     * the node's children. Since core cannot know what custom render instances show, it assumes that they
+     * depend on the whole scene. Nodes whose instances show only the node itself and its children should
+     * return false, so that their instances can be reused.
+     */
+    virtual bool depends_on_whole_scene() const
+    {
+        return true;
+    }
+
   public:
     node_t(const node_t&) = delete;
     node_t(node_t&&) = delete;
@@ -362,8 +395,10 @@ class node_t : public std::enable_shared_from_this<node_t>,
     bool _is_structure;
     int enabled_counter = 1;
     node_t *_parent     = nullptr;
+    uint64_t structure_serial = 0;
     friend class surface_root_node_t;
     friend class floating_inner_node_t;
+    friend void update(node_ptr changed_node, uint32_t flags);
 
     // A helper functions for stringify() implementations, serializes the flags()
     // to a string, e.g. node with KEYBOARD and USER_INPUT -> '(ku)'
@@ -379,6 +414,24 @@ class node_t : public std::enable_shared_from_this<node_t>,
     std::vector<std::shared_ptr<node_t>> children;
 
     void set_children_unchecked(std::vector<node_ptr> new_list);
+
+    /**
+     * A counter which is incremented whenever the geometry of the node's subtree may have changed, i.e.
+     * whenever @invalidate_bounding_boxes() is called for the node or one of its descendants.
+     */
+    uint64_t get_subtree_geometry_serial() const
+    {
+        return subtree_geometry_serial;
+    }
+
+  private:
+    // The cached result of get_children_bounding_box() and whether it is still up to date.
+    wf::geometry_t cached_children_bbox = {0, 0, 0, 0};
+    bool cached_children_bbox_valid     = false;
+    uint64_t subtree_geometry_serial    = 0;
+
+    wf::geometry_t compute_children_bounding_box();
+    friend void invalidate_bounding_boxes(node_t *node);
 };
 
 /**
@@ -389,7 +442,7 @@ class node_t : public std::enable_shared_from_this<node_t>,
 class floating_inner_node_t : public node_t
 {
   public:
-    using node_t::node_t;
+    floating_inner_node_t(bool is_structure);
     ~floating_inner_node_t();
 
     /**
@@ -406,6 +459,33 @@ class floating_inner_node_t : public node_t
      * children is updated, and each child's parent is set to this node.
      */
     bool set_children_list(std::vector<node_ptr> new_list);
+
+    /**
+     * Enable or disable the input index of this node.
+     *
+     * The input index is a spatial index (a uniform grid) of the bounding boxes of the node's children.
+     * When it is enabled, find_node_at() only considers children whose bounding box contains the queried
+     * point (children with an empty bounding box are always considered), which makes hit-testing scale
+     * with the number of children under the point instead of the total number of children.
+     *
+     * The index is rebuilt lazily after the children change, after a child is damaged (see damage_node()),
+     * or after a wf::scene::update() with the CHILDREN_LIST, ENABLED, GEOMETRY or INPUT_STATE flags is
+     * propagated through this node, which covers all changes to the children's bounding boxes.
+     *
+     * Note that with the index, a child is found only at points inside its bounding box. Children which
+     * accept input outside of their bounding box are found there only if their bounding box is empty.
+     *
+     * By default, the index is disabled.
+     */
+    void set_input_index_enabled(bool enabled);
+
+    std::optional<input_node_t> find_node_at(const wf::pointf_t& at) override;
+
+  private:
+    struct input_index_t;
+    std::unique_ptr<input_index_t> input_index;
+
+    friend void update(node_ptr changed_node, uint32_t flags);
 };
 using floating_inner_ptr = std::shared_ptr<floating_inner_node_t>;
 
@@ -524,5 +604,15 @@ void set_node_enabled(wf::scene::node_ptr node, bool enabled);
  * @param flags A bit mask consisting of flags defined in the @update_flag enum.
  */
 void update(node_ptr changed_node, uint32_t flags);
+
+/**
+ * Mark the cached bounding boxes of @node and its ancestors as stale (see
+ * node_t::get_children_bounding_box()).
+ *
+ * Core calls this whenever a node is damaged (damage_node()), updated (scene::update()), or when a node's
+ * children change. Plugins need to call it only if they change the bounding box of a node without doing
+ * any of the above.
+ */
+void invalidate_bounding_boxes(node_t *node);
 }
 } // namespace wf
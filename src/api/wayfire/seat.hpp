@@ -32,6 +32,20 @@ struct keyboard_focus_changed_signal
 struct seat_activity_signal
 {};
 
+/**
+ * Counters for the processing of pointer motion, see the input/pointer_motion_coalescing option.
+ */
+struct pointer_motion_stats_t
+{
+    // Motion events received from pointer devices.
+    uint64_t motion_events = 0;
+    // Motion events which did not update the pointer focus on their own, because they were merged into a
+    // later update.
+    uint64_t coalesced_events = 0;
+    // How often the node under the cursor was looked up and the pointer focus updated, for any reason.
+    uint64_t focus_updates = 0;
+};
+
 /**
  * A seat represents a group of input devices (mouse, keyboard, etc.) which logically belong together.
  * Each seat has its own keyboard, touch, pointer and tablet focus.
@@ -127,6 +141,11 @@ class seat_t
      */
     void notify_activity();
 
+    /**
+     * Get the counters for pointer motion processing.
+     */
+    pointer_motion_stats_t get_pointer_motion_stats() const;
+
     /**
      * Create and initialize a new seat.
      */
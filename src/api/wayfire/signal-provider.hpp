@@ -3,7 +3,9 @@
 #include <functional>
 #include <memory>
 #include <cassert>
+#include <cstdint>
 #include <typeindex>
+#include <vector>
 
 namespace wf
 {
@@ -117,6 +119,14 @@ class connection_t final : public connection_base_t
     callback current_callback;
 };
 
+/**
+ * Get a small integer id for the given signal type.
+ *
+ * The ids are assigned by core on first use, so that they are the same in core and in all plugins, even if
+ * the signal type is instantiated in several shared objects.
+ */
+uint32_t register_signal_type(std::type_index type);
+
 class provider_t
 {
   public:
@@ -134,22 +144,39 @@ class provider_t
     template<class SignalType>
     void connect(connection_t<SignalType> *callback)
     {
-        connect_base(index<SignalType>(), callback);
+        connect_base(type_id<SignalType>(), callback);
     }
 
     /** Unregister a connection. */
     void disconnect(connection_base_t *callback);
 
-    /** Emit the given signal. */
+    /**
+     * Emit the given signal.
+     *
+     * Connections may be added or removed while the signal is being emitted. Removed connections are not
+     * called anymore, connections added during the emission are called starting with the next emission.
+     */
     template<class SignalType>
     void emit(SignalType *data)
     {
-        this->for_each_connection(index<SignalType>(), [&] (connection_base_t *tc)
+        connection_list_t *list = find_connections(type_id<SignalType>());
+        if (!list)
+        {
+            return;
+        }
+
+        ++list->iterating;
+        const size_t count = list->connections.size();
+        for (size_t i = 0; i < count; i++)
         {
-            auto real_type = dynamic_cast<connection_t<SignalType>*>(tc);
-            assert(real_type);
-            real_type->emit(data);
-        });
+            // Connections are stored only in the list of their own signal type, see connect().
+            if (auto conn = list->connections[i])
+            {
+                static_cast<connection_t<SignalType>*>(conn)->emit(data);
+            }
+        }
+
+        finish_iteration(list);
     }
 
     provider_t();
@@ -165,13 +192,27 @@ class provider_t
 
   private:
     template<class SignalType>
-    static inline std::type_index index()
+    static inline uint32_t type_id()
     {
-        return std::type_index(typeid(SignalType));
+        static const uint32_t id = register_signal_type(typeid(SignalType));
+        return id;
     }
 
-    void connect_base(std::type_index type, connection_base_t *callback);
-    void for_each_connection(std::type_index type, std::function<void(connection_base_t*)> func);
+    /**
+     * The connections of a single signal type. While the list is being iterated, removed connections are
+     * replaced by nullptr, and erased when the iteration is over.
+     */
+    struct connection_list_t
+    {
+        uint32_t type_id;
+        std::vector<connection_base_t*> connections;
+        int iterating = 0;
+        bool needs_cleanup = false;
+    };
+
+    void connect_base(uint32_t type_id, connection_base_t *callback);
+    connection_list_t *find_connections(uint32_t type_id);
+    void finish_iteration(connection_list_t *list);
     void disconnect_other_side(connection_base_t *callback);
 
     struct impl;
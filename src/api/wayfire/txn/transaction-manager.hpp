@@ -40,6 +40,20 @@ class transaction_manager_t : public signal::provider_t
      */
     void schedule_object(transaction_object_sptr object);
 
+    /**
+     * Start a batch of transactions. Until the matching end_batch() call, all scheduled transactions are
+     * merged into a single transaction, so that their objects are applied atomically. The merged transaction
+     * is scheduled when the outermost batch ends.
+     *
+     * Batches may be nested, each begin_batch() call has to be paired with a call to end_batch().
+     */
+    void begin_batch();
+
+    /**
+     * End a batch started with begin_batch().
+     */
+    void end_batch();
+
     /**
      * Check whether there is a pending transaction for the given object.
      */
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <wayfire/signal-provider.hpp>
+#include <cstdint>
 #include <string>
 #include <memory>
 
@@ -8,6 +9,46 @@ namespace wf
 {
 namespace txn
 {
+class transaction_t;
+
+/**
+ * Statistics about how fast a transaction object becomes ready after it has been committed. They are updated
+ * by the transactions the object participates in.
+ */
+struct readiness_stats_t
+{
+    // The number of transactions in which the object was committed.
+    uint64_t commits = 0;
+
+    // The number of transactions which timed out before the object became ready.
+    uint64_t timeouts = 0;
+
+    // The number of transactions in a row which timed out before the object became ready.
+    // Reset as soon as the object becomes ready in time again.
+    uint32_t consecutive_timeouts = 0;
+
+    // The number of transactions which were applied without waiting for the object, because it was slow.
+    uint64_t skipped = 0;
+
+    // The number of transactions in a row which did not wait for the object.
+    uint32_t consecutive_skipped = 0;
+
+    // The time between commit and ready, in microseconds, for the last time the object became ready, the
+    // maximum and a moving average.
+    int64_t last_latency_us    = 0;
+    int64_t max_latency_us     = 0;
+    int64_t average_latency_us = 0;
+
+    // Slow objects are waited for again after they have been skipped this many times in a row.
+    static constexpr uint32_t MAX_CONSECUTIVE_SKIPPED = 10;
+
+    /**
+     * Check whether transactions should not wait for the object, because it timed out in at least
+     * @consecutive_timeouts transactions in a row. 0 means that transactions always wait for the object.
+     */
+    bool is_slow(uint32_t consecutive_timeouts) const;
+};
+
 /**
  * A transaction object participates in the transactions system.
  *
@@ -45,7 +86,19 @@ class transaction_object_t : public signal::provider_t
      */
     virtual void apply() = 0;
 
+    /**
+     * Get statistics about how fast the object became ready in the transactions it participated in.
+     */
+    const readiness_stats_t& get_readiness_stats() const;
+
     virtual ~transaction_object_t() = default;
+
+  private:
+    friend class transaction_t;
+    readiness_stats_t readiness_stats;
+
+    // Set while the object is committed in a transaction and has not become ready yet.
+    bool awaiting_ready = false;
 };
 
 using transaction_object_sptr = std::shared_ptr<transaction_object_t>;
@@ -3,6 +3,8 @@
 #include "wayfire/signal-provider.hpp"
 #include "wayfire/util.hpp"
 #include <wayfire/txn/transaction-object.hpp>
+#include <chrono>
+#include <unordered_set>
 
 namespace wf
 {
@@ -39,6 +41,11 @@ class transaction_t : public signal::provider_t
      */
     void add_object(transaction_object_sptr object);
 
+    /**
+     * Check whether the given object is part of the transaction.
+     */
+    bool has_object(const transaction_object_sptr& object) const;
+
     /**
      * Get a list of all the objects currently part of the transaction.
      */
@@ -50,14 +57,42 @@ class transaction_t : public signal::provider_t
      */
     void commit();
 
+    /**
+     * Stop waiting for objects which timed out in the given number of transactions in a row. Such objects
+     * are still committed and applied together with the others, but the transaction is applied as soon as
+     * all other objects are ready, so that a single unresponsive client does not hold up everything else.
+     * Every few transactions, slow objects are waited for again, so that they can recover.
+     *
+     * Has to be set before the transaction is committed.
+     *
+     * @param consecutive_timeouts The number of timeouts after which an object is considered slow, or 0 to
+     *   always wait for all objects (the default).
+     */
+    void set_slow_object_threshold(uint32_t consecutive_timeouts);
+
     virtual ~transaction_t() = default;
 
   private:
     std::vector<transaction_object_sptr> objects;
+
+    // Small transactions are searched linearly. Once a transaction has more objects, they are also indexed,
+    // so that merging large transactions does not take quadratic time. The index is built lazily.
+    static constexpr size_t MAX_UNINDEXED_OBJECTS = 256;
+    mutable std::unordered_set<transaction_object_t*> object_index;
+
     int count_ready_objects = 0;
     uint64_t timeout;
     timer_setter_t timer_setter;
 
+    uint32_t slow_object_threshold = 0;
+    // The number of objects the transaction still waits for before it can be applied.
+    int count_waiting_objects = 0;
+    // Slow objects which have not become ready yet, but are not waited for.
+    std::vector<transaction_object_t*> skipped_objects;
+    std::chrono::steady_clock::time_point commit_time;
+
+    bool is_slow(const transaction_object_t *object) const;
+    void record_ready(transaction_object_t *object);
     void apply(bool did_timeout);
     wf::signal::connection_t<object_ready_signal> on_object_ready;
 };
@@ -35,6 +35,7 @@ class translation_node_t : public wf::scene::floating_inner_node_t
         scene::damage_callback damage, wf::output_t *output) override;
     wf::geometry_t get_bounding_box() override;
     uint32_t optimize_update(uint32_t flags) override;
+    bool depends_on_whole_scene() const override;
 
   protected:
     wf::point_t offset = {0, 0};
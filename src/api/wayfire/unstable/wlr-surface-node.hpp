@@ -66,6 +66,7 @@ class wlr_surface_node_t : public node_t, public zero_copy_texturable_node_t
     void gen_render_instances(std::vector<render_instance_uptr>& instances, damage_callback damage,
         wf::output_t *output) override;
     wf::geometry_t get_bounding_box() override;
+    bool depends_on_whole_scene() const override;
     std::optional<wf::texture_t> to_texture() const override;
 
     wlr_surface *get_surface() const;
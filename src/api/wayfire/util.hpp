@@ -13,6 +13,9 @@ int64_t timespec_to_msec(const timespec& ts);
 /** Returns current time in msec, using CLOCK_MONOTONIC as a base */
 int64_t get_current_time();
 
+/** Returns current time in nsec, using CLOCK_MONOTONIC as a base */
+int64_t get_current_time_ns();
+
 /**
  * A wrapper around wl_listener compatible with C++11 std::functions
  */
@@ -52,6 +52,8 @@ class transformer_base_node_t : public scene::floating_inner_node_t
     using floating_inner_node_t::floating_inner_node_t;
 
     uint32_t optimize_update(uint32_t flags) override;
+    // Transformers show only their children.
+    bool depends_on_whole_scene() const override;
 
     // A temporary buffer to render children to.
     wf::auxilliary_buffer_t inner_content;
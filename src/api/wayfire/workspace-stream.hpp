@@ -33,6 +33,8 @@ class workspace_stream_node_t : public scene::node_t
     // The bounding box of a workspace stream is
     // (0, 0, output_width, output_height).
     wf::geometry_t get_bounding_box() override;
+    // The stream shows the children of the output's nodes.
+    bool depends_on_whole_scene() const override;
     class workspace_stream_instance_t;
 
   private:
@@ -99,6 +99,9 @@ class compositor_core_impl_t : public compositor_core_t
 compositor_core_impl_t& get_core_impl();
 
 void priv_output_layout_fini(wf::output_layout_t *layout);
+
+/** Free the auxilliary buffers kept for reuse. Buffers freed afterwards are not kept anymore. */
+void priv_aux_buffer_pool_fini();
 }
 
 #endif /* end of include guard: WF_CORE_CORE_IMPL_HPP */
@@ -361,6 +361,7 @@ void wf::compositor_core_impl_t::fini()
     input.reset();
     output_layout.reset();
     tx_manager.reset();
+    priv_aux_buffer_pool_fini();
     OpenGL::fini();
     disconnect_signals();
     wl_display_destroy(static_core->display);
@@ -502,6 +503,11 @@ std::vector<wayfire_view> wf::compositor_core_t::get_all_views()
     return wf::tracking_allocator_t<view_interface_t>::get().get_all();
 }
 
+wf::tracking_allocator_t<wf::view_interface_t>::range_t wf::compositor_core_t::get_all_views_range()
+{
+    return wf::tracking_allocator_t<view_interface_t>::get().get_range();
+}
+
 /**
  * Upon successful execution, returns the PID of the child process.
  * Returns 0 in case of failure.
@@ -1,11 +1,21 @@
 #include "wayfire/object.hpp"
 #include <unordered_map>
 #include <wayfire/signal-provider.hpp>
-#include <wayfire/nonstd/safe-list.hpp>
+#include <algorithm>
+
+uint32_t wf::signal::register_signal_type(std::type_index type)
+{
+    static std::unordered_map<std::type_index, uint32_t> ids;
+    auto it = ids.try_emplace(type, ids.size()).first;
+    return it->second;
+}
 
 struct wf::signal::provider_t::impl
 {
-    std::unordered_map<std::type_index, wf::safe_list_t<connection_base_t*>> typed_connections;
+    // Typically, only a handful of signal types are connected on a single provider, so a linear search
+    // is faster than a hash map. The lists are stored as pointers, so that they remain valid while
+    // connections for new signal types are added during an emission.
+    std::vector<std::unique_ptr<connection_list_t>> typed_connections;
 };
 
 wf::signal::provider_t::provider_t()
@@ -15,9 +25,15 @@ wf::signal::provider_t::provider_t()
 
 wf::signal::provider_t::~provider_t()
 {
-    for (auto& [id, connected] : priv->typed_connections)
+    for (auto& list : priv->typed_connections)
     {
-        connected.for_each([&] (connection_base_t *base) { disconnect_other_side(base); });
+        for (auto& conn : list->connections)
+        {
+            if (conn)
+            {
+                disconnect_other_side(conn);
+            }
+        }
     }
 }
 
@@ -27,16 +43,42 @@ void wf::signal::provider_t::disconnect_other_side(connection_base_t *callback)
     callback->connected_to.erase(it, callback->connected_to.end());
 }
 
-void wf::signal::provider_t::connect_base(std::type_index idx, connection_base_t *callback)
+wf::signal::provider_t::connection_list_t*wf::signal::provider_t::find_connections(uint32_t type_id)
+{
+    for (auto& list : priv->typed_connections)
+    {
+        if (list->type_id == type_id)
+        {
+            return list.get();
+        }
+    }
+
+    return nullptr;
+}
+
+void wf::signal::provider_t::connect_base(uint32_t type_id, connection_base_t *callback)
 {
-    priv->typed_connections[idx].push_back(callback);
+    auto list = find_connections(type_id);
+    if (!list)
+    {
+        priv->typed_connections.push_back(std::make_unique<connection_list_t>());
+        list = priv->typed_connections.back().get();
+        list->type_id = type_id;
+    }
+
+    list->connections.push_back(callback);
     callback->connected_to.push_back(this);
 }
 
-void wf::signal::provider_t::for_each_connection(
-    std::type_index type, std::function<void(connection_base_t*)> func)
+void wf::signal::provider_t::finish_iteration(connection_list_t *list)
 {
-    priv->typed_connections[type].for_each(func);
+    --list->iterating;
+    if ((list->iterating == 0) && list->needs_cleanup)
+    {
+        auto it = std::remove(list->connections.begin(), list->connections.end(), nullptr);
+        list->connections.erase(it, list->connections.end());
+        list->needs_cleanup = false;
+    }
 }
 
 void wf::signal::connection_base_t::disconnect()
@@ -51,17 +93,54 @@ void wf::signal::connection_base_t::disconnect()
 void wf::signal::provider_t::disconnect(connection_base_t *callback)
 {
     disconnect_other_side(callback);
-    for (auto& [id, connected] : priv->typed_connections)
+    for (auto& list : priv->typed_connections)
     {
-        connected.remove_all(callback);
+        if (list->iterating)
+        {
+            std::replace(list->connections.begin(), list->connections.end(), callback,
+                (connection_base_t*)nullptr);
+            list->needs_cleanup = true;
+        } else
+        {
+            auto it = std::remove(list->connections.begin(), list->connections.end(), callback);
+            list->connections.erase(it, list->connections.end());
+        }
     }
 }
 
+uint32_t wf::register_data_slot(const std::string& name)
+{
+    static std::unordered_map<std::string, uint32_t> slots;
+    auto it = slots.try_emplace(name, slots.size()).first;
+    return it->second;
+}
+
 class wf::object_base_t::obase_impl
 {
   public:
-    std::unordered_map<std::string, std::unique_ptr<custom_data_t>> data;
+    struct data_entry_t
+    {
+        uint32_t slot;
+        std::unique_ptr<custom_data_t> data;
+    };
+
+    // Objects typically carry only a handful of data entries, so a linear search over the slot ids is faster
+    // than a hash map, and does not need to hash a string per lookup.
+    std::vector<data_entry_t> data;
     uint32_t object_id;
+
+    data_entry_t *find(uint32_t slot)
+    {
+        for (auto& entry : data)
+        {
+            if (entry.slot == slot)
+            {
+                return &entry;
+            }
+        }
+
+        return nullptr;
+    }
 };
 
 wf::object_base_t::object_base_t()
@@ -86,56 +165,70 @@ uint32_t wf::object_base_t::get_id() const
 
 bool wf::object_base_t::has_data(std::string name)
 {
-    return _fetch_data(name) != nullptr;
+    return _fetch_data(register_data_slot(name)) != nullptr;
 }
 
 void wf::object_base_t::erase_data(std::string name)
 {
-    if (!has_data(name))
+    _erase_data(register_data_slot(name));
+}
+
+void wf::object_base_t::_erase_data(uint32_t slot)
+{
+    auto entry = obase_priv->find(slot);
+    if (!entry)
     {
         return;
     }
 
-    auto data = std::move(obase_priv->data[name]);
-    obase_priv->data.erase(name);
+    // Remove the entry before destroying the data, in case the destructor accesses the object's data.
+    auto data = std::move(entry->data);
+    *entry = std::move(obase_priv->data.back());
+    obase_priv->data.pop_back();
     data.reset();
 }
 
-wf::custom_data_t*wf::object_base_t::_fetch_data(std::string name)
+wf::custom_data_t*wf::object_base_t::_fetch_data(uint32_t slot)
 {
-    auto it = obase_priv->data.find(name);
-    if (it == obase_priv->data.end())
-    {
-        return nullptr;
-    }
-
-    return it->second.get();
+    auto entry = obase_priv->find(slot);
+    return entry ? entry->data.get() : nullptr;
 }
 
-wf::custom_data_t*wf::object_base_t::_fetch_erase(std::string name)
+wf::custom_data_t*wf::object_base_t::_fetch_erase(uint32_t slot)
 {
-    auto data = obase_priv->data[name].release();
-    erase_data(name);
+    auto entry = obase_priv->find(slot);
+    if (!entry)
+    {
+        return nullptr;
+    }
 
+    auto data = entry->data.release();
+    *entry = std::move(obase_priv->data.back());
+    obase_priv->data.pop_back();
     return data;
 }
 
-void wf::object_base_t::_store_data(std::unique_ptr<wf::custom_data_t> data,
-    std::string name)
+void wf::object_base_t::_store_data(std::unique_ptr<wf::custom_data_t> data, uint32_t slot)
 {
-    obase_priv->data[name] = std::move(data);
+    if (auto entry = obase_priv->find(slot))
+    {
+        entry->data = std::move(data);
+    } else
+    {
+        obase_priv->data.push_back({slot, std::move(data)});
+    }
 }
 
 void wf::object_base_t::_clear_data()
 {
-    std::vector<std::string> keys;
-    for (auto const& [key, val] : obase_priv->data)
+    std::vector<uint32_t> slots;
+    for (auto const& entry : obase_priv->data)
     {
-        keys.push_back(key);
+        slots.push_back(entry.slot);
     }
 
-    for (const auto& key : keys)
+    for (const auto& slot : slots)
     {
-        erase_data(key);
+        _erase_data(slot);
     }
 }
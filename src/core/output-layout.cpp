@@ -9,6 +9,7 @@
 #include "wayfire/config-backend.hpp"
 
 #include "../output/output-impl.hpp"
+#include "output-mirror.hpp"
 #include <xf86drmMode.h>
 #include <cstring>
 #include <climits>
@@ -342,6 +343,7 @@ struct output_layout_output_t
     wf::option_wrapper_t<std::string> transform_opt;
     wf::option_wrapper_t<bool> vrr_opt;
     wf::option_wrapper_t<int> depth_opt;
+    wf::option_wrapper_t<bool> mirror_letterbox_opt;
 
     wf::option_wrapper_t<bool> use_ext_config{
         "workarounds/use_external_output_configuration"};
@@ -356,6 +358,7 @@ struct output_layout_output_t
         transform_opt.load_option(name + "/transform");
         vrr_opt.load_option(name + "/vrr");
         depth_opt.load_option(name + "/depth");
+        mirror_letterbox_opt.load_option(name + "/mirror_letterbox");
     }
 
     output_layout_output_t(wlr_output *handle)
@@ -739,67 +742,7 @@ struct output_layout_output_t
     }
 
     /* Mirroring implementation */
-    wl_listener_wrapper on_mirrored_frame;
-    wl_listener_wrapper on_frame;
-    wlr_output *locked_cursors_on = NULL;
-
-    /** Render the output using texture as source */
-    void render_output(wlr_texture *texture)
-    {
-        // TODO: use render-manager's functions, apply gamma, use our normal pass functions.
-        struct wlr_render_pass *pass = wlr_output_begin_render_pass(handle, &pending_state.pending, NULL);
-        if (pass == NULL)
-        {
-            return;
-        }
-
-        // Render other output as a fullscreen texture.
-        wlr_render_texture_options opts{};
-        opts.texture = texture;
-        opts.alpha   = NULL;
-        opts.blend_mode  = WLR_RENDER_BLEND_MODE_NONE;
-        opts.filter_mode = WLR_SCALE_FILTER_BILINEAR;
-        opts.clip    = NULL;
-        opts.src_box = {0, 0, 0, 0};
-        opts.dst_box = {0, 0, handle->width, handle->height};
-        opts.transform = WL_OUTPUT_TRANSFORM_NORMAL;
-        wlr_render_pass_add_texture(pass, &opts);
-
-        wlr_render_pass_submit(pass);
-        pending_state.commit(handle);
-    }
-
-    /* Load output contents and render them */
-    wlr_buffer *source_back_buffer = NULL;
-
-    void handle_frame()
-    {
-        auto wo = get_core().output_layout->find_output(
-            current_state.mirror_from);
-        if (!wo)
-        {
-            LOGE("Cannot find mirrored output ", current_state.mirror_from,
-                " for output ", handle->name);
-
-            return;
-        }
-
-        if (source_back_buffer == NULL)
-        {
-            LOGE("Got empty buffer on ", wo->handle->name);
-            return;
-        }
-
-        auto texture = wlr_texture_from_buffer(get_core().renderer, source_back_buffer);
-        if (!texture)
-        {
-            LOGE("Failed to export texture to dmabuf!");
-            return;
-        }
-
-        render_output(texture);
-        wlr_texture_destroy(texture);
-    }
+    std::unique_ptr<wf::output_mirror_t> mirror;
 
     void set_enabled(bool enabled)
     {
@@ -840,58 +783,12 @@ struct output_layout_output_t
             return;
         }
 
-        /* Force software cursors on the mirrored from output.
-         * This ensures that they will be copied when reading pixels
-         * from the main plane */
-        wlr_output_lock_software_cursors(wo->handle, true);
-        locked_cursors_on = wo->handle;
-
-        wlr_output_schedule_frame(handle);
-        on_mirrored_frame.set_callback([=] (void *data)
-        {
-            auto ev = (wlr_output_event_commit*)data;
-            if (!ev || !ev->state || !ev->state->buffer)
-            {
-                return;
-            }
-
-            if (ev->state->buffer)
-            {
-                if (source_back_buffer)
-                {
-                    wlr_buffer_unlock(source_back_buffer);
-                }
-
-                source_back_buffer = ev->state->buffer;
-                wlr_buffer_lock(ev->state->buffer);
-            }
-
-            /* The mirrored output was repainted, schedule repaint
-             * for us as well */
-            wlr_output_schedule_frame(handle);
-        });
-        on_mirrored_frame.connect(&wo->handle->events.commit);
-
-        on_frame.set_callback([=] (void*) { handle_frame(); });
-        on_frame.connect(&handle->events.frame);
+        mirror = std::make_unique<wf::output_mirror_t>(handle, wo->handle, mirror_letterbox_opt);
     }
 
     void teardown_mirror()
     {
-        if (locked_cursors_on)
-        {
-            wlr_output_lock_software_cursors(locked_cursors_on, false);
-            locked_cursors_on = NULL;
-        }
-
-        if (source_back_buffer)
-        {
-            wlr_buffer_unlock(source_back_buffer);
-            source_back_buffer = NULL;
-        }
-
-        on_mirrored_frame.disconnect();
-        on_frame.disconnect();
+        mirror.reset();
     }
 
     wf::dimensions_t get_effective_size()
@@ -0,0 +1,252 @@
+#include "output-mirror.hpp"
+#include <algorithm>
+#include <cmath>
+#include <wayfire/core.hpp>
+#include <wayfire/debug.hpp>
+#include <wayfire/util/log.hpp>
+
+wf::geometry_t wf::get_mirror_destination_box(wf::dimensions_t source, wf::dimensions_t mirror,
+    bool letterbox)
+{
+    wf::geometry_t full = {0, 0, mirror.width, mirror.height};
+    if (!letterbox || (source.width <= 0) || (source.height <= 0))
+    {
+        return full;
+    }
+
+    const double scale = std::min(1.0 * mirror.width / source.width, 1.0 * mirror.height / source.height);
+    const int width    = std::min(mirror.width, (int)std::round(source.width * scale));
+    const int height   = std::min(mirror.height, (int)std::round(source.height * scale));
+    return {(mirror.width - width) / 2, (mirror.height - height) / 2, width, height};
+}
+
+wf::region_t wf::get_mirror_damage(const wf::region_t& source_damage, wf::dimensions_t source,
+    wf::geometry_t destination)
+{
+    wf::region_t result;
+    if ((source.width <= 0) || (source.height <= 0))
+    {
+        return result;
+    }
+
+    const auto scale_x = [&] (int x) { return 1.0 * x * destination.width / source.width; };
+    const auto scale_y = [&] (int y) { return 1.0 * y * destination.height / source.height; };
+    for (const auto& box : source_damage)
+    {
+        // Grow by a pixel on each side, since bilinear filtering blends in the neighboring pixels.
+        const int x1 = destination.x + (int)std::floor(scale_x(box.x1)) - 1;
+        const int y1 = destination.y + (int)std::floor(scale_y(box.y1)) - 1;
+        const int x2 = destination.x + (int)std::ceil(scale_x(box.x2)) + 1;
+        const int y2 = destination.y + (int)std::ceil(scale_y(box.y2)) + 1;
+        result |= wf::geometry_t{x1, y1, x2 - x1, y2 - y1};
+    }
+
+    return result & destination;
+}
+
+wf::output_mirror_t::output_mirror_t(wlr_output *mirror, wlr_output *source, bool letterbox)
+{
+    this->mirror    = mirror;
+    this->source    = source;
+    this->letterbox = letterbox;
+    wlr_damage_ring_init(&damage_ring);
+
+    /* Force software cursors on the mirrored from output.
+     * This ensures that they will be copied when reading pixels
+     * from the main plane */
+    wlr_output_lock_software_cursors(source, true);
+
+    on_source_commit.set_callback([=] (void *data)
+    {
+        handle_source_commit(static_cast<wlr_output_event_commit*>(data));
+    });
+    on_source_commit.connect(&source->events.commit);
+
+    on_source_destroy.set_callback([=] (void*)
+    {
+        on_source_commit.disconnect();
+        on_source_destroy.disconnect();
+        this->source = NULL;
+    });
+    on_source_destroy.connect(&source->events.destroy);
+
+    on_mirror_commit.set_callback([=] (void *data)
+    {
+        auto ev = static_cast<wlr_output_event_commit*>(data);
+        if (ev->state->committed & (WLR_OUTPUT_STATE_MODE | WLR_OUTPUT_STATE_ENABLED))
+        {
+            damage_whole();
+        }
+    });
+    on_mirror_commit.connect(&mirror->events.commit);
+
+    on_frame.set_callback([=] (void*) { render_frame(); });
+    on_frame.connect(&mirror->events.frame);
+
+    on_needs_frame.set_callback([=] (void*) { wlr_output_schedule_frame(this->mirror); });
+    on_needs_frame.connect(&mirror->events.needs_frame);
+
+    on_gamma_changed.set_callback([=] (void *data)
+    {
+        auto event = (const wlr_gamma_control_manager_v1_set_gamma_event*)data;
+        if (event->output == this->mirror)
+        {
+            pending_gamma_lut = true;
+            wlr_output_schedule_frame(this->mirror);
+        }
+    });
+    on_gamma_changed.connect(&wf::get_core().protocols.gamma_v1->events.set_gamma);
+
+    damage_whole();
+}
+
+wf::output_mirror_t::~output_mirror_t()
+{
+    if (source)
+    {
+        wlr_output_lock_software_cursors(source, false);
+    }
+
+    if (source_buffer)
+    {
+        wlr_buffer_unlock(source_buffer);
+    }
+
+    wlr_damage_ring_finish(&damage_ring);
+}
+
+wf::dimensions_t wf::output_mirror_t::get_source_size() const
+{
+    return {source_buffer->width, source_buffer->height};
+}
+
+wf::dimensions_t wf::output_mirror_t::get_mirror_size() const
+{
+    return {mirror->width, mirror->height};
+}
+
+void wf::output_mirror_t::damage_whole()
+{
+    wlr_box box = {0, 0, mirror->width, mirror->height};
+    wlr_damage_ring_add_box(&damage_ring, &box);
+    wlr_output_schedule_frame(mirror);
+}
+
+void wf::output_mirror_t::handle_source_commit(wlr_output_event_commit *ev)
+{
+    if (!ev || !ev->state || !(ev->state->committed & WLR_OUTPUT_STATE_BUFFER) || !ev->state->buffer)
+    {
+        return;
+    }
+
+    auto buffer = ev->state->buffer;
+    const bool same_size = source_buffer && (source_buffer->width == buffer->width) &&
+        (source_buffer->height == buffer->height);
+
+    wlr_buffer_lock(buffer);
+    if (source_buffer)
+    {
+        wlr_buffer_unlock(source_buffer);
+    }
+
+    source_buffer = buffer;
+    if (!same_size || !(ev->state->committed & WLR_OUTPUT_STATE_DAMAGE))
+    {
+        damage_whole();
+        return;
+    }
+
+    auto destination = get_mirror_destination_box(get_source_size(), get_mirror_size(), letterbox);
+    auto damage = get_mirror_damage(wf::region_t{&ev->state->damage}, get_source_size(), destination);
+    if (!damage.empty())
+    {
+        wlr_damage_ring_add(&damage_ring, damage.to_pixman());
+        wlr_output_schedule_frame(mirror);
+    }
+}
+
+void wf::output_mirror_t::render_frame()
+{
+    pixman_region32_intersect_rect(&damage_ring.current, &damage_ring.current,
+        0, 0, mirror->width, mirror->height);
+    const bool needs_swap = mirror->needs_frame || pending_gamma_lut ||
+        pixman_region32_not_empty(&damage_ring.current);
+
+    // Nothing changed on the source output since the last frame.
+    if (!source_buffer || !needs_swap)
+    {
+        return;
+    }
+
+    auto texture = wlr_texture_from_buffer(wf::get_core().renderer, source_buffer);
+    if (!texture)
+    {
+        LOGE("Failed to import the source buffer of mirrored output ", nonull(mirror->name));
+        return;
+    }
+
+    wlr_output_state state;
+    wlr_output_state_init(&state);
+    if (pending_gamma_lut)
+    {
+        pending_gamma_lut = false;
+        auto gamma_control =
+            wlr_gamma_control_manager_v1_get_control(wf::get_core().protocols.gamma_v1, mirror);
+        if (!wlr_gamma_control_v1_apply(gamma_control, &state))
+        {
+            LOGE("Failed to apply gamma to output state!");
+        } else if (!wlr_output_test_state(mirror, &state))
+        {
+            wlr_gamma_control_v1_send_failed_and_destroy(gamma_control);
+        }
+    }
+
+    auto pass = wlr_output_begin_render_pass(mirror, &state, NULL);
+    if (!pass)
+    {
+        wlr_output_state_finish(&state);
+        wlr_texture_destroy(texture);
+        return;
+    }
+
+    // The parts of the buffer which changed since it was last shown.
+    wf::region_t damage;
+    wlr_damage_ring_rotate_buffer(&damage_ring, state.buffer, damage.to_pixman());
+    damage &= wf::geometry_t{0, 0, mirror->width, mirror->height};
+
+    auto destination = get_mirror_destination_box(get_source_size(), get_mirror_size(), letterbox);
+    wf::region_t bars = damage ^ destination;
+    if (!bars.empty())
+    {
+        wlr_render_rect_options bar_opts{};
+        bar_opts.box   = {0, 0, mirror->width, mirror->height};
+        bar_opts.color = {0, 0, 0, 1};
+        bar_opts.clip  = bars.to_pixman();
+        bar_opts.blend_mode = WLR_RENDER_BLEND_MODE_NONE;
+        wlr_render_pass_add_rect(pass, &bar_opts);
+    }
+
+    wf::region_t contents = damage & destination;
+    if (!contents.empty())
+    {
+        wlr_render_texture_options opts{};
+        opts.texture     = texture;
+        opts.blend_mode  = WLR_RENDER_BLEND_MODE_NONE;
+        opts.filter_mode = WLR_SCALE_FILTER_BILINEAR;
+        opts.clip    = contents.to_pixman();
+        opts.src_box = {0, 0, 0, 0};
+        opts.dst_box = destination;
+        opts.transform = WL_OUTPUT_TRANSFORM_NORMAL;
+        wlr_render_pass_add_texture(pass, &opts);
+    }
+
+    wlr_render_pass_submit(pass);
+    wlr_output_state_set_damage(&state, damage.to_pixman());
+    if (!wlr_output_commit_state(mirror, &state))
+    {
+        LOGE("Failed to commit mirrored output ", nonull(mirror->name));
+    }
+
+    wlr_output_state_finish(&state);
+    wlr_texture_destroy(texture);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <wayfire/geometry.hpp>
+#include <wayfire/region.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+
+namespace wf
+{
+/**
+ * Find the box on the mirror output where the source output's contents are shown.
+ *
+ * @param source The size of the source output's buffer.
+ * @param mirror The size of the mirror output's buffer.
+ * @param letterbox Whether to keep the aspect ratio of the source, leaving black bars on the sides of the
+ *   mirror output, or to stretch the source over the whole mirror output.
+ */
+wf::geometry_t get_mirror_destination_box(wf::dimensions_t source, wf::dimensions_t mirror, bool letterbox);
+
+/**
+ * Convert damage on the source output's buffer to damage on the mirror output's buffer.
+ * The result is slightly larger than the scaled damage, since filtering samples neighboring pixels.
+ */
+wf::region_t get_mirror_damage(const wf::region_t& source_damage, wf::dimensions_t source,
+    wf::geometry_t destination);
+
+/**
+ * Shows the contents of one output on another output.
+ *
+ * Whenever the source output commits a new buffer, the damaged parts of it are copied to the mirror output,
+ * scaled to fit. If the source output does not change, nothing is rendered on the mirror output.
+ */
+class output_mirror_t
+{
+  public:
+    output_mirror_t(wlr_output *mirror, wlr_output *source, bool letterbox);
+    ~output_mirror_t();
+
+    output_mirror_t(const output_mirror_t&) = delete;
+    output_mirror_t(output_mirror_t&&) = delete;
+    output_mirror_t& operator =(const output_mirror_t&) = delete;
+    output_mirror_t& operator =(output_mirror_t&&) = delete;
+
+  private:
+    wlr_output *mirror;
+    wlr_output *source;
+    bool letterbox;
+
+    /** The last buffer committed on the source output */
+    wlr_buffer *source_buffer = NULL;
+    /** Damage on the mirror output, in its buffer coordinates */
+    wlr_damage_ring damage_ring;
+    bool pending_gamma_lut = false;
+
+    wl_listener_wrapper on_source_commit;
+    wl_listener_wrapper on_source_destroy;
+    wl_listener_wrapper on_mirror_commit;
+    wl_listener_wrapper on_frame;
+    wl_listener_wrapper on_needs_frame;
+    wl_listener_wrapper on_gamma_changed;
+
+    wf::dimensions_t get_source_size() const;
+    wf::dimensions_t get_mirror_size() const;
+
+    void damage_whole();
+    void handle_source_commit(wlr_output_event_commit *ev);
+    void render_frame();
+};
+}
@@ -8,5 +8,11 @@ namespace scene
 {
 struct root_node_t::priv_t
 {};
+
+/**
+ * When set, node_t::get_children_bounding_box() recomputes the bounding box even if it is cached, and
+ * reports stale cache entries. Enabled with the --validate-bbox-cache command line option.
+ */
+extern bool validate_bounding_box_cache;
 }
 }
@@ -1,5 +1,7 @@
+#include <cmath>
 #include <limits>
 #include <memory>
+#include <unordered_map>
 #include <wayfire/scene.hpp>
 #include <wayfire/view.hpp>
 #include <wayfire/output.hpp>
@@ -13,6 +15,7 @@
 #include "wayfire/scene-render.hpp"
 #include "wayfire/signal-provider.hpp"
 #include <wayfire/core.hpp>
+#include <wayfire/util/log.hpp>
 
 namespace wf
 {
@@ -115,12 +118,194 @@ wf::keyboard_focus_node_t node_t::keyboard_refocus(wf::output_t *output)
     return result;
 }
 
+// --------------------------- floating_inner_node_t ---------------------------
+
+/**
+ * A uniform grid over the bounding boxes of the children of a floating_inner_node_t.
+ * Each cell contains the indices of the children (in the order of get_children(), i.e. from top to bottom)
+ * whose bounding box intersects the cell.
+ */
+struct floating_inner_node_t::input_index_t
+{
+    /** Number of cells in each direction. */
+    static constexpr int GRID_SIZE = 16;
+
+    bool dirty = true;
+    // The subtree geometry serial of the node when the index was built.
+    uint64_t geometry_serial = 0;
+    wf::geometry_t extents = {0, 0, 0, 0};
+    std::vector<wf::geometry_t> child_boxes;
+    /** Children with an empty bounding box, which are considered for every point. */
+    std::vector<size_t> unbounded;
+    std::vector<std::vector<size_t>> cells;
+
+    void rebuild(const std::vector<node_ptr>& children, uint64_t serial)
+    {
+        dirty = false;
+        geometry_serial = serial;
+        child_boxes.clear();
+        unbounded.clear();
+        // Keep the storage of the cells, the index is rebuilt after every geometry change.
+        cells.resize(GRID_SIZE * GRID_SIZE);
+        for (auto& cell : cells)
+        {
+            cell.clear();
+        }
+
+        int min_x = std::numeric_limits<int>::max();
+        int min_y = std::numeric_limits<int>::max();
+        int max_x = std::numeric_limits<int>::min();
+        int max_y = std::numeric_limits<int>::min();
+        for (size_t i = 0; i < children.size(); i++)
+        {
+            auto bbox = children[i]->get_bounding_box();
+            child_boxes.push_back(bbox);
+            if ((bbox.width <= 0) || (bbox.height <= 0))
+            {
+                unbounded.push_back(i);
+                continue;
+            }
+
+            min_x = std::min(min_x, bbox.x);
+            min_y = std::min(min_y, bbox.y);
+            max_x = std::max(max_x, bbox.x + bbox.width);
+            max_y = std::max(max_y, bbox.y + bbox.height);
+        }
+
+        if (unbounded.size() == children.size())
+        {
+            extents = {0, 0, 0, 0};
+            return;
+        }
+
+        extents = {min_x, min_y, max_x - min_x, max_y - min_y};
+        for (size_t i = 0; i < children.size(); i++)
+        {
+            const auto& bbox = child_boxes[i];
+            if ((bbox.width <= 0) || (bbox.height <= 0))
+            {
+                continue;
+            }
+
+            auto [x1, y1] = cell_at(bbox.x, bbox.y);
+            auto [x2, y2] = cell_at(bbox.x + bbox.width - 1, bbox.y + bbox.height - 1);
+            for (int y = y1; y <= y2; y++)
+            {
+                for (int x = x1; x <= x2; x++)
+                {
+                    cells[y * GRID_SIZE + x].push_back(i);
+                }
+            }
+        }
+    }
+
+    std::pair<int, int> cell_at(int64_t x, int64_t y) const
+    {
+        int cx = (x - extents.x) * GRID_SIZE / extents.width;
+        int cy = (y - extents.y) * GRID_SIZE / extents.height;
+        return {std::clamp(cx, 0, GRID_SIZE - 1), std::clamp(cy, 0, GRID_SIZE - 1)};
+    }
+
+    /**
+     * Call @callback for each child which may contain the given point, from top to bottom, until the
+     * callback returns true.
+     */
+    template<class Callback>
+    void for_each_candidate(const wf::pointf_t& at, Callback callback) const
+    {
+        const std::vector<size_t> empty;
+        const std::vector<size_t> *cell = &empty;
+        if ((extents.width > 0) && (extents.height > 0) &&
+            (at.x >= extents.x) && (at.x < extents.x + extents.width) &&
+            (at.y >= extents.y) && (at.y < extents.y + extents.height))
+        {
+            auto [cx, cy] = cell_at(std::floor(at.x), std::floor(at.y));
+            cell = &cells[cy * GRID_SIZE + cx];
+        }
+
+        // Merge the cell's children with the unbounded children, preserving the order of the children.
+        auto it_cell = cell->begin();
+        auto it_unbounded = unbounded.begin();
+        while ((it_cell != cell->end()) || (it_unbounded != unbounded.end()))
+        {
+            size_t idx;
+            if ((it_unbounded == unbounded.end()) ||
+                ((it_cell != cell->end()) && (*it_cell < *it_unbounded)))
+            {
+                idx = *it_cell++;
+                const auto& bbox = child_boxes[idx];
+                if ((at.x < bbox.x) || (at.x >= bbox.x + bbox.width) ||
+                    (at.y < bbox.y) || (at.y >= bbox.y + bbox.height))
+                {
+                    continue;
+                }
+            } else
+            {
+                idx = *it_unbounded++;
+            }
+
+            if (callback(idx))
+            {
+                return;
+            }
+        }
+    }
+};
+
+floating_inner_node_t::floating_inner_node_t(bool is_structure) : node_t(is_structure)
+{}
+
 bool floating_inner_node_t::set_children_list(std::vector<node_ptr> new_list)
 {
     set_children_unchecked(std::move(new_list));
+    if (input_index)
+    {
+        input_index->dirty = true;
+    }
+
     return true;
 }
 
+void floating_inner_node_t::set_input_index_enabled(bool enabled)
+{
+    if (enabled && !input_index)
+    {
+        input_index = std::make_unique<input_index_t>();
+    } else if (!enabled)
+    {
+        input_index.reset();
+    }
+}
+
+std::optional<input_node_t> floating_inner_node_t::find_node_at(const wf::pointf_t& at)
+{
+    if (!input_index)
+    {
+        return node_t::find_node_at(at);
+    }
+
+    // Damage and geometry changes of the children invalidate their bounding boxes, see damage_node().
+    if (input_index->dirty || (input_index->geometry_serial != get_subtree_geometry_serial()))
+    {
+        input_index->rebuild(children, get_subtree_geometry_serial());
+    }
+
+    auto local = this->to_local(at);
+    std::optional<input_node_t> result;
+    input_index->for_each_candidate(local, [&] (size_t idx)
+    {
+        auto& node = children[idx];
+        if (node->is_enabled())
+        {
+            result = node->find_node_at(local);
+        }
+
+        return result.has_value();
+    });
+
+    return result;
+}
+
 void node_t::set_children_unchecked(std::vector<node_ptr> new_list)
 {
     node_damage_signal data;
@@ -138,6 +323,7 @@ void node_t::set_children_unchecked(std::vector<node_ptr> new_list)
     }
 
     this->children = std::move(new_list);
+    invalidate_bounding_boxes(this);
 
     data.region |= get_bounding_box();
     this->emit(&data);
@@ -235,24 +421,160 @@ class default_render_instance_t : public render_instance_t
     }
 };
 
+/**
+ * Describes the range of render instances in a flat list which were generated by a single child node.
+ */
+struct child_instances_span_t
+{
+    std::weak_ptr<node_t> node;
+    /** The structure serial of the node when the instances were generated. */
+    uint64_t serial;
+    size_t count;
+    /** Whether the subtree contains nodes which depend on the whole scene, see @regen_render_instances(). */
+    bool depends_on_scene;
+};
+
+static bool any_depends_on_scene(const std::vector<child_instances_span_t>& spans)
+{
+    return std::any_of(spans.begin(), spans.end(), [] (const child_instances_span_t& span)
+    {
+        return span.depends_on_scene;
+    });
+}
+
+/**
+ * The render instance generated by the default node_t::gen_render_instances(). The instances of the node's
+ * children follow directly after it in the flat list of instances, and it remembers which child generated
+ * which of them, so that they can be reused by regen_render_instances().
+ */
+class container_render_instance_t final : public default_render_instance_t
+{
+  public:
+    container_render_instance_t(node_t *self, damage_callback callback) :
+        default_render_instance_t(self, callback)
+    {
+        this->self = self->weak_from_this();
+    }
+
+    std::weak_ptr<node_t> self;
+    std::vector<child_instances_span_t> children;
+};
+
+static void regen_subtree_instances(node_t *node, std::vector<render_instance_uptr>& old,
+    size_t old_begin, size_t old_count, std::vector<render_instance_uptr>& out,
+    const damage_callback& push_damage, wf::output_t *output);
+static bool subtree_depends_on_scene(node_t *node, const render_instance_uptr& first);
+
+/**
+ * Generate the render instances of the enabled children of @node and append them to @out.
+ *
+ * @param old The previous list of instances, where the children's instances start at @old_begin and are
+ *   described by @old_spans. Instances of children whose structure did not change and which do not depend
+ *   on the whole scene are moved from there.
+ * @return The spans describing the new instances.
+ */
+static std::vector<child_instances_span_t> splice_children_instances(node_t *node,
+    std::vector<render_instance_uptr>& old, size_t old_begin,
+    const std::vector<child_instances_span_t>& old_spans,
+    std::vector<render_instance_uptr>& out, const damage_callback& push_damage, wf::output_t *output)
+{
+    struct old_range_t
+    {
+        size_t begin;
+        const child_instances_span_t *span;
+    };
+
+    std::unordered_map<node_t*, old_range_t> old_ranges;
+    size_t offset = old_begin;
+    for (auto& span : old_spans)
+    {
+        if (auto child = span.node.lock())
+        {
+            old_ranges[child.get()] = {offset, &span};
+        }
+
+        offset += span.count;
+    }
+
+    std::vector<child_instances_span_t> new_spans;
+    for (auto& ch : node->get_children())
+    {
+        if (!ch->is_enabled())
+        {
+            continue;
+        }
+
+        const size_t start = out.size();
+        auto it = old_ranges.find(ch.get());
+        if (it == old_ranges.end())
+        {
+            ch->gen_render_instances(out, push_damage, output);
+        } else if ((it->second.span->serial == ch->get_structure_serial()) &&
+                   !it->second.span->depends_on_scene)
+        {
+            auto first = old.begin() + it->second.begin;
+            std::move(first, first + it->second.span->count, std::back_inserter(out));
+        } else
+        {
+            regen_subtree_instances(ch.get(), old, it->second.begin, it->second.span->count,
+                out, push_damage, output);
+        }
+
+        const size_t count = out.size() - start;
+        const bool depends_on_scene = (count > 0) && subtree_depends_on_scene(ch.get(), out[start]);
+        new_spans.push_back({ch, ch->get_structure_serial(), count, depends_on_scene});
+    }
+
+    return new_spans;
+}
+
 void node_t::gen_render_instances(std::vector<render_instance_uptr> & instances,
     damage_callback push_damage, wf::output_t *output)
 {
     // Add self for damage tracking
-    instances.push_back(
-        std::make_unique<default_render_instance_t>(this, push_damage));
+    auto self_instance = std::make_unique<container_render_instance_t>(this, push_damage);
+    auto self_ptr = self_instance.get();
+    instances.push_back(std::move(self_instance));
 
     // Add children as a flat list to avoid multiple indirections
-    for (auto& ch : this->children)
+    std::vector<render_instance_uptr> no_old_instances;
+    self_ptr->children = splice_children_instances(this, no_old_instances, 0, {},
+        instances, push_damage, output);
+}
+
+bool validate_bounding_box_cache = false;
+
+void invalidate_bounding_boxes(node_t *node)
+{
+    // The bounding box of a node is part of the cached children bounding box of each of its ancestors.
+    for (; node; node = node->parent())
+    {
+        node->cached_children_bbox_valid = false;
+        ++node->subtree_geometry_serial;
+    }
+}
+
+wf::geometry_t node_t::get_children_bounding_box()
+{
+    if (!cached_children_bbox_valid)
+    {
+        cached_children_bbox = compute_children_bounding_box();
+        cached_children_bbox_valid = true;
+    } else if (validate_bounding_box_cache)
     {
-        if (ch->is_enabled())
+        auto actual = compute_children_bounding_box();
+        if (actual != cached_children_bbox)
         {
-            ch->gen_render_instances(instances, push_damage, output);
+            LOGE("Stale cached bounding box for ", stringify(), ": cached ", cached_children_bbox,
+                ", actual ", actual, ". Some code changes the node geometry without damage or update!");
+            cached_children_bbox = actual;
         }
     }
+
+    return cached_children_bbox;
 }
 
-wf::geometry_t node_t::get_children_bounding_box()
+wf::geometry_t node_t::compute_children_bounding_box()
 {
     if (children.empty())
     {
@@ -366,33 +688,41 @@ std::optional<input_node_t> output_node_t::find_node_at(const wf::pointf_t& at)
         return {};
     }
 
-    return node_t::find_node_at(at);
+    return floating_inner_node_t::find_node_at(at);
 }
 
 class output_render_instance_t : public default_render_instance_t
 {
     wf::output_t *output;
-    output_node_t *self;
+    wf::output_t *shown_on;
+    damage_callback push_damage_child;
     std::vector<render_instance_uptr> children;
 
   public:
+    output_node_t *self;
+    std::vector<child_instances_span_t> children_spans;
+
     output_render_instance_t(output_node_t *self, damage_callback callback,
         wf::output_t *output, wf::output_t *shown_on) :
         default_render_instance_t(self, transform_damage(callback))
     {
-        this->self   = self;
-        this->output = output;
+        this->self     = self;
+        this->output   = output;
+        this->shown_on = shown_on;
+        this->push_damage_child = transform_damage(callback);
 
         // Children are stored as a sublist, because we need to translate every
         // time between global and output-local geometry.
-        for (auto& child : self->get_children())
-        {
-            if (child->is_enabled())
-            {
-                child->gen_render_instances(children,
-                    transform_damage(callback), shown_on);
-            }
-        }
+        regen_children();
+    }
+
+    /** Regenerate the instances of the children whose structure changed or which depend on the scene. */
+    void regen_children()
+    {
+        auto old = std::move(children);
+        children.clear();
+        children_spans = splice_children_instances(self, old, 0, children_spans,
+            children, push_damage_child, shown_on);
     }
 
     damage_callback transform_damage(damage_callback child_damage)
@@ -436,6 +766,12 @@ class output_render_instance_t : public default_render_instance_t
         damage += -offset;
         for (auto& ch : children)
         {
+            if (damage.empty())
+            {
+                // The remaining children are fully covered by opaque content above them.
+                break;
+            }
+
             ch->schedule_instructions(instructions, new_target, damage);
         }
 
@@ -487,6 +823,69 @@ void output_node_t::gen_render_instances(
             shown_on));
 }
 
+static bool subtree_depends_on_scene(node_t *node, const render_instance_uptr& first)
+{
+    auto container = dynamic_cast<container_render_instance_t*>(first.get());
+    if (container && (container->self.lock().get() == node))
+    {
+        return any_depends_on_scene(container->children);
+    }
+
+    auto output_instance = dynamic_cast<output_render_instance_t*>(first.get());
+    if (output_instance && (output_instance->self == node))
+    {
+        return any_depends_on_scene(output_instance->children_spans);
+    }
+
+    // Custom render instances are reused only if the node says that they show nothing outside of its
+    // subtree. They keep the instances of their children up to date themselves.
+    return node->depends_on_whole_scene();
+}
+
+/**
+ * Regenerate the render instances of @node, whose previous instances are in
+ * old[old_begin, old_begin + old_count).
+ */
+static void regen_subtree_instances(node_t *node, std::vector<render_instance_uptr>& old,
+    size_t old_begin, size_t old_count, std::vector<render_instance_uptr>& out,
+    const damage_callback& push_damage, wf::output_t *output)
+{
+    if (old_count == 0)
+    {
+        node->gen_render_instances(out, push_damage, output);
+        return;
+    }
+
+    if (auto output_instance = dynamic_cast<output_render_instance_t*>(old[old_begin].get());
+        output_instance && (output_instance->self == node) && (old_count == 1))
+    {
+        output_instance->regen_children();
+        out.push_back(std::move(old[old_begin]));
+        return;
+    }
+
+    auto container = dynamic_cast<container_render_instance_t*>(old[old_begin].get());
+    if (!container || (container->self.lock().get() != node))
+    {
+        // Not generated by the default implementation, we don't know how to reuse the instances.
+        node->gen_render_instances(out, push_damage, output);
+        return;
+    }
+
+    auto old_spans = std::move(container->children);
+    out.push_back(std::move(old[old_begin]));
+    container->children = splice_children_instances(node, old, old_begin + 1, old_spans,
+        out, push_damage, output);
+}
+
+void regen_render_instances(wf::scene::node_ptr node, std::vector<render_instance_uptr>& instances,
+    damage_callback push_damage, wf::output_t *output)
+{
+    auto old = std::move(instances);
+    instances.clear();
+    regen_subtree_instances(node.get(), old, 0, old.size(), instances, push_damage, output);
+}
+
 wf::geometry_t output_node_t::get_bounding_box()
 {
     const auto bbox = node_t::get_bounding_box();
@@ -541,6 +940,13 @@ void set_node_enabled(wf::scene::node_ptr node, bool enabled)
 
 void update(node_ptr changed_node, uint32_t flags)
 {
+    invalidate_bounding_boxes(changed_node.get());
+    if (flags & (update_flag::CHILDREN_LIST | update_flag::ENABLED))
+    {
+        // Render instances of the subtree have to be regenerated
+        ++changed_node->structure_serial;
+    }
+
     if ((flags & update_flag::CHILDREN_LIST) ||
         (flags & update_flag::ENABLED) ||
         (flags & update_flag::GEOMETRY))
@@ -554,6 +960,15 @@ void update(node_ptr changed_node, uint32_t flags)
         flags |= update_flag::MASKED;
     }
 
+    if (flags & update_flag::INPUT_STATE)
+    {
+        auto inner = dynamic_cast<floating_inner_node_t*>(changed_node.get());
+        if (inner && inner->input_index)
+        {
+            inner->input_index->dirty = true;
+        }
+    }
+
     if (changed_node == wf::get_core().scene())
     {
         root_node_update_signal data;
@@ -4,6 +4,8 @@
 #include "hotspot-manager.hpp"
 #include "wayfire/signal-definitions.hpp"
 #include <wayfire/debug.hpp>
+#include <memory>
+#include <unordered_map>
 
 struct wf::bindings_repository_t::impl
 {
@@ -28,6 +30,89 @@ struct wf::bindings_repository_t::impl
 
     void reparse_extensions();
 
+    /**
+     * The bindings which match a key or button combination, in the order in which they are called: plain
+     * bindings first, then activators. Never modified once created, so that they can be used while the
+     * callbacks add or remove bindings.
+     */
+    template<class Callback>
+    struct matching_bindings_t
+    {
+        std::vector<Callback*> bindings;
+        std::vector<activator_callback*> activators;
+    };
+
+    template<class Callback>
+    using binding_index_t =
+        std::unordered_map<uint64_t, std::shared_ptr<const matching_bindings_t<Callback>>>;
+
+    /**
+     * The matching bindings for each key and button combination which was used since the bindings last
+     * changed. Filled on demand, so that each event looks only at the bindings it triggers.
+     */
+    binding_index_t<key_callback> key_index;
+    binding_index_t<button_callback> button_index;
+
+    // Bounds the number of combinations in each index.
+    static constexpr size_t MAX_INDEXED_COMBINATIONS = 1024;
+
+    void invalidate_index()
+    {
+        key_index.clear();
+        button_index.clear();
+    }
+
+    template<class Option, class Callback>
+    void add_binding(binding_container_t<Option, Callback>& bindings, wf::option_sptr_t<Option> opt,
+        Callback *callback)
+    {
+        auto bnd = std::make_unique<wf::binding_t<Option, Callback>>();
+        bnd->activated_by = opt;
+        bnd->callback     = callback;
+        bnd->on_updated   = [=] () { invalidate_index(); };
+        opt->add_updated_handler(&bnd->on_updated);
+        bindings.emplace_back(std::move(bnd));
+        invalidate_index();
+    }
+
+    template<class Option, class Callback>
+    std::shared_ptr<const matching_bindings_t<Callback>> find_matching_bindings(
+        binding_index_t<Callback>& index, const binding_container_t<Option, Callback>& bindings,
+        const Option& pressed, uint32_t code)
+    {
+        const uint64_t combination = ((uint64_t)pressed.get_modifiers() << 32) | code;
+        auto it = index.find(combination);
+        if (it != index.end())
+        {
+            return it->second;
+        }
+
+        auto matching = std::make_shared<matching_bindings_t<Callback>>();
+        for (auto& binding : bindings)
+        {
+            if (binding->activated_by->get_value() == pressed)
+            {
+                matching->bindings.push_back(binding->callback);
+            }
+        }
+
+        for (auto& binding : activators)
+        {
+            if (binding->activated_by->get_value().has_match(pressed))
+            {
+                matching->activators.push_back(binding->callback);
+            }
+        }
+
+        if (index.size() >= MAX_INDEXED_COMBINATIONS)
+        {
+            index.clear();
+        }
+
+        index[combination] = matching;
+        return matching;
+    }
+
     binding_container_t<wf::keybinding_t, key_callback> keys;
     binding_container_t<wf::keybinding_t, axis_callback> axes;
     binding_container_t<wf::buttonbinding_t, button_callback> buttons;
@@ -37,6 +122,7 @@ struct wf::bindings_repository_t::impl
 
     wf::signal::connection_t<wf::reload_config_signal> on_config_reload = [=] (wf::reload_config_signal *ev)
     {
+        invalidate_index();
         recreate_hotspots();
         reparse_extensions();
     };
@@ -8,38 +8,28 @@ wf::bindings_repository_t::bindings_repository_t()
     wf::get_core().connect(&priv->on_config_reload);
 }
 
-template<class Option, class Callback>
-static void push_binding(wf::binding_container_t<Option, Callback>& bindings,
-    wf::option_sptr_t<Option> opt, Callback *callback)
-{
-    auto bnd = std::make_unique<wf::binding_t<Option, Callback>>();
-    bnd->activated_by = opt;
-    bnd->callback     = callback;
-    bindings.emplace_back(std::move(bnd));
-}
-
 wf::bindings_repository_t::~bindings_repository_t()
 {}
 
 void wf::bindings_repository_t::add_key(option_sptr_t<keybinding_t> key, wf::key_callback *cb)
 {
-    push_binding(priv->keys, key, cb);
+    priv->add_binding(priv->keys, key, cb);
 }
 
 void wf::bindings_repository_t::add_axis(option_sptr_t<keybinding_t> axis, wf::axis_callback *cb)
 {
-    push_binding(priv->axes, axis, cb);
+    priv->add_binding(priv->axes, axis, cb);
 }
 
 void wf::bindings_repository_t::add_button(option_sptr_t<buttonbinding_t> button, wf::button_callback *cb)
 {
-    push_binding(priv->buttons, button, cb);
+    priv->add_binding(priv->buttons, button, cb);
 }
 
 void wf::bindings_repository_t::add_activator(
     option_sptr_t<activatorbinding_t> activator, wf::activator_callback *cb)
 {
-    push_binding(priv->activators, activator, cb);
+    priv->add_binding(priv->activators, activator, cb);
     if (activator->get_value().get_hotspots().size())
     {
         priv->recreate_hotspots();
@@ -54,50 +44,35 @@ bool wf::bindings_repository_t::handle_key(const wf::keybinding_t& pressed,
         return false;
     }
 
-    std::vector<std::function<bool()>> callbacks;
-    for (auto& binding : this->priv->keys)
+    /* Callbacks may add or erase bindings, which invalidates the index, so keep the matching bindings
+     * alive while calling them. */
+    auto matching = priv->find_matching_bindings(priv->key_index, priv->keys, pressed, pressed.get_key());
+
+    bool handled = false;
+    for (auto callback : matching->bindings)
     {
-        if (binding->activated_by->get_value() == pressed)
-        {
-            /* We must be careful because the callback might be erased,
-             * so force copy the callback into the lambda */
-            auto callback = binding->callback;
-            callbacks.emplace_back([pressed, callback] ()
-            {
-                return (*callback)(pressed);
-            });
-        }
+        handled |= (*callback)(pressed);
     }
 
-    for (auto& binding : this->priv->activators)
+    if (matching->activators.empty())
     {
-        if (binding->activated_by->get_value().has_match(pressed))
-        {
-            /* We must be careful because the callback might be erased,
-             * so force copy the callback into the lambda */
-            auto callback = binding->callback;
-            callbacks.emplace_back([pressed, callback, mod_binding_key] ()
-            {
-                wf::activator_data_t ev = {
-                    .source = activator_source_t::KEYBINDING,
-                    .activation_data = pressed.get_key()
-                };
+        return handled;
+    }
 
-                if (mod_binding_key)
-                {
-                    ev.source = activator_source_t::MODIFIERBINDING;
-                    ev.activation_data = mod_binding_key;
-                }
+    wf::activator_data_t ev = {
+        .source = activator_source_t::KEYBINDING,
+        .activation_data = pressed.get_key()
+    };
 
-                return (*callback)(ev);
-            });
-        }
+    if (mod_binding_key)
+    {
+        ev.source = activator_source_t::MODIFIERBINDING;
+        ev.activation_data = mod_binding_key;
     }
 
-    bool handled = false;
-    for (auto& cb : callbacks)
+    for (auto callback : matching->activators)
     {
-        handled |= cb();
+        handled |= (*callback)(ev);
     }
 
     return handled;
@@ -136,43 +111,23 @@ bool wf::bindings_repository_t::handle_button(const wf::buttonbinding_t& pressed
         return false;
     }
 
-    std::vector<std::function<bool()>> callbacks;
-    for (auto& binding : this->priv->buttons)
-    {
-        if (binding->activated_by->get_value() == pressed)
-        {
-            /* We must be careful because the callback might be erased,
-             * so force copy the callback into the lambda */
-            auto callback = binding->callback;
-            callbacks.emplace_back([=] ()
-            {
-                return (*callback)(pressed);
-            });
-        }
-    }
+    auto matching = priv->find_matching_bindings(priv->button_index, priv->buttons, pressed,
+        pressed.get_button());
 
-    for (auto& binding : this->priv->activators)
+    bool binding_handled = false;
+    for (auto callback : matching->bindings)
     {
-        if (binding->activated_by->get_value().has_match(pressed))
-        {
-            /* We must be careful because the callback might be erased,
-             * so force copy the callback into the lambda */
-            auto callback = binding->callback;
-            callbacks.emplace_back([=] ()
-            {
-                wf::activator_data_t data = {
-                    .source = activator_source_t::BUTTONBINDING,
-                    .activation_data = pressed.get_button(),
-                };
-                return (*callback)(data);
-            });
-        }
+        binding_handled |= (*callback)(pressed);
     }
 
-    bool binding_handled = false;
-    for (auto call : callbacks)
+    wf::activator_data_t data = {
+        .source = activator_source_t::BUTTONBINDING,
+        .activation_data = pressed.get_button(),
+    };
+
+    for (auto callback : matching->activators)
     {
-        binding_handled |= call();
+        binding_handled |= (*callback)(data);
     }
 
     return binding_handled;
@@ -262,6 +217,7 @@ void wf::bindings_repository_t::rem_binding(void *callback)
     erase(priv->buttons);
     erase(priv->axes);
     erase(priv->activators);
+    priv->invalidate_index();
 
     if (update_hotspots)
     {
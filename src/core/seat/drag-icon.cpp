@@ -70,6 +70,11 @@ class dnd_root_icon_root_node_t : public floating_inner_node_t
             damage += -self->get_position();
             for (auto& ch : this->children)
             {
+                if (damage.empty())
+                {
+                    break;
+                }
+
                 ch->schedule_instructions(instructions, our_target, damage);
             }
 
@@ -107,6 +112,11 @@ class dnd_root_icon_root_node_t : public floating_inner_node_t
         instances.push_back(std::make_unique<dnd_icon_root_render_instance_t>(this, push_damage));
     }
 
+    bool depends_on_whole_scene() const override
+    {
+        return false;
+    }
+
     std::optional<input_node_t> find_node_at(const wf::pointf_t& at) override
     {
         // Don't allow focus going to the DnD surface itself
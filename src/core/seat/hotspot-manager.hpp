@@ -20,6 +20,17 @@ struct binding_t
     wf::option_sptr_t<Option> activated_by;
     Callback *callback;
     std::vector<std::any> tags;
+
+    // Called whenever the value of activated_by changes, if set.
+    wf::config::option_base_t::updated_callback_t on_updated;
+
+    ~binding_t()
+    {
+        if (on_updated)
+        {
+            activated_by->rem_updated_handler(&on_updated);
+        }
+    }
 };
 
 template<class Option, class Callback> using binding_container_t =
@@ -113,9 +113,16 @@ void load_locked_mods_from_config(xkb_mod_mask_t& locked_mods)
     }
 }
 
+void wf::input_manager_t::update_keymap_cache()
+{
+    keymap_cache.set_disk_cache_dir(xkb_disk_cache ? keymap_cache_t::get_default_disk_cache_dir() : "");
+}
+
 wf::input_manager_t::input_manager_t()
 {
     load_locked_mods_from_config(locked_mods);
+    update_keymap_cache();
+    xkb_disk_cache.set_callback([=] () { update_keymap_cache(); });
 
     input_device_created.set_callback([&] (void *data)
     {
@@ -127,6 +134,8 @@ wf::input_manager_t::input_manager_t()
 
     config_updated = [=] (auto)
     {
+        // XKB files may have changed since the keymaps were compiled, the disk cache notices such changes.
+        keymap_cache.clear();
         for (auto& dev : input_devices)
         {
             dev->update_options();
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "seat-impl.hpp"
+#include "keymap-cache.hpp"
 #include "wayfire/signal-provider.hpp"
 #include "wayfire/core.hpp"
 #include "wayfire/signal-definitions.hpp"
@@ -27,6 +28,9 @@ class input_manager_t
     wf::signal::connection_t<wf::reload_config_signal> config_updated;
     wf::signal::connection_t<output_added_signal> output_added;
 
+    wf::option_wrapper_t<bool> xkb_disk_cache{"input/xkb_disk_cache"};
+    void update_keymap_cache();
+
   public:
     /**
      * Locked mods are stored globally because the keyboard devices might be
@@ -34,6 +38,9 @@ class input_manager_t
      */
     uint32_t locked_mods = 0;
 
+    /** Compiled keymaps, shared by all keyboards. */
+    wf::keymap_cache_t keymap_cache;
+
     /**
      * Map a single input device to output as specified in the
      * config file or by hints in the wlroots backend.
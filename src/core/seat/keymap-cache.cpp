@@ -0,0 +1,279 @@
+#include "keymap-cache.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <xkbcommon/xkbcommon.h>
+#include <wayfire/util/log.hpp>
+
+wf::keymap_cache_t::keymap_cache_t()
+{
+    context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+}
+
+wf::keymap_cache_t::~keymap_cache_t()
+{
+    clear();
+    xkb_context_unref(context);
+}
+
+void wf::keymap_cache_t::clear()
+{
+    for (auto& entry : entries)
+    {
+        xkb_keymap_unref(entry.keymap);
+    }
+
+    entries.clear();
+}
+
+void wf::keymap_cache_t::set_disk_cache_dir(const std::string& dir)
+{
+    this->disk_cache_dir = dir;
+}
+
+const wf::keymap_cache_stats_t& wf::keymap_cache_t::get_stats() const
+{
+    return stats;
+}
+
+std::string wf::keymap_cache_t::get_default_disk_cache_dir()
+{
+    if (const char *cache_home = std::getenv("XDG_CACHE_HOME"))
+    {
+        return std::string(cache_home) + "/wayfire/keymaps";
+    }
+
+    if (const char *home = std::getenv("HOME"))
+    {
+        return std::string(home) + "/.cache/wayfire/keymaps";
+    }
+
+    return "";
+}
+
+xkb_keymap*wf::keymap_cache_t::get_keymap(const keymap_names_t& names)
+{
+    if (!context)
+    {
+        return nullptr;
+    }
+
+    auto it = std::find_if(entries.begin(), entries.end(), [&] (const entry_t& entry)
+    {
+        return entry.names == names;
+    });
+
+    if (it != entries.end())
+    {
+        ++stats.hits;
+        it->last_used = ++use_counter;
+        return xkb_keymap_ref(it->keymap);
+    }
+
+    auto keymap = load_keymap(names);
+    if (!keymap)
+    {
+        return nullptr;
+    }
+
+    if (entries.size() >= MAX_CACHED_KEYMAPS)
+    {
+        auto lru = std::min_element(entries.begin(), entries.end(), [] (const entry_t& a, const entry_t& b)
+        {
+            return a.last_used < b.last_used;
+        });
+
+        xkb_keymap_unref(lru->keymap);
+        entries.erase(lru);
+    }
+
+    entries.push_back({names, xkb_keymap_ref(keymap), ++use_counter});
+    return keymap;
+}
+
+xkb_keymap*wf::keymap_cache_t::load_keymap(const keymap_names_t& names)
+{
+    std::string key;
+    if (!disk_cache_dir.empty())
+    {
+        key = get_disk_cache_key(names);
+        if (auto keymap = load_from_disk(key))
+        {
+            ++stats.disk_hits;
+            return keymap;
+        }
+    }
+
+    xkb_rule_names rule_names;
+    rule_names.rules   = names.rules.c_str();
+    rule_names.model   = names.model.c_str();
+    rule_names.layout  = names.layout.c_str();
+    rule_names.variant = names.variant.c_str();
+    rule_names.options = names.options.c_str();
+
+    auto start  = std::chrono::steady_clock::now();
+    auto keymap = xkb_keymap_new_from_names(context, &rule_names, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    if (!keymap)
+    {
+        return nullptr;
+    }
+
+    ++stats.compiled;
+    auto duration = std::chrono::steady_clock::now() - start;
+    LOGD("Compiled keymap rules=\"", names.rules, "\" layout=\"", names.layout, "\" in ",
+        std::chrono::duration_cast<std::chrono::milliseconds>(duration).count(), "ms");
+
+    if (!disk_cache_dir.empty())
+    {
+        store_on_disk(key, keymap);
+    }
+
+    return keymap;
+}
+
+static void append_mtime(std::ostringstream& out, const std::string& path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0)
+    {
+        out << path << ":" << st.st_mtim.tv_sec << "." << st.st_mtim.tv_nsec << "\n";
+    }
+}
+
+/**
+ * Append the number of files below @dir and the newest modification time among them. Editing a file in place
+ * changes only the modification time of the file itself, and it becomes the newest one.
+ */
+static void append_newest_mtime(std::ostringstream& out, const std::string& dir)
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    uint64_t count = 0;
+    struct timespec newest = {0, 0};
+    for (fs::recursive_directory_iterator it{dir, ec}, end; !ec && (it != end); it.increment(ec))
+    {
+        struct stat st;
+        if (stat(it->path().c_str(), &st) == 0)
+        {
+            ++count;
+            if ((st.st_mtim.tv_sec > newest.tv_sec) ||
+                ((st.st_mtim.tv_sec == newest.tv_sec) && (st.st_mtim.tv_nsec > newest.tv_nsec)))
+            {
+                newest = st.st_mtim;
+            }
+        }
+    }
+
+    if (count > 0)
+    {
+        out << dir << "/*:" << count << ":" << newest.tv_sec << "." << newest.tv_nsec << "\n";
+    }
+}
+
+std::string wf::keymap_cache_t::get_disk_cache_key(const keymap_names_t& names)
+{
+    std::ostringstream key;
+    key << "wayfire-keymap-v2\n" << names.rules << "\n" << names.model << "\n" << names.layout << "\n" <<
+        names.variant << "\n" << names.options << "\n";
+
+    // xkbcommon uses these for the names which are empty.
+    for (auto var : {"XKB_DEFAULT_RULES", "XKB_DEFAULT_MODEL", "XKB_DEFAULT_LAYOUT", "XKB_DEFAULT_VARIANT",
+        "XKB_DEFAULT_OPTIONS"})
+    {
+        const char *value = std::getenv(var);
+        key << var << "=" << (value ? value : "") << "\n";
+    }
+
+    // Package managers and users usually replace XKB files, which changes the modification time of the
+    // directories containing them. Files edited in place are caught by looking at the files themselves.
+    for (unsigned int i = 0; i < xkb_context_num_include_paths(context); i++)
+    {
+        std::string path = xkb_context_include_path_get(context, i);
+        append_mtime(key, path);
+        for (auto subdir : {"rules", "keycodes", "types", "compat", "symbols"})
+        {
+            append_mtime(key, path + "/" + subdir);
+            append_newest_mtime(key, path + "/" + subdir);
+        }
+    }
+
+    return key.str();
+}
+
+std::string wf::keymap_cache_t::get_disk_cache_path(const std::string& key)
+{
+    // FNV-1a, so that file names do not depend on the standard library implementation.
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : key)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+
+    std::ostringstream path;
+    path << disk_cache_dir << "/" << std::hex << hash << ".xkb";
+    return path.str();
+}
+
+xkb_keymap*wf::keymap_cache_t::load_from_disk(const std::string& key)
+{
+    std::ifstream file(get_disk_cache_path(key), std::ios::binary);
+    if (!file)
+    {
+        return nullptr;
+    }
+
+    // The file starts with the length of the full key, then the key and the serialized keymap.
+    size_t key_length = 0;
+    if (!(file >> key_length) || (file.get() != '\n') || (key_length != key.size()))
+    {
+        return nullptr;
+    }
+
+    std::string stored_key(key_length, '\0');
+    if (!file.read(stored_key.data(), key_length) || (stored_key != key))
+    {
+        return nullptr;
+    }
+
+    std::string text{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    return xkb_keymap_new_from_string(context, text.c_str(), XKB_KEYMAP_FORMAT_TEXT_V1,
+        XKB_KEYMAP_COMPILE_NO_FLAGS);
+}
+
+void wf::keymap_cache_t::store_on_disk(const std::string& key, xkb_keymap *keymap)
+{
+    char *text = xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1);
+    if (!text)
+    {
+        return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(disk_cache_dir, ec);
+
+    // Write to a temporary file first, so that other instances never read a partial keymap.
+    const auto path = get_disk_cache_path(key);
+    const auto tmp  = path + ".tmp" + std::to_string(getpid());
+    bool written;
+    {
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        file << key.size() << "\n" << key << text;
+        file.close();
+        written = !file.fail();
+    }
+
+    std::free(text);
+    if (!written || (std::rename(tmp.c_str(), path.c_str()) != 0))
+    {
+        LOGW("Failed to store keymap in ", path);
+        std::filesystem::remove(tmp, ec);
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct xkb_context;
+struct xkb_keymap;
+
+namespace wf
+{
+/**
+ * The RMLVO names (rules, model, layout, variant, options) from which a keymap is compiled.
+ */
+struct keymap_names_t
+{
+    std::string rules;
+    std::string model;
+    std::string layout;
+    std::string variant;
+    std::string options;
+
+    bool operator ==(const keymap_names_t& other) const
+    {
+        return rules == other.rules && model == other.model && layout == other.layout &&
+               variant == other.variant && options == other.options;
+    }
+};
+
+struct keymap_cache_stats_t
+{
+    // Keymaps found in memory.
+    uint64_t hits = 0;
+    // Keymaps loaded from the disk cache.
+    uint64_t disk_hits = 0;
+    // Keymaps compiled from the names.
+    uint64_t compiled = 0;
+};
+
+/**
+ * Compiling a keymap from its RMLVO names takes tens of milliseconds, which adds up when several keyboards
+ * appear at once, for example after switching a KVM or connecting a dock. The keymap cache compiles each
+ * keymap once and shares it between all keyboards with the same configuration.
+ *
+ * Optionally, keymaps are also stored on disk in their serialized form, which is much faster to load than
+ * compiling them again on the next start. Stored keymaps are discarded if any XKB data file or one of the
+ * XKB_DEFAULT_* environment variables changes.
+ */
+class keymap_cache_t
+{
+  public:
+    keymap_cache_t();
+    ~keymap_cache_t();
+
+    keymap_cache_t(const keymap_cache_t&) = delete;
+    keymap_cache_t& operator =(const keymap_cache_t&) = delete;
+
+    /**
+     * Get the keymap for the given names.
+     *
+     * @return A new reference to the keymap which the caller has to release with xkb_keymap_unref(), or
+     *   nullptr if the keymap could not be compiled.
+     */
+    xkb_keymap *get_keymap(const keymap_names_t& names);
+
+    /**
+     * Set the directory where keymaps are stored between sessions. An empty directory disables the disk
+     * cache.
+     */
+    void set_disk_cache_dir(const std::string& dir);
+
+    /**
+     * Drop all keymaps held in memory. Called when the configuration is reloaded, so that changes to the
+     * XKB files are picked up.
+     */
+    void clear();
+
+    const keymap_cache_stats_t& get_stats() const;
+
+    /**
+     * The default directory for the disk cache, in $XDG_CACHE_HOME or ~/.cache, or an empty string if neither
+     * is set.
+     */
+    static std::string get_default_disk_cache_dir();
+
+  private:
+    struct entry_t
+    {
+        keymap_names_t names;
+        xkb_keymap *keymap;
+        uint64_t last_used;
+    };
+
+    // Most sessions have one or two distinct keyboard configurations, so a short list suffices.
+    static constexpr size_t MAX_CACHED_KEYMAPS = 8;
+
+    xkb_context *context = nullptr;
+    std::vector<entry_t> entries;
+    uint64_t use_counter = 0;
+    keymap_cache_stats_t stats;
+    std::string disk_cache_dir;
+
+    xkb_keymap *load_keymap(const keymap_names_t& names);
+    std::string get_disk_cache_key(const keymap_names_t& names);
+    std::string get_disk_cache_path(const std::string& key);
+    xkb_keymap *load_from_disk(const std::string& key);
+    void store_on_disk(const std::string& key, xkb_keymap *keymap);
+};
+}
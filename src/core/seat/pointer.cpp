@@ -1,4 +1,5 @@
 #include "pointer.hpp"
+#include <algorithm>
 #include <wayfire/bindings-repository.hpp>
 #include "cursor.hpp"
 #include "pointing-device.hpp"
@@ -10,6 +11,7 @@
 #include <wayfire/util/log.hpp>
 #include <wayfire/core.hpp>
 #include <wayfire/output-layout.hpp>
+#include <wayfire/output.hpp>
 
 wf::pointer_t::pointer_t(nonstd::observer_ptr<wf::input_manager_t> input,
     nonstd::observer_ptr<seat_t> seat)
@@ -71,6 +73,14 @@ bool wf::pointer_t::focus_enabled() const
 void wf::pointer_t::update_cursor_position(int64_t time_msec)
 {
     wf::pointf_t gc = seat->priv->cursor->get_cursor_position();
+    ++motion_stats.focus_updates;
+    last_focus_update = get_current_time();
+    if (motion_pending)
+    {
+        // This update also covers the pending motion.
+        motion_pending = false;
+        pending_motion_timer.disconnect();
+    }
 
     /* If we have a grabbed surface, but no drag, we want to continue sending
      * events to the grabbed surface, even if the pointer goes outside of it.
@@ -85,6 +95,11 @@ void wf::pointer_t::update_cursor_position(int64_t time_msec)
 
     this->send_motion(time_msec);
     seat->priv->update_drag_icon();
+    if (frame_pending)
+    {
+        frame_pending = false;
+        wlr_seat_pointer_notify_frame(seat->seat);
+    }
 }
 
 void wf::pointer_t::send_leave_to_focus(wf::scene::node_ptr old_focus)
@@ -210,6 +225,8 @@ void wf::pointer_t::grab_surface(wf::scene::node_ptr node)
 void wf::pointer_t::handle_pointer_button(wlr_pointer_button_event *ev,
     input_event_processing_mode_t mode)
 {
+    // Buttons must go to the node under the current cursor position.
+    flush_pending_motion();
     seat->priv->break_mod_bindings();
     bool handled_in_binding = (mode != input_event_processing_mode_t::FULL);
 
@@ -317,7 +334,7 @@ void wf::pointer_t::handle_pointer_motion(wlr_pointer_motion_event *ev,
 {
     /* XXX: maybe warp directly? */
     wlr_cursor_move(seat->priv->cursor->cursor, &ev->pointer->base, ev->delta_x, ev->delta_y);
-    update_cursor_position(ev->time_msec);
+    handle_motion(ev->time_msec);
 }
 
 void wf::pointer_t::handle_pointer_motion_absolute(
@@ -337,12 +354,76 @@ void wf::pointer_t::handle_pointer_motion_absolute(
 
     // TODO: indirection via wf_cursor
     wlr_cursor_warp_closest(seat->priv->cursor->cursor, NULL, cx, cy);
-    update_cursor_position(ev->time_msec);
+    handle_motion(ev->time_msec);
+}
+
+void wf::pointer_t::handle_motion(uint32_t time_msec)
+{
+    ++motion_stats.motion_events;
+    if (!coalesce_motion)
+    {
+        update_cursor_position(time_msec);
+        return;
+    }
+
+    pending_motion_time = time_msec;
+    if (motion_pending)
+    {
+        ++motion_stats.coalesced_events;
+        return;
+    }
+
+    const int64_t since_last = get_current_time() - last_focus_update;
+    const int64_t interval   = get_motion_interval_ms();
+    if (since_last >= interval)
+    {
+        update_cursor_position(time_msec);
+        return;
+    }
+
+    ++motion_stats.coalesced_events;
+    motion_pending = true;
+    pending_motion_timer.set_timeout(interval - since_last, [=] ()
+    {
+        flush_pending_motion();
+    });
+}
+
+void wf::pointer_t::flush_pending_motion()
+{
+    if (motion_pending)
+    {
+        update_cursor_position(pending_motion_time);
+    }
+}
+
+int64_t wf::pointer_t::get_motion_interval_ms()
+{
+    if (coalesce_motion_rate > 0)
+    {
+        return std::max(1, 1000 / coalesce_motion_rate);
+    }
+
+    // Once per frame of the output under the cursor.
+    auto gc     = seat->priv->cursor->get_cursor_position();
+    auto output = wf::get_core().output_layout->get_output_at(gc.x, gc.y);
+    if (output && (output->handle->refresh > 0))
+    {
+        return std::max(1, 1000000 / output->handle->refresh);
+    }
+
+    return 16;
+}
+
+const wf::pointer_motion_stats_t& wf::pointer_t::get_motion_stats() const
+{
+    return motion_stats;
 }
 
 void wf::pointer_t::handle_pointer_axis(wlr_pointer_axis_event *ev,
     input_event_processing_mode_t mode)
 {
+    flush_pending_motion();
     bool handled_in_binding = wf::get_core().bindings->handle_axis(
         seat->priv->get_modifiers(), ev);
     seat->priv->break_mod_bindings();
@@ -433,5 +514,12 @@ void wf::pointer_t::handle_pointer_hold_end(wlr_pointer_hold_end_event *ev,
 
 void wf::pointer_t::handle_pointer_frame()
 {
+    if (motion_pending)
+    {
+        // The frame belongs to motion which has not been sent yet.
+        frame_pending = true;
+        return;
+    }
+
     wlr_seat_pointer_notify_frame(seat->seat);
 }
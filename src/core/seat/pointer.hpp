@@ -9,6 +9,7 @@
 #include "wayfire/scene-input.hpp"
 #include "wayfire/signal-definitions.hpp"
 #include "wayfire/signal-provider.hpp"
+#include <wayfire/seat.hpp>
 #include <wayfire/nonstd/wlroots-full.hpp>
 
 namespace wf
@@ -87,6 +88,9 @@ class pointer_t
      */
     void transfer_grab(scene::node_ptr node);
 
+    /** Get the counters for pointer motion processing */
+    const pointer_motion_stats_t& get_motion_stats() const;
+
   private:
     nonstd::observer_ptr<wf::input_manager_t> input;
     nonstd::observer_ptr<seat_t> seat;
@@ -144,6 +148,32 @@ class pointer_t
      * Send synthetic button release events to the old cursor focus.
      */
     void send_leave_to_focus(wf::scene::node_ptr old_focus);
+
+    /**
+     * With pointer_motion_coalescing, the cursor itself moves on every motion event, but the focus is updated
+     * at most once per frame (or pointer_motion_coalescing_rate). Relative motion is not affected, since it
+     * is sent before motion events reach the pointer.
+     */
+    wf::option_wrapper_t<bool> coalesce_motion{"input/pointer_motion_coalescing"};
+    wf::option_wrapper_t<int> coalesce_motion_rate{"input/pointer_motion_coalescing_rate"};
+
+    /** Whether the cursor moved after the last focus update */
+    bool motion_pending = false;
+    /** Whether a pointer frame was held back until the pending motion is sent */
+    bool frame_pending = false;
+    uint32_t pending_motion_time = 0;
+    int64_t last_focus_update    = 0;
+    wf::wl_timer<false> pending_motion_timer;
+    pointer_motion_stats_t motion_stats;
+
+    /** Update the focus after the cursor moved, or schedule the update if motion is coalesced */
+    void handle_motion(uint32_t time_msec);
+
+    /** Run the pending focus update, if any */
+    void flush_pending_motion();
+
+    /** The minimal time between focus updates caused by motion */
+    int64_t get_motion_interval_ms();
 };
 }
 
@@ -1,20 +1,10 @@
 #include "wayfire/signal-provider.hpp"
 #include "wayfire/txn/transaction.hpp"
 #include <algorithm>
+#include <unordered_map>
 #include <wayfire/txn/transaction-manager.hpp>
 #include <wayfire/debug.hpp>
 
-static bool transactions_intersect(const wf::txn::transaction_uptr& a, const wf::txn::transaction_uptr& b)
-{
-    const auto& obj_a = a->get_objects();
-    const auto& obj_b = b->get_objects();
-
-    return std::any_of(obj_a.begin(), obj_a.end(), [&] (const wf::txn::transaction_object_sptr& x)
-    {
-        return std::find(obj_b.begin(), obj_b.end(), x) != obj_b.end();
-    });
-}
-
 struct wf::txn::transaction_manager_t::impl
 {
     impl()
@@ -24,85 +14,173 @@ struct wf::txn::transaction_manager_t::impl
 
     void schedule_transaction(transaction_uptr tx)
     {
+        if (batch_depth > 0)
+        {
+            LOGC(TXN, "Adding transaction ", tx.get(), " to batch");
+            if (!batched)
+            {
+                batched = std::move(tx);
+            } else
+            {
+                for (auto& obj : tx->get_objects())
+                {
+                    batched->add_object(obj);
+                }
+            }
+
+            return;
+        }
+
         LOGC(TXN, "Scheduling transaction ", tx.get());
 
         // Step 1: add any objects which are directly or indirectly connected to the objects in tx
-        coalesce_transactions(tx);
+        auto merged = coalesce_transactions(tx);
 
         // Step 2: remove any transactions we don't need anymore, as their objects were added to tx
-        remove_conflicts(tx);
+        remove_conflicts(merged);
 
-        // Step 3: schedule tx for execution. At this point, there are no conflicts in all pending txs
+        // Step 3: schedule tx for execution. At this point, there are no conflicts in all pending txs.
+        // All objects of the removed transactions are part of tx now, so their index entries are overwritten.
+        for (auto& obj : tx->get_objects())
+        {
+            pending_index[obj.get()] = tx.get();
+        }
+
+        if (tx->get_objects().empty())
+        {
+            // Nothing can block an empty transaction
+            idle_clear_done.run_once();
+            do_commit(std::move(tx));
+            return;
+        }
+
+        // Only tx may have become ready to commit, the other pending transactions are blocked as before.
+        idle_clear_done.run_once();
+        auto raw = tx.get();
         pending.push_back(std::move(tx));
-        consider_commit();
+        if (can_commit_transaction(raw))
+        {
+            commit_pending(raw);
+        }
+    }
+
+    void begin_batch()
+    {
+        ++batch_depth;
+    }
+
+    void end_batch()
+    {
+        wf::dassert(batch_depth > 0, "end_batch() without begin_batch()");
+        if ((--batch_depth == 0) && batched)
+        {
+            schedule_transaction(std::move(batched));
+        }
     }
 
-    void coalesce_transactions(const transaction_uptr& tx)
+    /**
+     * Add the objects of all pending transactions which share objects with tx to tx.
+     *
+     * Pending transactions never share objects with each other, so each object of tx belongs to at most one
+     * pending transaction, which can be found in the pending index. Objects added from a merged transaction
+     * cannot belong to any other pending transaction, so a single pass over the objects of tx is enough.
+     *
+     * @return The pending transactions which were merged into tx.
+     */
+    std::vector<transaction_t*> coalesce_transactions(const transaction_uptr& tx)
     {
-        while (true)
+        std::vector<transaction_t*> merged;
+        const size_t initial_objects = tx->get_objects().size();
+        for (size_t i = 0; i < initial_objects; i++)
         {
-            const size_t start_size = tx->get_objects().size();
-            for (auto& existing : pending)
+            auto it = pending_index.find(tx->get_objects()[i].get());
+            if ((it == pending_index.end()) ||
+                (std::find(merged.begin(), merged.end(), it->second) != merged.end()))
             {
-                if (transactions_intersect(existing, tx))
-                {
-                    for (auto& obj : existing->get_objects())
-                    {
-                        tx->add_object(obj);
-                    }
-                }
+                continue;
             }
 
-            if (start_size == tx->get_objects().size())
+            merged.push_back(it->second);
+            for (auto& obj : it->second->get_objects())
             {
-                // No new objects were added in the last iteration => done
-                break;
+                tx->add_object(obj);
             }
         }
+
+        return merged;
     }
 
-    void remove_conflicts(const transaction_uptr& tx)
+    void remove_conflicts(const std::vector<transaction_t*>& merged)
     {
+        if (merged.empty())
+        {
+            return;
+        }
+
         auto it = std::remove_if(pending.begin(), pending.end(), [&] (const transaction_uptr& existing)
         {
-            return transactions_intersect(existing, tx);
+            return std::find(merged.begin(), merged.end(), existing.get()) != merged.end();
         });
         pending.erase(it, pending.end());
     }
 
-    // Try to commit as many transactions as possible
-    void consider_commit()
+    /**
+     * Try to commit the pending transactions which contain any of the given objects.
+     *
+     * The merging strategy guarantees no conflicts between pending transactions, so we just need to check
+     * conflicts between committed and pending. A pending transaction is blocked only by the committed
+     * transactions it shares objects with, so only transactions which share objects with a newly scheduled
+     * or applied transaction need to be checked.
+     */
+    void consider_commit(const std::vector<transaction_object_sptr>& objects)
     {
         idle_clear_done.run_once();
-
-        // Implementation note: the merging strategy guarantees no conflicts between pending transactions,
-        // so we just need to check conflicts between committed and pending
-        for (size_t idx = 0; idx < pending.size();)
+        for (auto& obj : objects)
         {
-            if (can_commit_transaction(pending[idx]))
+            // Note: the pending transactions may change after each commit, because some objects emit ready
+            // directly inside commit(), so the index is consulted again for each object.
+            auto it = pending_index.find(obj.get());
+            if ((it != pending_index.end()) && can_commit_transaction(it->second))
             {
-                auto tx = std::move(pending[idx]);
-                pending.erase(pending.begin() + idx);
-                do_commit(std::move(tx));
-                // Note: the container may change after this operation, because some objects emit ready
-                // directly inside commit().
-            } else
-            {
-                ++idx;
+                commit_pending(it->second);
             }
         }
     }
 
-    bool can_commit_transaction(const transaction_uptr& tx)
+    void commit_pending(transaction_t *tx)
+    {
+        auto it = std::find_if(pending.begin(), pending.end(), [&] (auto& existing)
+        {
+            return existing.get() == tx;
+        });
+
+        wf::dassert(it != pending.end(), "Transaction not found in pending list");
+        for (auto& obj : tx->get_objects())
+        {
+            pending_index.erase(obj.get());
+        }
+
+        auto uptr = std::move(*it);
+        pending.erase(it);
+        do_commit(std::move(uptr));
+    }
+
+    bool can_commit_transaction(const transaction_t *tx)
     {
-        return std::none_of(committed.begin(), committed.end(), [&] (const transaction_uptr& comm)
+        return std::none_of(tx->get_objects().begin(), tx->get_objects().end(), [&] (auto& obj)
         {
-            return transactions_intersect(tx, comm);
+            return committed_index.count(obj.get());
         });
     }
 
     void do_commit(transaction_uptr tx)
     {
+        // Committed transactions never share objects either, see can_commit_transaction().
+        for (auto& obj : tx->get_objects())
+        {
+            committed_index[obj.get()] = tx.get();
+        }
+
         tx->connect(&on_tx_apply);
         committed.push_back(std::move(tx));
         // Note: this might immediately trigger tx_apply if all objects are already ready!
@@ -114,6 +192,16 @@ struct wf::txn::transaction_manager_t::impl
     std::vector<transaction_uptr> pending;
     wf::wl_idle_call idle_clear_done;
 
+    // The pending/committed transaction each object belongs to. Pending transactions do not share any
+    // objects with each other, and neither do committed transactions, so each object belongs to at most one
+    // pending and one committed transaction.
+    std::unordered_map<transaction_object_t*, transaction_t*> pending_index;
+    std::unordered_map<transaction_object_t*, transaction_t*> committed_index;
+
+    int batch_depth = 0;
+    // The transaction into which all transactions scheduled during a batch are merged
+    transaction_uptr batched;
+
     wf::signal::connection_t<transaction_applied_signal> on_tx_apply = [&] (transaction_applied_signal *ev)
     {
         // Move transactions which are done from committed to done.
@@ -124,9 +212,14 @@ struct wf::txn::transaction_manager_t::impl
         });
 
         wf::dassert(it != committed.end(), "Transaction not found in committed list");
+        auto objects = (*it)->get_objects();
+        for (auto& obj : objects)
+        {
+            committed_index.erase(obj.get());
+        }
 
         done.push_back(std::move(*it));
         committed.erase(it);
-        consider_commit();
+        consider_commit(objects);
     };
 };
@@ -1,6 +1,7 @@
 #include "wayfire/option-wrapper.hpp"
 #include "wayfire/txn/transaction-object.hpp"
 #include <wayfire/txn/transaction.hpp>
+#include <algorithm>
 #include <sstream>
 #include <wayfire/debug.hpp>
 
@@ -11,6 +12,17 @@ std::string wf::txn::transaction_object_t::stringify() const
     return out.str();
 }
 
+const wf::txn::readiness_stats_t& wf::txn::transaction_object_t::get_readiness_stats() const
+{
+    return readiness_stats;
+}
+
+bool wf::txn::readiness_stats_t::is_slow(uint32_t consecutive_timeouts) const
+{
+    return (consecutive_timeouts > 0) && (this->consecutive_timeouts >= consecutive_timeouts) &&
+           (consecutive_skipped < MAX_CONSECUTIVE_SKIPPED);
+}
+
 wf::txn::transaction_t::transaction_t(uint64_t timeout, timer_setter_t timer_setter)
 {
     this->timeout = timeout;
@@ -19,11 +31,23 @@ wf::txn::transaction_t::transaction_t(uint64_t timeout, timer_setter_t timer_set
     this->on_object_ready = [=] (object_ready_signal *ev)
     {
         this->count_ready_objects++;
-        LOGC(TXNI, "Transaction ", this, " object ", ev->self->stringify(), " became ready (",
-            count_ready_objects, "/", this->objects.size(), ")");
+        record_ready(ev->self);
+        LOGC(TXNI, "Transaction ", this, " object ", ev->self->stringify(), " became ready after ",
+            ev->self->readiness_stats.last_latency_us, "us (", count_ready_objects, "/",
+            this->objects.size(), ")");
 
         wf::dassert(count_ready_objects <= (int)this->objects.size(), "object emitted ready multiple times?");
-        if (count_ready_objects == (int)this->objects.size())
+        auto it = std::find(skipped_objects.begin(), skipped_objects.end(), ev->self);
+        if (it != skipped_objects.end())
+        {
+            // A slow object was faster than the others this time, nothing to skip anymore.
+            skipped_objects.erase(it);
+        } else
+        {
+            --count_waiting_objects;
+        }
+
+        if (count_waiting_objects == 0)
         {
             apply(false);
         }
@@ -37,14 +61,36 @@ const std::vector<wf::txn::transaction_object_sptr>& wf::txn::transaction_t::get
 
 void wf::txn::transaction_t::add_object(transaction_object_sptr object)
 {
-    auto it = std::find(objects.begin(), objects.end(), object);
-    if (it == objects.end())
+    if (!has_object(object))
     {
         LOGC(TXNI, "Transaction ", this, " add object ", object->stringify());
+        if (!object_index.empty())
+        {
+            object_index.insert(object.get());
+        }
+
         objects.push_back(object);
     }
 }
 
+bool wf::txn::transaction_t::has_object(const transaction_object_sptr& object) const
+{
+    if (objects.size() <= MAX_UNINDEXED_OBJECTS)
+    {
+        return std::find(objects.begin(), objects.end(), object) != objects.end();
+    }
+
+    if (object_index.empty())
+    {
+        for (auto& obj : objects)
+        {
+            object_index.insert(obj.get());
+        }
+    }
+
+    return object_index.count(object.get());
+}
+
 void wf::txn::transaction_t::commit()
 {
     LOGC(TXN, "Committing transaction ", this, " with timeout ", this->timeout);
@@ -55,6 +101,30 @@ void wf::txn::transaction_t::commit()
         return;
     }
 
+    commit_time = std::chrono::steady_clock::now();
+    for (auto& obj : this->objects)
+    {
+        obj->readiness_stats.commits++;
+        obj->awaiting_ready = true;
+        if (is_slow(obj.get()))
+        {
+            skipped_objects.push_back(obj.get());
+        }
+    }
+
+    if (skipped_objects.size() == objects.size())
+    {
+        // Only slow objects, there is nothing else to wait for.
+        skipped_objects.clear();
+    }
+
+    for (auto& obj : skipped_objects)
+    {
+        LOGC(TXN, "Transaction ", this, " does not wait for slow object ", obj->stringify(), " (",
+            obj->readiness_stats.consecutive_timeouts, " timeouts in a row)");
+    }
+
+    count_waiting_objects = objects.size() - skipped_objects.size();
     for (auto& obj : this->objects)
     {
         obj->connect(&on_object_ready);
@@ -63,7 +133,7 @@ void wf::txn::transaction_t::commit()
 
     timer_setter(this->timeout, [=] ()
     {
-        if (count_ready_objects < (int)this->objects.size())
+        if (count_waiting_objects > 0)
         {
             apply(true);
         }
@@ -72,13 +142,56 @@ void wf::txn::transaction_t::commit()
     });
 }
 
+void wf::txn::transaction_t::set_slow_object_threshold(uint32_t consecutive_timeouts)
+{
+    this->slow_object_threshold = consecutive_timeouts;
+}
+
+bool wf::txn::transaction_t::is_slow(const transaction_object_t *object) const
+{
+    return object->readiness_stats.is_slow(slow_object_threshold);
+}
+
+void wf::txn::transaction_t::record_ready(transaction_object_t *object)
+{
+    auto& stats = object->readiness_stats;
+    auto latency = std::chrono::steady_clock::now() - commit_time;
+
+    object->awaiting_ready = false;
+    stats.last_latency_us  = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+    stats.max_latency_us   = std::max(stats.max_latency_us, stats.last_latency_us);
+    stats.average_latency_us = (stats.average_latency_us == 0) ? stats.last_latency_us :
+        (7 * stats.average_latency_us + stats.last_latency_us) / 8;
+    stats.consecutive_timeouts = 0;
+    stats.consecutive_skipped  = 0;
+}
+
 void wf::txn::transaction_t::apply(bool did_timeout)
 {
     on_object_ready.disconnect();
+    count_waiting_objects = 0;
 
     LOGC(TXN, "Applying transaction ", this, " timed_out: ", did_timeout);
     for (auto& obj : this->objects)
     {
+        if (obj->awaiting_ready)
+        {
+            auto& stats = obj->readiness_stats;
+            obj->awaiting_ready = false;
+            if (did_timeout)
+            {
+                stats.timeouts++;
+                stats.consecutive_timeouts++;
+                stats.consecutive_skipped = 0;
+                LOGC(TXN, "Transaction ", this, " timed out waiting for ", obj->stringify(), " (",
+                    stats.consecutive_timeouts, " timeouts in a row)");
+            } else
+            {
+                stats.skipped++;
+                stats.consecutive_skipped++;
+            }
+        }
+
         obj->apply();
     }
 
@@ -116,7 +229,10 @@ std::unique_ptr<wf::txn::transaction_t> wf::txn::transaction_t::create(int64_t t
         timeout = tx_timeout;
     }
 
-    return std::make_unique<wayfire_default_transaction_t>(timeout);
+    static wf::option_wrapper_t<int> slow_client_timeouts{"core/transaction_slow_client_timeouts"};
+    auto tx = std::make_unique<wayfire_default_transaction_t>(timeout);
+    tx->set_slow_object_threshold(std::max(0, (int)slow_client_timeouts));
+    return tx;
 }
 
 void wf::txn::emit_object_ready(wf::txn::transaction_object_t *obj)
@@ -12,6 +12,7 @@
 #include <wayland-server.h>
 
 #include "core/opengl-priv.hpp"
+#include "core/scene-priv.hpp"
 #include "wayfire/config-backend.hpp"
 #include "core/plugin-loader.hpp"
 #include "core/core-impl.hpp"
@@ -40,6 +41,7 @@ static void print_help()
         std::endl;
     std::cout << " -R,  --damage-rerender   rerender damaged regions" << std::endl;
     std::cout << " -l,  --legacy-wl-drm     use legacy drm for wayland clients" << std::endl;
+    std::cout << "      --validate-bbox-cache  check cached bounding boxes of scenegraph nodes" << std::endl;
     std::cout << " -v,  --version           print version and exit" << std::endl;
     exit(0);
 }
@@ -278,6 +280,7 @@ int main(int argc, char *argv[])
         {"help", no_argument, NULL, 'h'},
         {"version", no_argument, NULL, 'v'},
         {"exit-on-gles-error", no_argument, NULL, '$'},
+        {"validate-bbox-cache", no_argument, NULL, 'V'},
         {0, 0, NULL, 0}
     };
 
@@ -333,6 +336,10 @@ int main(int argc, char *argv[])
             OpenGL::exit_on_gles_error = true;
             break;
 
+          case 'V':
+            wf::scene::validate_bounding_box_cache = true;
+            break;
+
           case 'd':
             log_level = wf::log::LOG_LEVEL_DEBUG;
 
@@ -0,0 +1,40 @@
+#include <wayfire/frame-arena.hpp>
+#include <wayfire/scene-render.hpp>
+
+namespace wf
+{
+static frame_arena_t *current_frame_arena = nullptr;
+
+frame_arena_t::frame_arena_t() = default;
+frame_arena_t::~frame_arena_t() = default;
+
+std::vector<scene::render_instruction_t>& frame_arena_t::get_instruction_list()
+{
+    if (next_instruction_list == instruction_lists.size())
+    {
+        instruction_lists.push_back(std::make_unique<std::vector<scene::render_instruction_t>>());
+    }
+
+    return *instruction_lists[next_instruction_list++];
+}
+
+void frame_arena_t::reset()
+{
+    for (size_t i = 0; i < next_instruction_list; i++)
+    {
+        instruction_lists[i]->clear();
+    }
+
+    next_instruction_list = 0;
+}
+
+frame_arena_t*frame_arena_t::get_current()
+{
+    return current_frame_arena;
+}
+
+void frame_arena_t::set_current(frame_arena_t *arena)
+{
+    current_frame_arena = arena;
+}
+}
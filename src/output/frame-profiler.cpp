@@ -0,0 +1,314 @@
+#include <wayfire/frame-profiler.hpp>
+#include <wayfire/scene-render.hpp>
+#include <wayfire/util.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <typeinfo>
+
+namespace wf
+{
+const char *frame_phase_name(frame_phase_t phase)
+{
+    static constexpr const char *names[] = {
+        "effects-pre",
+        "effects-damage",
+        "direct-scanout",
+        "start-frame",
+        "output-pass",
+        "overlay",
+        "submit",
+        "pass-done",
+        "post-effects",
+        "sw-cursors",
+        "swap",
+        "post-paint",
+    };
+
+    static_assert((sizeof(names) / sizeof(names[0])) == (size_t)frame_phase_t::TOTAL);
+    return names[(size_t)phase];
+}
+
+static const char *frame_result_name(frame_result_t result)
+{
+    switch (result)
+    {
+      case frame_result_t::RENDERED:
+        return "rendered";
+      case frame_result_t::SCANOUT:
+        return "scanout";
+      case frame_result_t::SKIPPED:
+        return "skipped";
+      case frame_result_t::FAILED:
+        return "failed";
+    }
+
+    return "unknown";
+}
+
+static std::string demangle_type_name(const char *name)
+{
+    if (!name)
+    {
+        return "unknown";
+    }
+
+    int status;
+    char *demangled = abi::__cxa_demangle(name, NULL, NULL, &status);
+    std::string result = (status == 0) ? demangled : name;
+    free(demangled);
+    return result;
+}
+
+frame_profiler_t::frame_profiler_t(std::string name, uint32_t id) : name(std::move(name)), id(id)
+{}
+
+frame_profiler_t::~frame_profiler_t() = default;
+
+void frame_profiler_t::set_enabled(bool enabled)
+{
+    if (enabled == is_enabled())
+    {
+        return;
+    }
+
+    frame_active = false;
+    published.store(0, std::memory_order_relaxed);
+    skipped.store(0, std::memory_order_relaxed);
+    if (enabled)
+    {
+        frames = std::make_unique<std::array<frame_profile_t, CAPACITY>>();
+    } else
+    {
+        frames.reset();
+    }
+}
+
+frame_profile_t& frame_profiler_t::current()
+{
+    return (*frames)[published.load(std::memory_order_relaxed) % CAPACITY];
+}
+
+void frame_profiler_t::begin_frame()
+{
+    if (!is_enabled())
+    {
+        return;
+    }
+
+    auto& frame = current();
+    frame.sequence = published.load(std::memory_order_relaxed);
+    frame.result   = frame_result_t::SKIPPED;
+    frame.frame    = {get_current_time_ns(), 0};
+    frame.phases.fill({});
+    frame.num_instructions     = 0;
+    frame.num_instance_samples = 0;
+    frame_active = true;
+}
+
+void frame_profiler_t::end_frame(frame_result_t result)
+{
+    if (!is_enabled() || !frame_active)
+    {
+        return;
+    }
+
+    frame_active = false;
+    if (result == frame_result_t::SKIPPED)
+    {
+        // The slot is reused by the next frame.
+        skipped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto& frame = current();
+    frame.result = result;
+    frame.frame.duration_ns = get_current_time_ns() - frame.frame.start_ns;
+
+    // Publish the frame: readers only look at slots before the published counter.
+    published.fetch_add(1, std::memory_order_release);
+}
+
+void frame_profiler_t::begin_phase(frame_phase_t phase)
+{
+    if (!is_enabled() || !frame_active)
+    {
+        return;
+    }
+
+    current().phases[(size_t)phase] = {get_current_time_ns(), 0};
+}
+
+void frame_profiler_t::end_phase(frame_phase_t phase)
+{
+    if (!is_enabled() || !frame_active)
+    {
+        return;
+    }
+
+    auto& interval = current().phases[(size_t)phase];
+    if (interval.start_ns >= 0)
+    {
+        interval.duration_ns = get_current_time_ns() - interval.start_ns;
+    }
+}
+
+void frame_profiler_t::add_instance_sample(frame_instance_sample_t::kind_t kind,
+    const scene::render_instance_t *instance, int64_t start_ns, int64_t end_ns)
+{
+    if (!is_enabled() || !frame_active)
+    {
+        return;
+    }
+
+    auto& frame = current();
+    frame_instance_sample_t sample;
+    sample.kind     = kind;
+    sample.instance = instance;
+    sample.type_name = instance ? typeid(*instance).name() : nullptr;
+    sample.interval  = {start_ns, end_ns - start_ns};
+
+    if (frame.num_instance_samples < frame_profile_t::MAX_INSTANCE_SAMPLES)
+    {
+        frame.instance_samples[frame.num_instance_samples++] = sample;
+        return;
+    }
+
+    // Buffer is full, replace the cheapest sample if the new one is more expensive.
+    auto cheapest = std::min_element(frame.instance_samples.begin(), frame.instance_samples.end(),
+        [] (const auto& a, const auto& b) { return a.interval.duration_ns < b.interval.duration_ns; });
+    if (cheapest->interval.duration_ns < sample.interval.duration_ns)
+    {
+        *cheapest = sample;
+    }
+}
+
+void frame_profiler_t::set_num_instructions(uint32_t count)
+{
+    if (!is_enabled() || !frame_active)
+    {
+        return;
+    }
+
+    current().num_instructions = count;
+}
+
+std::vector<frame_profile_t> frame_profiler_t::get_frames(size_t max_frames) const
+{
+    std::vector<frame_profile_t> result;
+    if (!is_enabled())
+    {
+        return result;
+    }
+
+    const uint64_t end = published.load(std::memory_order_acquire);
+    const uint64_t count = std::min<uint64_t>({end, max_frames, CAPACITY - 1});
+    result.reserve(count);
+    for (uint64_t seq = end - count; seq < end; seq++)
+    {
+        result.push_back((*frames)[seq % CAPACITY]);
+    }
+
+    return result;
+}
+
+uint64_t frame_profiler_t::get_num_skipped_frames() const
+{
+    return skipped.load(std::memory_order_relaxed);
+}
+
+static double ns_to_us(int64_t ns)
+{
+    return ns / 1000.0;
+}
+
+wf::json_t frame_profiler_t::frames_to_json(size_t max_frames) const
+{
+    wf::json_t result = wf::json_t::array();
+    for (const auto& frame : get_frames(max_frames))
+    {
+        wf::json_t js;
+        js["sequence"] = (uint64_t)frame.sequence;
+        js["result"]   = frame_result_name(frame.result);
+        js["start-us"] = ns_to_us(frame.frame.start_ns);
+        js["duration-us"] = ns_to_us(frame.frame.duration_ns);
+        js["instructions"] = (uint64_t)frame.num_instructions;
+
+        wf::json_t phases;
+        for (size_t i = 0; i < (size_t)frame_phase_t::TOTAL; i++)
+        {
+            if (frame.phases[i].start_ns >= 0)
+            {
+                phases[frame_phase_name((frame_phase_t)i)] = ns_to_us(frame.phases[i].duration_ns);
+            }
+        }
+
+        js["phases-us"] = phases;
+
+        wf::json_t instances = wf::json_t::array();
+        for (size_t i = 0; i < frame.num_instance_samples; i++)
+        {
+            const auto& sample = frame.instance_samples[i];
+            wf::json_t inst;
+            inst["type"] = demangle_type_name(sample.type_name);
+            inst["kind"] = (sample.kind == frame_instance_sample_t::SCHEDULE) ? "schedule" : "render";
+            inst["duration-us"] = ns_to_us(sample.interval.duration_ns);
+            instances.append(inst);
+        }
+
+        js["instances"] = instances;
+        result.append(js);
+    }
+
+    return result;
+}
+
+void frame_profiler_t::append_chrome_trace_events(wf::json_t& events, size_t max_frames) const
+{
+    auto make_event = [&] (const std::string& event_name, const char *category, int tid,
+                           const frame_interval_t& interval)
+    {
+        wf::json_t ev;
+        ev["name"] = event_name;
+        ev["cat"]  = category;
+        ev["ph"]   = "X";
+        ev["pid"]  = (uint64_t)id;
+        ev["tid"]  = tid;
+        ev["ts"]   = ns_to_us(interval.start_ns);
+        ev["dur"]  = ns_to_us(interval.duration_ns);
+        return ev;
+    };
+
+    wf::json_t process_name;
+    process_name["name"] = "process_name";
+    process_name["ph"]   = "M";
+    process_name["pid"]  = (uint64_t)id;
+    process_name["args"]["name"] = name;
+    events.append(process_name);
+
+    for (const auto& frame : get_frames(max_frames))
+    {
+        auto frame_ev = make_event("frame", "frame", 0, frame.frame);
+        frame_ev["args"]["sequence"]     = (uint64_t)frame.sequence;
+        frame_ev["args"]["result"]       = frame_result_name(frame.result);
+        frame_ev["args"]["instructions"] = (uint64_t)frame.num_instructions;
+        events.append(frame_ev);
+
+        for (size_t i = 0; i < (size_t)frame_phase_t::TOTAL; i++)
+        {
+            if (frame.phases[i].start_ns >= 0)
+            {
+                events.append(make_event(frame_phase_name((frame_phase_t)i), "phase", 1, frame.phases[i]));
+            }
+        }
+
+        for (size_t i = 0; i < frame.num_instance_samples; i++)
+        {
+            const auto& sample = frame.instance_samples[i];
+            const bool is_schedule = (sample.kind == frame_instance_sample_t::SCHEDULE);
+            events.append(make_event(demangle_type_name(sample.type_name),
+                is_schedule ? "schedule" : "render", is_schedule ? 2 : 3, sample.interval));
+        }
+    }
+}
+}
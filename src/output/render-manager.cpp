@@ -3,6 +3,8 @@
 #include "wayfire/config-backend.hpp"
 #include "wayfire/core.hpp"
 #include "wayfire/debug.hpp"
+#include "wayfire/frame-arena.hpp"
+#include "wayfire/frame-profiler.hpp"
 #include "wayfire/geometry.hpp"
 #include "wayfire/opengl.hpp"
 #include "wayfire/region.hpp"
@@ -13,8 +15,10 @@
 #include "wayfire/output.hpp"
 #include "wayfire/util.hpp"
 #include "../main.hpp"
+#include "render-time-model.hpp"
 #include "wayfire/workspace-set.hpp" // IWYU pragma: keep
 #include <algorithm>
+#include <array>
 #include <filesystem>
 #include <fstream>
 #include <wayfire/nonstd/reverse.hpp>
@@ -74,8 +78,8 @@ struct swapchain_damage_manager_t
                 this->damage_buffer(region, true);
             };
 
-            render_instances.clear();
-            root->gen_render_instances(render_instances, push_damage, wo);
+            // Only the instances of the changed subtrees are regenerated, the rest is reused.
+            scene::regen_render_instances(root, render_instances, push_damage, wo);
         }
 
         if (update_mask & recompute_visibility_on)
@@ -469,7 +473,13 @@ struct effect_hook_manager_t
  */
 struct postprocessing_manager_t
 {
-    using post_container_t = wf::safe_list_t<post_hook_t*>;
+    struct post_effect_t
+    {
+        post_hook_t *hook;
+        uint32_t flags;
+    };
+
+    using post_container_t = wf::safe_list_t<post_effect_t>;
     post_container_t post_effects;
     wf::auxilliary_buffer_t post_buffers[2];
     /* Buffer to which other operations render to */
@@ -502,22 +512,41 @@ struct postprocessing_manager_t
         output_height = height;
         for (auto& buffer : post_buffers)
         {
-            buffer.allocate({width, height});
+            buffer.allocate({width, height}, 1.0, wf::buffer_allocation_hints_t{.owner = "postprocessing"});
         }
     }
 
-    void add_post(post_hook_t *hook)
+    void add_post(post_hook_t *hook, uint32_t flags)
     {
-        post_effects.push_back(hook);
+        post_effects.push_back({hook, flags});
         output->render->damage_whole_idle();
     }
 
     void rem_post(post_hook_t *hook)
     {
-        post_effects.remove_all(hook);
+        post_effects.remove_if([=] (const post_effect_t& effect)
+        {
+            return effect.hook == hook;
+        });
         output->render->damage_whole_idle();
     }
 
+    /**
+     * Whether the post effects need the whole output as input, in which case
+     * the whole output has to be processed each frame. Chains of pointwise
+     * effects only process the damaged region.
+     */
+    bool needs_full_redraw()
+    {
+        bool full = false;
+        post_effects.for_each([&] (const post_effect_t& effect)
+        {
+            full |= !(effect.flags & POST_HOOK_POINTWISE);
+        });
+
+        return full;
+    }
+
     /* Run all postprocessing effects, rendering to alternating buffers and
      * finally to the screen.
      *
@@ -530,9 +559,9 @@ struct postprocessing_manager_t
         post_effects.for_each([&] (auto post) -> void
         {
             int next_idx = 1 - cur_idx;
-            wf::render_buffer_t dst_buffer = (post == post_effects.back() ?
+            wf::render_buffer_t dst_buffer = (post.hook == post_effects.back().hook ?
                 final_target : post_buffers[next_idx].get_renderbuffer());
-            (*post)(post_buffers[cur_idx], dst_buffer);
+            (*post.hook)(post_buffers[cur_idx], dst_buffer);
             cur_idx = next_idx;
         });
     }
@@ -702,6 +731,12 @@ class depth_buffer_manager_t
  * delay is increased by one. If the next frame is delayed, then
  * `increase_window` is doubled, otherwise, it is halved
  * (but it must stay between `MIN_INCREASE_WINDOW` and `MAX_INCREASE_WINDOW`).
+ *
+ * Alternatively, if core/repaint_scheduling is set to `render-time`, the delay is computed from the measured
+ * render times of the previous frames (see render_time_model_t): Wayfire starts repainting as late as
+ * possible so that the predicted render time plus a safety margin still fits before the next vblank.
+ * In this mode, there is no probing for a larger delay, and missed frames only temporarily enlarge the
+ * safety margin.
  */
 struct repaint_delay_manager_t
 {
@@ -713,6 +748,7 @@ struct repaint_delay_manager_t
             this->refresh_nsec = ev->refresh;
         });
         on_present.connect(&output->handle->events.present);
+        output->connect(&on_configuration_changed);
     }
 
     /**
@@ -725,11 +761,34 @@ struct repaint_delay_manager_t
         last_pageflip = -1;
     }
 
+    /**
+     * @return Whether the delay is computed from the measured render times, i.e whether
+     *   frame_rendered() should be called after each frame.
+     */
+    bool uses_render_time_model() const
+    {
+        return scheduling.value() == "render-time";
+    }
+
+    /**
+     * Report the total render time of the last frame (CPU and GPU time).
+     */
+    void frame_rendered(int64_t render_time_ns)
+    {
+        model.add_sample(render_time_ns);
+    }
+
     /**
      * Starting a new frame.
      */
     void start_frame()
     {
+        if (uses_render_time_model())
+        {
+            update_predicted_delay();
+            return;
+        }
+
         if (last_pageflip == -1)
         {
             last_pageflip = get_current_time();
@@ -790,6 +849,42 @@ struct repaint_delay_manager_t
   private:
     int delay = 0;
 
+    /** Minimal time left between the predicted end of rendering and the next vblank. */
+    static constexpr int64_t SAFETY_MARGIN_NS = 1'000'000; // 1ms
+    /** How much to enlarge the safety margin after a missed frame. */
+    static constexpr int64_t MISS_PENALTY_NS = 500'000; // 0.5ms
+    render_time_model_t model;
+    int64_t extra_margin_ns = 0;
+
+    void update_predicted_delay()
+    {
+        const int64_t now = get_current_time();
+        if ((last_pageflip != -1) && (refresh_nsec > 0))
+        {
+            const int64_t last_frame_len = now - last_pageflip;
+            if (last_frame_len * 1'000'000 > refresh_nsec * 3 / 2)
+            {
+                // We missed last frame, start earlier for a while.
+                extra_margin_ns = std::min(extra_margin_ns + MISS_PENALTY_NS, refresh_nsec / 2);
+            } else
+            {
+                extra_margin_ns = std::max(int64_t(0), extra_margin_ns - MISS_PENALTY_NS / 64);
+            }
+        }
+
+        last_pageflip = now;
+
+        const int64_t predicted = model.predict();
+        if ((predicted < 0) || (refresh_nsec <= 0))
+        {
+            delay = 0;
+            return;
+        }
+
+        const int64_t slack = refresh_nsec - predicted - SAFETY_MARGIN_NS - extra_margin_ns;
+        delay = std::max(int64_t(0), slack / 1'000'000);
+    }
+
     void update_delay(int delta)
     {
         int config_delay = std::max(0,
@@ -828,11 +923,25 @@ struct repaint_delay_manager_t
     // Time of last frame
     int64_t last_pageflip = -1; // -1 is invalid
 
-    int64_t refresh_nsec;
+    int64_t refresh_nsec = 0;
     wf::option_wrapper_t<int> max_render_time{"core/max_render_time"};
     wf::option_wrapper_t<bool> dynamic_delay{"workarounds/dynamic_repaint_delay"};
+    wf::option_wrapper_t<std::string> scheduling{"core/repaint_scheduling"};
 
     wf::wl_listener_wrapper on_present;
+
+    wf::signal::connection_t<wf::output_configuration_changed_signal> on_configuration_changed =
+        [=] (wf::output_configuration_changed_signal *ev)
+    {
+        // Render times measured with another mode, scale or transform do not predict the new render times.
+        const uint32_t relevant = OUTPUT_SOURCE_CHANGE | OUTPUT_MODE_CHANGE | OUTPUT_SCALE_CHANGE |
+            OUTPUT_TRANSFORM_CHANGE;
+        if (ev->changed_fields & relevant)
+        {
+            model.clear();
+            extra_margin_ns = 0;
+        }
+    };
 };
 
 class wf::render_manager::impl
@@ -850,15 +959,19 @@ class wf::render_manager::impl
     std::unique_ptr<repaint_delay_manager_t> delay_manager;
 
     wf::option_wrapper_t<wf::color_t> background_color_opt;
-    std::unique_ptr<wf::render_pass_t> current_pass;
+    // Kept in place instead of allocating a new pass for each frame.
+    std::optional<wf::render_pass_t> current_pass;
     wf::option_wrapper_t<std::string> icc_profile;
+    wf::frame_profiler_t profiler;
+    wf::frame_arena_t frame_arena;
 
     wlr_color_transform *get_color_transform()
     {
         return icc_color_transform;
     }
 
-    impl(output_t *o) : output(o), env_allow_scanout(check_scanout_enabled())
+    impl(output_t *o) : output(o), profiler(o->to_string(), o->get_id()),
+        env_allow_scanout(check_scanout_enabled())
     {
         damage_manager = std::make_unique<swapchain_damage_manager_t>(o);
         effects = std::make_unique<effect_hook_manager_t>();
@@ -875,6 +988,7 @@ class wf::render_manager::impl
                 return;
             }
 
+            collect_render_time();
             delay_manager->start_frame();
 
             auto repaint_delay = delay_manager->get_delay();
@@ -922,6 +1036,40 @@ class wf::render_manager::impl
     wlr_color_transform *icc_color_transform = NULL;
     wlr_buffer_pass_options pass_opts{};
 
+    /** GPU timer for the main render pass, used by the render-time repaint scheduling. */
+    wlr_render_timer *render_timer = NULL;
+    bool render_timer_created = false;
+    /** CPU time of the last rendered frame which is not yet reported to the delay manager, or -1. */
+    int64_t pending_cpu_time_ns = -1;
+
+    wlr_render_timer *get_render_timer()
+    {
+        if (!render_timer_created)
+        {
+            // May fail if the renderer does not support timers, in which case only CPU time is used.
+            render_timer_created = true;
+            render_timer = wlr_render_timer_create(output->handle->renderer);
+        }
+
+        return render_timer;
+    }
+
+    /**
+     * Report the render time of the last rendered frame to the delay manager. This is called at the start of
+     * the next frame, at which point the GPU has finished the previous frame and the timer can be queried.
+     */
+    void collect_render_time()
+    {
+        if (pending_cpu_time_ns < 0)
+        {
+            return;
+        }
+
+        int64_t gpu_time_ns = pass_opts.timer ? wlr_render_timer_get_duration_ns(pass_opts.timer) : -1;
+        delay_manager->frame_rendered(pending_cpu_time_ns + std::max(int64_t(0), gpu_time_ns));
+        pending_cpu_time_ns = -1;
+    }
+
     void reload_icc_profile()
     {
         if (icc_profile.value().empty())
@@ -972,6 +1120,10 @@ class wf::render_manager::impl
     ~impl()
     {
         set_icc_transform(nullptr);
+        if (render_timer)
+        {
+            wlr_render_timer_destroy(render_timer);
+        }
     }
 
     const bool env_allow_scanout;
@@ -1055,10 +1207,12 @@ class wf::render_manager::impl
         params.renderer = output->handle->renderer;
         params.flags    = RPASS_CLEAR_BACKGROUND | RPASS_EMIT_SIGNALS;
 
-        pass_opts.timer = NULL; // TODO: do we care about this? could be useful for dynamic frame scheduling
+        pass_opts.timer = delay_manager->uses_render_time_model() ? get_render_timer() : NULL;
         pass_opts.color_transform = icc_color_transform;
         params.pass_opts   = &pass_opts;
-        this->current_pass = std::make_unique<render_pass_t>(params);
+        params.profiler    = &profiler;
+        params.arena = &frame_arena;
+        this->current_pass.emplace(params);
 
         auto total_damage = current_pass->run_partial();
         if (runtime_config.damage_debug)
@@ -1103,67 +1257,114 @@ class wf::render_manager::impl
      */
     void paint()
     {
+        const int64_t paint_start = get_current_time_ns();
+        profiler.begin_frame();
+
         /* Part 1: frame setup: query damage, etc. */
+        profiler.begin_phase(frame_phase_t::EFFECTS_PRE);
         effects->run_effects(OUTPUT_EFFECT_PRE);
+        profiler.end_phase(frame_phase_t::EFFECTS_PRE);
+
+        profiler.begin_phase(frame_phase_t::EFFECTS_DAMAGE);
         effects->run_effects(OUTPUT_EFFECT_DAMAGE);
+        profiler.end_phase(frame_phase_t::EFFECTS_DAMAGE);
 
-        if (do_direct_scanout())
+        profiler.begin_phase(frame_phase_t::DIRECT_SCANOUT);
+        const bool scanout = do_direct_scanout();
+        profiler.end_phase(frame_phase_t::DIRECT_SCANOUT);
+        if (scanout)
         {
             // Yet another optimization: if we can directly scanout, we should
             // stop the rest of the repaint cycle.
+            profiler.end_frame(frame_result_t::SCANOUT);
             return;
         }
 
+        profiler.begin_phase(frame_phase_t::START_FRAME);
         auto next_frame = damage_manager->start_frame();
+        profiler.end_phase(frame_phase_t::START_FRAME);
         if (!next_frame)
         {
             // Optimization: the output doesn't need a new frame (so isn't damaged), so we can
             // just skip the whole repaint
             delay_manager->skip_frame();
+            profiler.end_frame(frame_result_t::SKIPPED);
             return;
         }
 
         /* Part 2: call the renderer, which sets swap_damage and draws the scenegraph */
+        profiler.begin_phase(frame_phase_t::START_OUTPUT_PASS);
         update_bound_output(next_frame->buffer);
+        wf::frame_arena_t::set_current(&frame_arena);
         this->swap_damage = start_output_pass(next_frame);
+        profiler.end_phase(frame_phase_t::START_OUTPUT_PASS);
 
         /* Part 3: overlay effects */
+        profiler.begin_phase(frame_phase_t::OVERLAY);
         effects->run_effects(OUTPUT_EFFECT_OVERLAY);
         if (output_inhibit_counter)
         {
             current_pass->clear(current_pass->get_target().geometry, {0, 0, 0, 1});
         }
 
+        profiler.end_phase(frame_phase_t::OVERLAY);
+
         /* Part 4: we are done with the main scene. Submit the main render pass. */
+        profiler.begin_phase(frame_phase_t::SUBMIT);
         const bool pass_status = current_pass->submit();
         current_pass.reset();
+        profiler.end_phase(frame_phase_t::SUBMIT);
         if (!pass_status)
         {
             LOGE("Failed to submit render pass!");
             wlr_buffer_unlock(next_frame->buffer);
+            wf::frame_arena_t::set_current(nullptr);
+            frame_arena.reset();
+            profiler.end_frame(frame_result_t::FAILED);
             return;
         }
 
+        profiler.begin_phase(frame_phase_t::PASS_DONE);
         effects->run_effects(OUTPUT_EFFECT_PASS_DONE);
+        profiler.end_phase(frame_phase_t::PASS_DONE);
 
         /* Part 5: finalize the scene: postprocessing effects */
-        if (postprocessing->post_effects.size())
+        profiler.begin_phase(frame_phase_t::POST_EFFECTS);
+        if (postprocessing->needs_full_redraw())
         {
             swap_damage |= damage_manager->get_buffer_extents();
         }
 
         postprocessing->run_post_effects();
+        profiler.end_phase(frame_phase_t::POST_EFFECTS);
 
         /* Part 6: render sw cursors We render software cursors after everything else
          * for consistency with hardware cursor planes */
+        profiler.begin_phase(frame_phase_t::SW_CURSORS);
         render_sw_cursors(next_frame.get());
+        profiler.end_phase(frame_phase_t::SW_CURSORS);
 
         /* Part 7: finalize frame: swap buffers, send frame_done, etc */
+        profiler.begin_phase(frame_phase_t::SWAP);
         damage_manager->swap_buffers(std::move(next_frame), swap_damage);
+        profiler.end_phase(frame_phase_t::SWAP);
+
+        // Nothing refers to the temporary data of the frame anymore
+        wf::frame_arena_t::set_current(nullptr);
+        frame_arena.reset();
 
         unset_bound_output();
         swap_damage.clear();
+
+        profiler.begin_phase(frame_phase_t::POST_PAINT);
         post_paint();
+        profiler.end_phase(frame_phase_t::POST_PAINT);
+        profiler.end_frame(frame_result_t::RENDERED);
+
+        if (delay_manager->uses_render_time_model())
+        {
+            pending_cpu_time_ns = get_current_time_ns() - paint_start;
+        }
     }
 
     void render_sw_cursors(swapchain_damage_manager_t::frame_object_t *next_frame)
@@ -1257,9 +1458,9 @@ void render_manager::rem_effect(effect_hook_t *hook)
     pimpl->effects->rem_effect(hook);
 }
 
-void render_manager::add_post(post_hook_t *hook)
+void render_manager::add_post(post_hook_t *hook, uint32_t flags)
 {
-    pimpl->postprocessing->add_post(hook);
+    pimpl->postprocessing->add_post(hook, flags);
 }
 
 void render_manager::rem_post(post_hook_t *hook)
@@ -1316,7 +1517,17 @@ void render_manager::set_require_depth_buffer(bool require)
 
 wf::render_pass_t*render_manager::get_current_pass()
 {
-    return pimpl->current_pass.get();
+    return pimpl->current_pass ? &*pimpl->current_pass : nullptr;
+}
+
+wf::frame_arena_t& render_manager::get_frame_arena()
+{
+    return pimpl->frame_arena;
+}
+
+wf::frame_profiler_t& render_manager::get_frame_profiler()
+{
+    return pimpl->profiler;
 }
 
 void priv_render_manager_clear_instances(wf::render_manager *manager)
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace wf
+{
+/**
+ * A model of the time Wayfire needs to render a frame on an output.
+ *
+ * The model keeps the total render time (CPU time spent in paint() plus, if available, the GPU time measured
+ * by a wlr_render_timer) of the last frames and predicts the render time of the next frame as a high
+ * percentile of them. Using a percentile instead of the maximum makes the prediction robust against single
+ * outliers (e.g. a client resizing), while still covering almost all regular frames.
+ */
+struct render_time_model_t
+{
+    /** Number of frames to keep in the history. */
+    static constexpr size_t HISTORY = 128;
+    /** The model does not predict anything until it has seen at least that many frames. */
+    static constexpr size_t MIN_SAMPLES = 16;
+    /** The percentile of the render times in the history which is used as a prediction. */
+    static constexpr double PERCENTILE = 0.95;
+
+    void add_sample(int64_t render_time_ns)
+    {
+        samples[next_sample % HISTORY] = render_time_ns;
+        ++next_sample;
+    }
+
+    /** Forget all samples, e.g. because the output's mode changed and the old render times do not apply. */
+    void clear()
+    {
+        next_sample = 0;
+    }
+
+    /**
+     * @return The predicted render time in nanoseconds, or -1 if there is not enough data yet.
+     */
+    int64_t predict() const
+    {
+        const size_t count = std::min(next_sample, HISTORY);
+        if (count < MIN_SAMPLES)
+        {
+            return -1;
+        }
+
+        std::array<int64_t, HISTORY> sorted;
+        std::copy(samples.begin(), samples.begin() + count, sorted.begin());
+        const size_t idx = std::min(count - 1, (size_t)(count * PERCENTILE));
+        std::nth_element(sorted.begin(), sorted.begin() + idx, sorted.begin() + count);
+        return sorted[idx];
+    }
+
+  private:
+    std::array<int64_t, HISTORY> samples;
+    size_t next_sample = 0;
+};
+}
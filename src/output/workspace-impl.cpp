@@ -168,11 +168,19 @@ static size_t find_index_in_parent(wf::scene::node_t *x, wf::scene::node_t *pare
 class workspace_set_root_node_t : public wf::scene::floating_inner_node_t
 {
     uint64_t index;
+    wf::option_wrapper_t<bool> use_input_index{"workarounds/workspace_input_index"};
 
   public:
     workspace_set_root_node_t(uint64_t index) : floating_inner_node_t(true)
     {
         this->index = index;
+
+        // Workspace sets may contain many views, so hit-testing benefits from an index.
+        set_input_index_enabled(use_input_index);
+        use_input_index.set_callback([=] ()
+        {
+            set_input_index_enabled(use_input_index);
+        });
     }
 
     std::string stringify() const override
@@ -82,7 +82,7 @@ class workspace_stream_node_t::workspace_stream_instance_t : public scene::
             wf::render_target_t subtarget = target.translated(offset);
 
             our_damage += offset;
-            for (size_t i = 0; i < instances.size(); i++)
+            for (size_t i = 0; (i < instances.size()) && !our_damage.empty(); i++)
             {
                 if (is_desktop_environment[i])
                 {
@@ -152,6 +152,11 @@ void workspace_stream_node_t::gen_render_instances(
         push_damage));
 }
 
+bool workspace_stream_node_t::depends_on_whole_scene() const
+{
+    return true;
+}
+
 std::string workspace_stream_node_t::stringify() const
 {
     return "workspace-stream of output " + output->to_string() +
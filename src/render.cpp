@@ -1,9 +1,17 @@
 #include <wayfire/render.hpp>
 #include "core/core-impl.hpp"
 #include "wayfire/dassert.hpp"
+#include "wayfire/frame-arena.hpp"
+#include "wayfire/frame-profiler.hpp"
 #include "wayfire/nonstd/reverse.hpp"
 #include "wayfire/opengl.hpp"
+#include "wayfire/util.hpp"
 #include <wayfire/scene-render.hpp>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <unordered_map>
 #include <drm_fourcc.h>
 
 wf::render_buffer_t::render_buffer_t(wlr_buffer *buffer, wf::dimensions_t size)
@@ -12,6 +20,383 @@ wf::render_buffer_t::render_buffer_t(wlr_buffer *buffer, wf::dimensions_t size)
     this->size   = size;
 }
 
+namespace wf
+{
+/**
+ * The approximate size in memory of a buffer with the given DRM format, ignoring padding and modifiers.
+ */
+static uint64_t get_buffer_bytes(wf::dimensions_t size, uint32_t format)
+{
+    uint64_t bytes_per_pixel;
+    switch (format)
+    {
+      case DRM_FORMAT_RGB565:
+      case DRM_FORMAT_BGR565:
+        bytes_per_pixel = 2;
+        break;
+
+      case DRM_FORMAT_RGB888:
+      case DRM_FORMAT_BGR888:
+        bytes_per_pixel = 3;
+        break;
+
+      case DRM_FORMAT_XRGB16161616F:
+      case DRM_FORMAT_XBGR16161616F:
+      case DRM_FORMAT_ARGB16161616F:
+      case DRM_FORMAT_ABGR16161616F:
+      case DRM_FORMAT_XBGR16161616:
+      case DRM_FORMAT_ABGR16161616:
+        bytes_per_pixel = 8;
+        break;
+
+      default:
+        // The 8888 and 2101010 formats, which are the ones used for auxilliary buffers.
+        bytes_per_pixel = 4;
+        break;
+    }
+
+    return bytes_per_pixel * size.width * size.height;
+}
+
+/**
+ * Keeps freed auxilliary buffers for a while, so that they can be reused by the next allocation with the
+ * same size and format. Plugins often free and allocate buffers of the same size repeatedly, for example
+ * when an animation of a workspace or a view with a fixed size starts and ends.
+ *
+ * Only buffers with exactly the requested size are reused, since users of auxilliary buffers map their whole
+ * contents. Buffers whose size changes every frame (for example views resized during an animation) never
+ * hit the pool, which is why the default pool size is small. wayfire-bench reports the hit rate of each
+ * scenario.
+ */
+class aux_buffer_pool_t
+{
+  public:
+    ~aux_buffer_pool_t()
+    {
+        for (auto& entry : entries)
+        {
+            destroy_entry(entry);
+        }
+    }
+
+    struct entry_t
+    {
+        wlr_buffer *buffer;
+        wlr_texture *texture;
+        uint32_t format;
+        int64_t released;
+    };
+
+    /**
+     * Check whether acquire() would find a buffer, without counting a hit or miss.
+     */
+    bool has(wf::dimensions_t size, uint32_t format) const
+    {
+        return std::any_of(entries.begin(), entries.end(), [&] (const entry_t& entry)
+        {
+            return (entry.buffer->width == size.width) && (entry.buffer->height == size.height) &&
+                   (entry.format == format);
+        });
+    }
+
+    std::optional<entry_t> acquire(wf::dimensions_t size, uint32_t format)
+    {
+        // Prefer the most recently released buffer, which is the most likely to still be in caches.
+        for (auto it = entries.rbegin(); it != entries.rend(); ++it)
+        {
+            if ((it->buffer->width == size.width) && (it->buffer->height == size.height) &&
+                (it->format == format))
+            {
+                auto entry = *it;
+                stats.pooled_bytes -= get_bytes(entry);
+                entries.erase(std::next(it).base());
+                ++stats.hits;
+                return entry;
+            }
+        }
+
+        ++stats.misses;
+        return {};
+    }
+
+    /**
+     * Add a buffer to the pool. The pool takes ownership of the buffer and its texture.
+     */
+    void release(wlr_buffer *buffer, wlr_texture *texture, uint32_t format)
+    {
+        const uint64_t budget = get_budget();
+        const entry_t entry   = {buffer, texture, format, wf::get_current_time()};
+        if (get_bytes(entry) > budget)
+        {
+            destroy_entry(entry);
+            return;
+        }
+
+        entries.push_back(entry);
+        stats.pooled_bytes += get_bytes(entry);
+        shrink(budget);
+
+        if (!trim_timer.is_connected())
+        {
+            trim_timer.set_timeout(TRIM_INTERVAL_MS, [=] () { trim(); });
+        }
+    }
+
+    /**
+     * Free the least recently released buffers until the pool uses at most @max_bytes.
+     */
+    void shrink(uint64_t max_bytes)
+    {
+        while (stats.pooled_bytes > max_bytes)
+        {
+            evict(entries.begin());
+        }
+    }
+
+    uint64_t get_pooled_bytes() const
+    {
+        return stats.pooled_bytes;
+    }
+
+    aux_buffer_pool_stats_t get_stats()
+    {
+        stats.pooled_buffers = entries.size();
+        stats.budget_bytes   = get_budget();
+        return stats;
+    }
+
+  private:
+    // Buffers which are not reused within this time are freed.
+    static constexpr int64_t MAX_UNUSED_MS = 5000;
+    static constexpr uint32_t TRIM_INTERVAL_MS = 1000;
+
+    // In release order, oldest first.
+    std::vector<entry_t> entries;
+    aux_buffer_pool_stats_t stats;
+    wf::wl_timer<false> trim_timer;
+
+    static uint64_t get_budget()
+    {
+        static wf::option_wrapper_t<int> buffer_pool_size{"core/buffer_pool_size"};
+        return std::max(0, (int)buffer_pool_size) * 1024ull * 1024ull;
+    }
+
+    static uint64_t get_bytes(const entry_t& entry)
+    {
+        return get_buffer_bytes({entry.buffer->width, entry.buffer->height}, entry.format);
+    }
+
+    static void destroy_entry(const entry_t& entry)
+    {
+        if (entry.texture)
+        {
+            wlr_texture_destroy(entry.texture);
+        }
+
+        wlr_buffer_drop(entry.buffer);
+    }
+
+    void evict(std::vector<entry_t>::iterator it)
+    {
+        stats.pooled_bytes -= get_bytes(*it);
+        ++stats.evictions;
+        destroy_entry(*it);
+        entries.erase(it);
+    }
+
+    void trim()
+    {
+        const int64_t now = wf::get_current_time();
+        while (!entries.empty() && (now - entries.front().released >= MAX_UNUSED_MS))
+        {
+            evict(entries.begin());
+        }
+
+        if (!entries.empty())
+        {
+            trim_timer.set_timeout(TRIM_INTERVAL_MS, [=] () { trim(); });
+        }
+    }
+};
+
+/**
+ * Keeps track of all allocated auxilliary buffers, so that it is possible to find out where offscreen memory
+ * is used, and to limit it.
+ */
+class aux_buffer_registry_t
+{
+  public:
+    void add(const auxilliary_buffer_t *buffer, const char *owner, wf::dimensions_t size, uint32_t format)
+    {
+        buffers[buffer] = {owner ? owner : "unknown", size, format};
+        total_bytes    += get_buffer_bytes(size, format);
+        schedule_log_summary();
+    }
+
+    void remove(const auxilliary_buffer_t *buffer)
+    {
+        auto it = buffers.find(buffer);
+        if (it != buffers.end())
+        {
+            total_bytes -= get_buffer_bytes(it->second.size, it->second.format);
+            buffers.erase(it);
+        }
+    }
+
+    void move(const auxilliary_buffer_t *from, const auxilliary_buffer_t *to)
+    {
+        auto it = buffers.find(from);
+        if (it != buffers.end())
+        {
+            auto record = std::move(it->second);
+            buffers.erase(it);
+            buffers[to] = std::move(record);
+        }
+    }
+
+    /**
+     * Find the scale at which a new buffer fits in the memory budget, see the core/buffer_memory_budget
+     * option. Buffers kept in @pool count against the budget too, so they are freed first, before a new
+     * buffer is downscaled.
+     */
+    float fit_in_budget(wf::dimensions_t size, uint32_t format, aux_buffer_pool_t& pool)
+    {
+        const uint64_t budget = get_budget();
+        const uint64_t needed = get_buffer_bytes(size, format);
+        if ((budget == 0) || (total_bytes + pool.get_pooled_bytes() + needed <= budget))
+        {
+            return 1.0;
+        }
+
+        pool.shrink((budget > total_bytes + needed) ? budget - total_bytes - needed : 0);
+        if (total_bytes + needed <= budget)
+        {
+            return 1.0;
+        }
+
+        const uint64_t available = (budget > total_bytes) ? budget - total_bytes : 0;
+        const float scale = std::max(MIN_BUDGET_SCALE, std::sqrt(1.0 * available / needed));
+        ++downscaled;
+        LOGD("Buffer memory budget exceeded, allocating ", size, " at scale ", scale);
+        return scale;
+    }
+
+    aux_buffer_memory_stats_t get_stats() const
+    {
+        aux_buffer_memory_stats_t stats;
+        for (auto& [_, record] : buffers)
+        {
+            stats.buffers.push_back({record.owner, record.size,
+                get_buffer_bytes(record.size, record.format)});
+        }
+
+        stats.total_bytes  = total_bytes;
+        stats.budget_bytes = get_budget();
+        stats.downscaled_allocations = downscaled;
+        return stats;
+    }
+
+    void fini()
+    {
+        finished = true;
+        log_timer.reset();
+    }
+
+  private:
+    // Buffers are never downscaled more than this, even if they do not fit in the budget at all.
+    static constexpr float MIN_BUDGET_SCALE = 0.25;
+
+    struct record_t
+    {
+        std::string owner;
+        wf::dimensions_t size;
+        uint32_t format;
+    };
+
+    std::unordered_map<const auxilliary_buffer_t*, record_t> buffers;
+    uint64_t total_bytes = 0;
+    uint64_t downscaled  = 0;
+    std::unique_ptr<wf::wl_timer<false>> log_timer;
+    bool finished = false;
+
+    static uint64_t get_budget()
+    {
+        static wf::option_wrapper_t<int> buffer_memory_budget{"core/buffer_memory_budget"};
+        return std::max(0, (int)buffer_memory_budget) * 1024ull * 1024ull;
+    }
+
+    void schedule_log_summary()
+    {
+        static wf::option_wrapper_t<int> log_interval{"core/buffer_memory_log_interval"};
+        if (finished || (log_interval <= 0) || (log_timer && log_timer->is_connected()))
+        {
+            return;
+        }
+
+        if (!log_timer)
+        {
+            log_timer = std::make_unique<wf::wl_timer<false>>();
+        }
+
+        log_timer->set_timeout(log_interval * 1000, [=] ()
+        {
+            log_summary();
+            schedule_log_summary();
+        });
+    }
+
+    void log_summary() const
+    {
+        std::map<std::string, std::pair<uint64_t, uint64_t>> by_owner;
+        for (auto& [_, record] : buffers)
+        {
+            by_owner[record.owner].first++;
+            by_owner[record.owner].second += get_buffer_bytes(record.size, record.format);
+        }
+
+        std::ostringstream out;
+        for (auto& [owner, usage] : by_owner)
+        {
+            out << ", " << owner << ": " << usage.first << " (" << usage.second / 1024 / 1024 << " MiB)";
+        }
+
+        LOGI("Offscreen buffers: ", buffers.size(), " using ", total_bytes / 1024 / 1024, " MiB", out.str());
+    }
+};
+
+static aux_buffer_registry_t aux_buffer_registry;
+static std::unique_ptr<aux_buffer_pool_t> aux_buffer_pool;
+// Set once core has shut down, after which buffers are freed immediately.
+static bool aux_buffer_pool_finished = false;
+
+static aux_buffer_pool_t& get_aux_buffer_pool()
+{
+    if (!aux_buffer_pool)
+    {
+        aux_buffer_pool = std::make_unique<aux_buffer_pool_t>();
+    }
+
+    return *aux_buffer_pool;
+}
+
+void priv_aux_buffer_pool_fini()
+{
+    aux_buffer_pool.reset();
+    aux_buffer_pool_finished = true;
+    aux_buffer_registry.fini();
+}
+
+aux_buffer_pool_stats_t get_aux_buffer_pool_stats()
+{
+    return get_aux_buffer_pool().get_stats();
+}
+
+aux_buffer_memory_stats_t get_aux_buffer_memory_stats()
+{
+    return aux_buffer_registry.get_stats();
+}
+}
+
 wf::auxilliary_buffer_t::auxilliary_buffer_t(auxilliary_buffer_t&& other)
 {
     *this = std::move(other);
@@ -24,11 +409,18 @@ wf::auxilliary_buffer_t& wf::auxilliary_buffer_t::operator =(auxilliary_buffer_t
         return *this;
     }
 
+    free();
     this->texture = other.texture;
     this->buffer  = other.buffer;
+    this->drm_format       = other.drm_format;
+    this->requested_size   = other.requested_size;
+    this->allocation_scale = other.allocation_scale;
+    aux_buffer_registry.move(&other, this);
     other.buffer.buffer = NULL;
     other.texture     = NULL;
     other.buffer.size = {0, 0};
+    other.requested_size   = {0, 0};
+    other.allocation_scale = 1.0;
     return *this;
 }
 
@@ -120,6 +512,17 @@ static wf::dimensions_t sanitize_buffer_size(wf::dimensions_t size, float max_al
     return size;
 }
 
+/**
+ * Scale a buffer size uniformly, rounding up so that the buffer covers the scaled size on both axes.
+ */
+static wf::dimensions_t scale_buffer_size(wf::dimensions_t size, float scale)
+{
+    return {
+        std::max(1, (int)std::ceil(size.width * scale)),
+        std::max(1, (int)std::ceil(size.height * scale)),
+    };
+}
+
 wf::buffer_reallocation_result_t wf::auxilliary_buffer_t::allocate(wf::dimensions_t size, float scale,
     buffer_allocation_hints_t hints)
 {
@@ -132,13 +535,14 @@ wf::buffer_reallocation_result_t wf::auxilliary_buffer_t::allocate(wf::dimension
     size.height = std::max(1.0f, std::ceil(size.height * scale));
     size = sanitize_buffer_size(size, max_buffer_size);
 
-    if (buffer.get_size() == size)
+    // The allocated size may be smaller than requested, see below.
+    if (buffer.get_buffer() && (requested_size == size))
     {
         return buffer_reallocation_result_t::SAME;
     }
 
     free();
-
+    const wf::dimensions_t requested = size;
     auto renderer = wf::get_core().renderer;
     auto format   = choose_format(renderer, hints);
     if (!format)
@@ -147,6 +551,26 @@ wf::buffer_reallocation_result_t wf::auxilliary_buffer_t::allocate(wf::dimension
         return buffer_reallocation_result_t::FAILED;
     }
 
+    // Reusing a pooled buffer does not change the memory in use, so only check the budget otherwise.
+    drm_format = format->format;
+    float downscale = 1.0;
+    if (hints.allow_downscale && !get_aux_buffer_pool().has(size, drm_format))
+    {
+        downscale = aux_buffer_registry.fit_in_budget(size, drm_format, get_aux_buffer_pool());
+        size = scale_buffer_size(requested, downscale);
+    }
+
+    if (auto pooled = get_aux_buffer_pool().acquire(size, drm_format))
+    {
+        buffer.buffer = pooled->buffer;
+        buffer.size   = size;
+        texture = pooled->texture;
+        requested_size   = requested;
+        allocation_scale = downscale;
+        aux_buffer_registry.add(this, hints.owner, size, drm_format);
+        return buffer_reallocation_result_t::REALLOCATED;
+    }
+
     buffer.buffer = wlr_allocator_create_buffer(wf::get_core_impl().allocator, size.width,
         size.height, format);
 
@@ -154,7 +578,9 @@ wf::buffer_reallocation_result_t wf::auxilliary_buffer_t::allocate(wf::dimension
     {
         // On some systems, we may not be able to allocate very big buffers, so try to allocate a smaller
         // size instead.
-        size = sanitize_buffer_size(size, FALLBACK_MAX_BUFFER_SIZE);
+        downscale *= std::min(1.0f, std::min(1.0f * FALLBACK_MAX_BUFFER_SIZE / size.width,
+            1.0f * FALLBACK_MAX_BUFFER_SIZE / size.height));
+        size = scale_buffer_size(requested, downscale);
         buffer.buffer = wlr_allocator_create_buffer(wf::get_core_impl().allocator, size.width,
             size.height, format);
     }
@@ -166,25 +592,37 @@ wf::buffer_reallocation_result_t wf::auxilliary_buffer_t::allocate(wf::dimension
     }
 
     buffer.size = size;
+    requested_size   = requested;
+    allocation_scale = downscale;
+    aux_buffer_registry.add(this, hints.owner, size, drm_format);
     return buffer_reallocation_result_t::REALLOCATED;
 }
 
 void wf::auxilliary_buffer_t::free()
 {
-    if (texture)
+    aux_buffer_registry.remove(this);
+    if (buffer.get_buffer() && !aux_buffer_pool_finished)
     {
-        wlr_texture_destroy(texture);
+        get_aux_buffer_pool().release(buffer.get_buffer(), texture, drm_format);
+    } else
+    {
+        if (texture)
+        {
+            wlr_texture_destroy(texture);
+        }
+
+        if (buffer.get_buffer())
+        {
+            wlr_buffer_drop(buffer.get_buffer());
+        }
     }
 
     texture = NULL;
 
-    if (buffer.get_buffer())
-    {
-        wlr_buffer_drop(buffer.get_buffer());
-    }
-
-    buffer.buffer = NULL;
-    buffer.size   = {0, 0};
+    buffer.buffer  = NULL;
+    buffer.size      = {0, 0};
+    requested_size   = {0, 0};
+    allocation_scale = 1.0;
 }
 
 wlr_buffer*wf::auxilliary_buffer_t::get_buffer() const
@@ -208,6 +646,11 @@ wlr_texture*wf::auxilliary_buffer_t::get_texture()
     return texture;
 }
 
+float wf::auxilliary_buffer_t::get_allocation_scale() const
+{
+    return buffer.get_buffer() ? allocation_scale : 1.0f;
+}
+
 wf::render_buffer_t wf::auxilliary_buffer_t::get_renderbuffer() const
 {
     return buffer;
@@ -382,6 +825,7 @@ wf::render_pass_t::render_pass_t(const render_pass_params_t& p)
 {
     this->params = p;
     this->params.renderer = p.renderer ?: wf::get_core().renderer;
+    this->params.arena    = p.arena ?: wf::frame_arena_t::get_current();
     wf::dassert(p.target.get_buffer(), "Cannot run a render pass without a valid target!");
 }
 
@@ -406,16 +850,41 @@ wf::region_t wf::render_pass_t::run_partial()
     wf::region_t swap_damage = accumulated_damage;
 
     // Gather instructions
-    std::vector<wf::scene::render_instruction_t> instructions;
+    const bool profile = params.profiler && params.profiler->is_enabled();
+    std::vector<wf::scene::render_instruction_t> local_instructions;
+    auto& instructions = params.arena ? params.arena->get_instruction_list() : local_instructions;
     if (params.instances)
     {
         for (auto& inst : *params.instances)
         {
+            if (accumulated_damage.empty())
+            {
+                // Everything damaged so far is covered by opaque content of the instances above, so the
+                // remaining instances cannot contribute anything visible.
+                break;
+            }
+
+            const int64_t start = profile ? wf::get_current_time_ns() : 0;
             inst->schedule_instructions(instructions,
                 params.target, accumulated_damage);
+            if (profile)
+            {
+                params.profiler->add_instance_sample(frame_instance_sample_t::SCHEDULE, inst.get(),
+                    start, wf::get_current_time_ns());
+            }
         }
     }
 
+    // Instructions whose damage was fully occluded by instances above them do not need to be rendered.
+    instructions.erase(std::remove_if(instructions.begin(), instructions.end(),
+        [] (const wf::scene::render_instruction_t& instr) { return instr.damage.empty(); }),
+        instructions.end());
+
+    if (profile)
+    {
+        params.profiler->set_num_instructions(instructions.size());
+    }
+
     this->pass = wlr_renderer_begin_buffer_pass(
         params.renderer ?: wf::get_core().renderer,
         params.target.get_buffer(),
@@ -437,7 +906,14 @@ wf::region_t wf::render_pass_t::run_partial()
     for (auto& instr : wf::reverse(instructions))
     {
         instr.pass = this;
+        const int64_t start = profile ? wf::get_current_time_ns() : 0;
         instr.instance->render(instr);
+        if (profile)
+        {
+            params.profiler->add_instance_sample(frame_instance_sample_t::RENDER, instr.instance,
+                start, wf::get_current_time_ns());
+        }
+
         if (params.reference_output)
         {
             instr.instance->presentation_feedback(params.reference_output);
@@ -29,6 +29,27 @@ class wf::color_rect_view_t::color_rect_node_t : public wf::scene::floating_inne
     {
       public:
         using simple_render_instance_t::simple_render_instance_t;
+        void schedule_instructions(std::vector<wf::scene::render_instruction_t>& instructions,
+            const wf::render_target_t& target, wf::region_t& damage) override
+        {
+            simple_render_instance_t::schedule_instructions(instructions, target, damage);
+
+            // An opaque rect hides everything below its inside
+            auto view = self->_view.lock();
+            if (!view || (view->_color.a < 1.0))
+            {
+                return;
+            }
+
+            auto geometry = self->get_bounding_box();
+            wf::geometry_t inside = {geometry.x + view->border, geometry.y + view->border,
+                geometry.width - 2 * view->border, geometry.height - 2 * view->border};
+            if ((inside.width > 0) && (inside.height > 0))
+            {
+                damage ^= inside;
+            }
+        }
+
         void render(const wf::scene::render_instruction_t& data) override
         {
             auto view = self->_view.lock();
@@ -77,6 +98,11 @@ class wf::color_rect_view_t::color_rect_node_t : public wf::scene::floating_inne
         instances.push_back(std::make_unique<color_rect_render_instance_t>(this, push_damage, output));
     }
 
+    bool depends_on_whole_scene() const override
+    {
+        return false;
+    }
+
     wf::geometry_t get_bounding_box() override
     {
         if (auto view = _view.lock())
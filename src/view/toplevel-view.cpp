@@ -333,7 +333,7 @@ wayfire_toplevel_view wf::find_view_for_toplevel(
     std::shared_ptr<wf::toplevel_t> toplevel)
 {
     // FIXME: this could be a lot more efficient if we simply store a custom data on the toplevel.
-    for (auto& view : wf::get_core().get_all_views())
+    for (auto& view : wf::get_core().get_all_views_range())
     {
         if (auto tview = toplevel_cast(view))
         {
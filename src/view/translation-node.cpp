@@ -44,6 +44,7 @@ wf::point_t wf::scene::translation_node_t::get_offset() const
 void wf::scene::translation_node_t::set_offset(wf::point_t offset)
 {
     this->offset = offset;
+    wf::scene::invalidate_bounding_boxes(this);
 }
 
 uint32_t wf::scene::translation_node_t::optimize_update(uint32_t flags)
@@ -51,6 +52,11 @@ uint32_t wf::scene::translation_node_t::optimize_update(uint32_t flags)
     return optimize_nested_render_instances(shared_from_this(), flags);
 }
 
+bool wf::scene::translation_node_t::depends_on_whole_scene() const
+{
+    return false;
+}
+
 // ----------------------------------------- Render instance -------------------------------------------------
 wf::scene::translation_node_instance_t::translation_node_instance_t(
     translation_node_t *self, damage_callback push_damage, wf::output_t *shown_on)
@@ -104,6 +110,11 @@ void wf::scene::translation_node_instance_t::schedule_instructions(
 
         for (auto& ch : this->children)
         {
+            if (damage.empty())
+            {
+                break;
+            }
+
             ch->schedule_instructions(instructions, our_target, damage);
         }
 
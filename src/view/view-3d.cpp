@@ -477,16 +477,24 @@ uint32_t transformer_base_node_t::optimize_update(uint32_t flags)
     return optimize_nested_render_instances(shared_from_this(), flags);
 }
 
+bool transformer_base_node_t::depends_on_whole_scene() const
+{
+    return false;
+}
+
 wf::texture_t transformer_base_node_t::get_updated_contents(const wf::geometry_t& bbox, float scale,
     std::vector<scene::render_instance_uptr>& children)
 {
-    if (inner_content.allocate(wf::dimensions(bbox), scale) != buffer_reallocation_result_t::SAME)
+    buffer_allocation_hints_t hints;
+    hints.owner = "view-transformer";
+    hints.allow_downscale = true;
+    if (inner_content.allocate(wf::dimensions(bbox), scale, hints) != buffer_reallocation_result_t::SAME)
     {
         cached_damage |= bbox;
     }
 
     wf::render_target_t target{inner_content};
-    target.scale    = scale;
+    target.scale    = scale * inner_content.get_allocation_scale();
     target.geometry = bbox;
 
     render_pass_params_t params;
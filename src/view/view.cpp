@@ -96,11 +96,14 @@ void wf::view_interface_t::take_snapshot(wf::auxilliary_buffer_t& buffer)
     auto root_node = get_surface_root_node();
     const wf::geometry_t bbox = root_node->get_bounding_box();
     float scale = get_output()->handle->scale;
-    buffer.allocate(wf::dimensions(bbox), scale);
+    buffer_allocation_hints_t hints;
+    hints.owner = "view-snapshot";
+    hints.allow_downscale = true;
+    buffer.allocate(wf::dimensions(bbox), scale, hints);
 
     wf::render_target_t target{buffer};
     target.geometry = bbox;
-    target.scale    = scale;
+    target.scale    = scale * buffer.get_allocation_scale();
 
     std::vector<scene::render_instance_uptr> instances;
     root_node->gen_render_instances(instances, [] (auto) {}, get_output());
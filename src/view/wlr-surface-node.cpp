@@ -417,6 +417,11 @@ wf::geometry_t wf::scene::wlr_surface_node_t::get_bounding_box()
     return wf::construct_box({0, 0}, current_state.size);
 }
 
+bool wf::scene::wlr_surface_node_t::depends_on_whole_scene() const
+{
+    return false;
+}
+
 wlr_surface*wf::scene::wlr_surface_node_t::get_surface() const
 {
     return this->surface;
@@ -0,0 +1,98 @@
+/**
+ * A small LD_PRELOAD library which counts the heap allocations of the compositor for wayfire-bench.
+ *
+ * The counter lives in a file given by the WAYFIRE_BENCH_ALLOC_COUNTER environment variable, which is mapped
+ * into memory both by the compositor and by wayfire-bench, so that the benchmark can read it at any time
+ * without involving the compositor.
+ */
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+}
+
+static std::atomic<uint64_t> early_count{0};
+static std::atomic<uint64_t> *counter = &early_count;
+
+__attribute__((constructor)) static void map_counter()
+{
+    const char *path = getenv("WAYFIRE_BENCH_ALLOC_COUNTER");
+    if (!path)
+    {
+        return;
+    }
+
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    void *mem = mmap(nullptr, sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem != MAP_FAILED)
+    {
+        auto shared = (std::atomic<uint64_t>*)mem;
+        shared->fetch_add(early_count.load());
+        counter = shared;
+    }
+}
+
+static inline void count_allocation()
+{
+    counter->fetch_add(1, std::memory_order_relaxed);
+}
+
+extern "C" {
+void *malloc(size_t size)
+{
+    count_allocation();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    count_allocation();
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    count_allocation();
+    return __libc_realloc(ptr, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    count_allocation();
+    return __libc_memalign(alignment, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    count_allocation();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    count_allocation();
+    void *ptr = __libc_memalign(alignment, size);
+    if (!ptr)
+    {
+        return ENOMEM;
+    }
+
+    *memptr = ptr;
+    return 0;
+}
+}
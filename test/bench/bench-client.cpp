@@ -0,0 +1,183 @@
+/**
+ * A minimal Wayland client used by wayfire-bench. It maps a given number of xdg-shell toplevels with the
+ * app-id "wayfire-bench", each showing a solid color, and resizes its buffers whenever the compositor
+ * requests a new size. It keeps running until the compositor goes away.
+ */
+#include <wayland-client.h>
+#include "xdg-shell-client-protocol.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static constexpr int DEFAULT_WIDTH  = 400;
+static constexpr int DEFAULT_HEIGHT = 300;
+
+struct client_state_t
+{
+    wl_display *display   = nullptr;
+    wl_compositor *compositor = nullptr;
+    wl_shm *shm = nullptr;
+    xdg_wm_base *wm_base = nullptr;
+};
+
+static client_state_t state;
+
+struct window_t
+{
+    int index;
+    wl_surface *surface = nullptr;
+    xdg_surface *xsurface = nullptr;
+    xdg_toplevel *toplevel = nullptr;
+
+    int width  = DEFAULT_WIDTH;
+    int height = DEFAULT_HEIGHT;
+    int pending_width  = 0;
+    int pending_height = 0;
+};
+
+static wl_buffer *create_buffer(int width, int height, uint32_t color)
+{
+    const int stride = width * 4;
+    const int size   = stride * height;
+
+    int fd = memfd_create("wayfire-bench-buffer", MFD_CLOEXEC);
+    if ((fd < 0) || (ftruncate(fd, size) < 0))
+    {
+        perror("Failed to create shm buffer");
+        exit(EXIT_FAILURE);
+    }
+
+    auto data = (uint32_t*)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        perror("Failed to map shm buffer");
+        exit(EXIT_FAILURE);
+    }
+
+    std::fill(data, data + width * height, color);
+    munmap(data, size);
+
+    wl_shm_pool *pool  = wl_shm_create_pool(state.shm, fd, size);
+    wl_buffer *buffer  = wl_shm_pool_create_buffer(pool, 0, width, height, stride, WL_SHM_FORMAT_XRGB8888);
+    static const wl_buffer_listener buffer_listener = {
+        .release = [] (void*, wl_buffer *buffer) { wl_buffer_destroy(buffer); },
+    };
+    wl_buffer_add_listener(buffer, &buffer_listener, nullptr);
+
+    wl_shm_pool_destroy(pool);
+    close(fd);
+    return buffer;
+}
+
+static void draw_window(window_t *window)
+{
+    // A different color for each window, so that overlapping windows are distinguishable.
+    const uint32_t color = 0xff000000 | ((window->index * 0x3f5a7b) & 0xffffff);
+    wl_surface_attach(window->surface, create_buffer(window->width, window->height, color), 0, 0);
+    wl_surface_damage_buffer(window->surface, 0, 0, window->width, window->height);
+    wl_surface_commit(window->surface);
+}
+
+static const xdg_surface_listener surface_listener = {
+    .configure = [] (void *data, xdg_surface *xsurface, uint32_t serial)
+    {
+        auto window = (window_t*)data;
+        xdg_surface_ack_configure(xsurface, serial);
+        if (window->pending_width > 0)
+        {
+            window->width = window->pending_width;
+        }
+
+        if (window->pending_height > 0)
+        {
+            window->height = window->pending_height;
+        }
+
+        draw_window(window);
+    },
+};
+
+static const xdg_toplevel_listener toplevel_listener = {
+    .configure = [] (void *data, xdg_toplevel*, int32_t width, int32_t height, wl_array*)
+    {
+        auto window = (window_t*)data;
+        window->pending_width  = width;
+        window->pending_height = height;
+    },
+    .close = [] (void*, xdg_toplevel*) {},
+};
+
+static const xdg_wm_base_listener wm_base_listener = {
+    .ping = [] (void*, xdg_wm_base *wm_base, uint32_t serial) { xdg_wm_base_pong(wm_base, serial); },
+};
+
+static const wl_registry_listener registry_listener = {
+    .global = [] (void*, wl_registry *registry, uint32_t name, const char *interface, uint32_t)
+    {
+        if (!strcmp(interface, wl_compositor_interface.name))
+        {
+            state.compositor = (wl_compositor*)wl_registry_bind(registry, name, &wl_compositor_interface, 4);
+        } else if (!strcmp(interface, wl_shm_interface.name))
+        {
+            state.shm = (wl_shm*)wl_registry_bind(registry, name, &wl_shm_interface, 1);
+        } else if (!strcmp(interface, xdg_wm_base_interface.name))
+        {
+            state.wm_base = (xdg_wm_base*)wl_registry_bind(registry, name, &xdg_wm_base_interface, 1);
+            xdg_wm_base_add_listener(state.wm_base, &wm_base_listener, nullptr);
+        }
+    },
+    .global_remove = [] (void*, wl_registry*, uint32_t) {},
+};
+
+int main(int argc, char **argv)
+{
+    const int num_windows = (argc > 1) ? atoi(argv[1]) : 1;
+
+    state.display = wl_display_connect(nullptr);
+    if (!state.display)
+    {
+        fprintf(stderr, "Failed to connect to the Wayland display\n");
+        return EXIT_FAILURE;
+    }
+
+    wl_registry *registry = wl_display_get_registry(state.display);
+    wl_registry_add_listener(registry, &registry_listener, nullptr);
+    wl_display_roundtrip(state.display);
+    if (!state.compositor || !state.shm || !state.wm_base)
+    {
+        fprintf(stderr, "The compositor does not support wl_compositor, wl_shm or xdg_wm_base\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::unique_ptr<window_t>> windows;
+    for (int i = 0; i < num_windows; i++)
+    {
+        auto window = std::make_unique<window_t>();
+        window->index    = i;
+        window->surface  = wl_compositor_create_surface(state.compositor);
+        window->xsurface = xdg_wm_base_get_xdg_surface(state.wm_base, window->surface);
+        window->toplevel = xdg_surface_get_toplevel(window->xsurface);
+        xdg_surface_add_listener(window->xsurface, &surface_listener, window.get());
+        xdg_toplevel_add_listener(window->toplevel, &toplevel_listener, window.get());
+
+        const std::string title = "wayfire-bench " + std::to_string(i);
+        xdg_toplevel_set_app_id(window->toplevel, "wayfire-bench");
+        xdg_toplevel_set_title(window->toplevel, title.c_str());
+        wl_surface_commit(window->surface);
+        windows.push_back(std::move(window));
+    }
+
+    while (wl_display_dispatch(state.display) != -1)
+    {}
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,747 @@
+/**
+ * wayfire-bench starts Wayfire on a headless backend and drives a set of reproducible scenarios through the
+ * stipc and ipc-rules plugins: mapping many views, switching workspaces, interactively moving a view and
+ * toggling expo. For each scenario it reports frame times (from the built-in frame profiler), the CPU time
+ * and heap allocations of the compositor per frame, the hit rate of the offscreen buffer pool (the
+ * workspace-switch and expo-toggle animations render into offscreen buffers) and the latency of the IPC
+ * calls it made.
+ *
+ * The results are printed as a JSON object, so that they can be compared across commits.
+ */
+#include <wayfire/nonstd/json.hpp>
+#include <wayfire/frame-profiler.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+using bench_clock = std::chrono::steady_clock;
+
+struct bench_options_t
+{
+    std::string wayfire = "wayfire";
+    std::string output_file;
+    int num_views  = 100;
+    int iterations = 20;
+    int width  = 1920;
+    int height = 1080;
+    bool verbose = false;
+};
+
+[[noreturn]] static void fail(const std::string& message)
+{
+    std::cerr << "wayfire-bench: " << message << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+static double us_since(bench_clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(bench_clock::now() - start).count();
+}
+
+/**
+ * Summary statistics of a set of samples.
+ */
+static wf::json_t summarize(std::vector<double> samples)
+{
+    wf::json_t result;
+    result["count"] = (uint64_t)samples.size();
+    if (samples.empty())
+    {
+        return result;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&] (double p)
+    {
+        const size_t idx = std::min(samples.size() - 1, (size_t)(p * (samples.size() - 1) + 0.5));
+        return samples[idx];
+    };
+
+    double sum = 0;
+    for (auto& s : samples)
+    {
+        sum += s;
+    }
+
+    result["mean"] = sum / samples.size();
+    result["p50"]  = percentile(0.5);
+    result["p95"]  = percentile(0.95);
+    result["p99"]  = percentile(0.99);
+    result["max"]  = samples.back();
+    return result;
+}
+
+/**
+ * A blocking connection to the Wayfire IPC socket, which records the round-trip time of each call.
+ */
+class ipc_connection_t
+{
+  public:
+    std::vector<double> latencies_us;
+
+    void connect(const std::string& path, std::chrono::milliseconds timeout)
+    {
+        const auto start = bench_clock::now();
+        while (true)
+        {
+            fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+            if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0)
+            {
+                return;
+            }
+
+            close(fd);
+            fd = -1;
+            if (bench_clock::now() - start > timeout)
+            {
+                fail("Timed out waiting for the IPC socket " + path);
+            }
+
+            std::this_thread::sleep_for(50ms);
+        }
+    }
+
+    ~ipc_connection_t()
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+
+    wf::json_t call(const std::string& method, const wf::json_t& data = {})
+    {
+        wf::json_t request;
+        request["method"] = method;
+        request["data"]   = data;
+
+        const auto start = bench_clock::now();
+        const std::string payload = request.serialize();
+        const uint32_t len = payload.size();
+        write_all(&len, sizeof(len));
+        write_all(payload.data(), payload.size());
+
+        uint32_t response_len;
+        read_all(&response_len, sizeof(response_len));
+        std::string response_str(response_len, '\0');
+        read_all(response_str.data(), response_len);
+        latencies_us.push_back(us_since(start));
+
+        wf::json_t response;
+        if (auto err = wf::json_t::parse_string(response_str, response))
+        {
+            fail("Invalid response to " + method + ": " + *err);
+        }
+
+        if (response.has_member("error"))
+        {
+            fail("IPC call " + method + " failed: " + response["error"].as_string());
+        }
+
+        return response;
+    }
+
+  private:
+    int fd = -1;
+
+    void write_all(const void *data, size_t len)
+    {
+        auto ptr = (const char*)data;
+        while (len > 0)
+        {
+            ssize_t written = ::send(fd, ptr, len, MSG_NOSIGNAL);
+            if (written <= 0)
+            {
+                fail("Failed to write to the IPC socket");
+            }
+
+            ptr += written;
+            len -= written;
+        }
+    }
+
+    void read_all(void *data, size_t len)
+    {
+        auto ptr = (char*)data;
+        while (len > 0)
+        {
+            ssize_t nread = ::read(fd, ptr, len);
+            if (nread <= 0)
+            {
+                fail("Failed to read from the IPC socket (did the compositor crash?)");
+            }
+
+            ptr += nread;
+            len -= nread;
+        }
+    }
+};
+
+/**
+ * A running compositor instance together with the files it needs.
+ */
+class compositor_t
+{
+  public:
+    pid_t pid = -1;
+    ipc_connection_t ipc;
+
+    compositor_t(const bench_options_t& options) : options(options)
+    {
+        char dir_template[] = "/tmp/wayfire-bench-XXXXXX";
+        if (!mkdtemp(dir_template))
+        {
+            fail("Failed to create a temporary directory");
+        }
+
+        runtime_dir = dir_template;
+        config_path = runtime_dir + "/wayfire.ini";
+        socket_path = runtime_dir + "/wayfire.socket";
+        alloc_counter_path = runtime_dir + "/alloc-counter";
+
+        write_config();
+        map_alloc_counter();
+        spawn();
+        ipc.connect(socket_path, 10s);
+        ipc.call("stipc/ping");
+    }
+
+    ~compositor_t()
+    {
+        if (pid > 0)
+        {
+            kill(pid, SIGTERM);
+            waitpid(pid, nullptr, 0);
+        }
+
+        if (alloc_counter)
+        {
+            munmap((void*)alloc_counter, sizeof(*alloc_counter));
+        }
+
+        unlink(config_path.c_str());
+        unlink(socket_path.c_str());
+        unlink(alloc_counter_path.c_str());
+        unlink((runtime_dir + "/wayfire.log").c_str());
+        rmdir(runtime_dir.c_str());
+    }
+
+    /** The total number of heap allocations of the compositor so far. */
+    uint64_t get_allocations() const
+    {
+        return alloc_counter ? alloc_counter->load() : 0;
+    }
+
+    /** The total CPU time (user and system) used by the compositor so far, in microseconds. */
+    double get_cpu_time_us() const
+    {
+        std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+        std::string contents((std::istreambuf_iterator<char>(stat)), std::istreambuf_iterator<char>());
+
+        // The process name may contain spaces, so start parsing after its closing parenthesis.
+        auto pos = contents.rfind(')');
+        if (pos == std::string::npos)
+        {
+            return 0;
+        }
+
+        std::istringstream fields(contents.substr(pos + 2));
+        std::string field;
+        uint64_t utime = 0, stime = 0;
+        // utime and stime are fields 14 and 15, the stream starts at field 3.
+        for (int i = 3; i <= 15 && fields >> field; i++)
+        {
+            if (i == 14)
+            {
+                utime = std::stoull(field);
+            } else if (i == 15)
+            {
+                stime = std::stoull(field);
+            }
+        }
+
+        return (utime + stime) * 1e6 / sysconf(_SC_CLK_TCK);
+    }
+
+  private:
+    const bench_options_t& options;
+    std::string runtime_dir;
+    std::string config_path;
+    std::string socket_path;
+    std::string alloc_counter_path;
+    std::atomic<uint64_t> *alloc_counter = nullptr;
+
+    void write_config()
+    {
+        std::ofstream config(config_path);
+        config << "[core]\n" <<
+            "plugins = ipc stipc ipc-rules move vswitch expo\n" <<
+            "vwidth = 3\n" <<
+            "vheight = 3\n" <<
+            "xwayland = false\n\n" <<
+            "[output:HEADLESS-1]\n" <<
+            "mode = " << options.width << "x" << options.height << "@60000\n\n" <<
+            "[vswitch]\n" <<
+            "duration = 100\n\n" <<
+            "[expo]\n" <<
+            "duration = 100\n\n" <<
+            "[workarounds]\n" <<
+            "use_external_output_configuration = false\n";
+    }
+
+    void map_alloc_counter()
+    {
+        int fd = open(alloc_counter_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if ((fd < 0) || (ftruncate(fd, sizeof(uint64_t)) < 0))
+        {
+            fail("Failed to create the allocation counter");
+        }
+
+        void *mem = mmap(nullptr, sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mem != MAP_FAILED)
+        {
+            alloc_counter = (std::atomic<uint64_t>*)mem;
+        }
+    }
+
+    void spawn()
+    {
+        pid = fork();
+        if (pid < 0)
+        {
+            fail("fork() failed");
+        }
+
+        if (pid > 0)
+        {
+            return;
+        }
+
+        setenv("WLR_BACKENDS", "headless", 1);
+        setenv("WLR_HEADLESS_OUTPUTS", "1", 1);
+        setenv("WLR_RENDERER", "pixman", 1);
+        setenv("WLR_LIBINPUT_NO_DEVICES", "1", 1);
+        setenv("_WAYFIRE_SOCKET", socket_path.c_str(), 1);
+        setenv("WAYFIRE_BENCH_ALLOC_COUNTER", alloc_counter_path.c_str(), 1);
+        setenv("XDG_RUNTIME_DIR", runtime_dir.c_str(), 1);
+        setenv("LD_PRELOAD", BENCH_ALLOC_COUNTER_PATH, 1);
+        unsetenv("WAYLAND_DISPLAY");
+        unsetenv("DISPLAY");
+
+        if (!options.verbose)
+        {
+            const std::string log_path = runtime_dir + "/wayfire.log";
+            int log_fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+            if (log_fd >= 0)
+            {
+                dup2(log_fd, STDOUT_FILENO);
+                dup2(log_fd, STDERR_FILENO);
+                close(log_fd);
+            }
+        }
+
+        std::vector<const char*> argv = {options.wayfire.c_str(), "-c", config_path.c_str(), nullptr};
+        execvp(argv[0], (char**)argv.data());
+        perror("Failed to start wayfire");
+        _exit(EXIT_FAILURE);
+    }
+};
+
+/**
+ * Runs scenarios against a compositor and collects the results.
+ */
+class bench_runner_t
+{
+  public:
+    bench_runner_t(compositor_t& compositor) : compositor(compositor)
+    {
+        wf::json_t data;
+        data["enabled"] = true;
+        compositor.ipc.call("wayfire/frame-profiler/set-enabled", data);
+    }
+
+    wf::json_t get_results() const
+    {
+        return results;
+    }
+
+    /**
+     * Run a single scenario. Only the frames rendered while @action is running (and shortly after it, so that
+     * the last damage is presented) count towards the results.
+     */
+    void run(const std::string& name, std::function<void()> action)
+    {
+        std::cerr << "wayfire-bench: running " << name << std::endl;
+        const auto start_sequences = get_next_sequences();
+        const uint64_t start_allocations = compositor.get_allocations();
+        const double start_cpu   = compositor.get_cpu_time_us();
+        const auto start_pool = get_buffer_pool_stats();
+        const size_t start_calls = compositor.ipc.latencies_us.size();
+        const auto start = bench_clock::now();
+
+        action();
+        settle();
+
+        const double wall_us   = us_since(start);
+        const double cpu_us    = compositor.get_cpu_time_us() - start_cpu;
+        const uint64_t allocations = compositor.get_allocations() - start_allocations;
+        const std::vector<double> latencies(compositor.ipc.latencies_us.begin() + start_calls,
+            compositor.ipc.latencies_us.end());
+        const auto end_pool = get_buffer_pool_stats();
+
+        std::vector<double> frame_times;
+        for (auto& frame : get_frames_since(name, start_sequences))
+        {
+            frame_times.push_back(frame);
+        }
+
+        const double nframes = std::max<size_t>(1, frame_times.size());
+
+        wf::json_t result;
+        result["wall-time-ms"] = wall_us / 1000.0;
+        result["frames"] = (uint64_t)frame_times.size();
+        result["frame-time-us"] = summarize(frame_times);
+        result["cpu-time-per-frame-us"]  = cpu_us / nframes;
+        result["allocations"] = allocations;
+        result["allocations-per-frame"]  = allocations / nframes;
+        result["ipc-latency-us"] = summarize(latencies);
+        result["buffer-pool"] = summarize_pool(start_pool, end_pool);
+        results[name] = result;
+    }
+
+  private:
+    compositor_t& compositor;
+    wf::json_t results;
+
+    /** The profiler keeps only the last frames of each output, so a scenario may not render more frames. */
+    static constexpr uint64_t MAX_FRAMES = wf::frame_profiler_t::CAPACITY - 1;
+
+    /** Wait until running animations and pending damage are done. */
+    void settle()
+    {
+        std::this_thread::sleep_for(250ms);
+        compositor.ipc.call("stipc/ping");
+    }
+
+    wf::json_t get_buffer_pool_stats()
+    {
+        return compositor.ipc.call("wayfire/buffer-pool-stats");
+    }
+
+    /** The pool hits and misses between two snapshots of wayfire/buffer-pool-stats. */
+    static wf::json_t summarize_pool(wf::json_t start, wf::json_t end)
+    {
+        const uint64_t hits   = end["hits"].as_uint64() - start["hits"].as_uint64();
+        const uint64_t misses = end["misses"].as_uint64() - start["misses"].as_uint64();
+
+        wf::json_t result;
+        result["hits"]   = hits;
+        result["misses"] = misses;
+        result["evictions"] = end["evictions"].as_uint64() - start["evictions"].as_uint64();
+        result["hit-rate"]  = (hits + misses > 0) ? (double)hits / (hits + misses) : 0.0;
+        result["pooled-bytes"] = end["pooled-bytes"].as_uint64();
+        return result;
+    }
+
+    wf::json_t get_frames()
+    {
+        wf::json_t data;
+        data["count"] = MAX_FRAMES;
+        return compositor.ipc.call("wayfire/frame-profiler/get-frames", data);
+    }
+
+    /** The sequence number of the next frame of each output, by output name. */
+    std::map<std::string, uint64_t> get_next_sequences()
+    {
+        std::map<std::string, uint64_t> next;
+        auto response = get_frames();
+        for (size_t i = 0; i < response["outputs"].size(); i++)
+        {
+            auto output = response["outputs"][i];
+            auto frames = output["frames"];
+            next[output["output"].as_string()] = frames.size() ?
+                frames[frames.size() - 1]["sequence"].as_uint64() + 1 : 0;
+        }
+
+        return next;
+    }
+
+    /**
+     * Durations of the frames which were rendered since the given sequence numbers. Fails if the profiler
+     * already dropped some of these frames, because the results would then be incomplete.
+     */
+    std::vector<double> get_frames_since(const std::string& name,
+        const std::map<std::string, uint64_t>& start)
+    {
+        std::vector<double> durations;
+        auto response = get_frames();
+        for (size_t i = 0; i < response["outputs"].size(); i++)
+        {
+            auto output = response["outputs"][i];
+            auto frames = output["frames"];
+            auto it = start.find(output["output"].as_string());
+            const uint64_t first = (it != start.end()) ? it->second : 0;
+            if (frames.size() && (frames[(size_t)0]["sequence"].as_uint64() > first))
+            {
+                fail("Scenario " + name + " rendered more than " + std::to_string(MAX_FRAMES) +
+                    " frames on " + output["output"].as_string() + ", which the frame profiler cannot keep. "
+                    "Use fewer --iterations.");
+            }
+
+            for (size_t j = 0; j < frames.size(); j++)
+            {
+                auto frame = frames[j];
+                if ((frame["sequence"].as_uint64() >= first) && (frame["result"].as_string() == "rendered"))
+                {
+                    durations.push_back(frame["duration-us"].as_double());
+                }
+            }
+        }
+
+        return durations;
+    }
+};
+
+static std::vector<int> list_bench_views(ipc_connection_t& ipc)
+{
+    std::vector<int> ids;
+    auto views = ipc.call("window-rules/list-views");
+    for (size_t i = 0; i < views.size(); i++)
+    {
+        auto view = views[i];
+        if ((view["app-id"].as_string() == "wayfire-bench") && view["mapped"].as_bool())
+        {
+            ids.push_back(view["id"].as_int());
+        }
+    }
+
+    return ids;
+}
+
+static void feed_key(ipc_connection_t& ipc, const std::string& key, bool pressed)
+{
+    wf::json_t data;
+    data["key"]   = key;
+    data["state"] = pressed;
+    ipc.call("stipc/feed_key", data);
+}
+
+static void feed_button(ipc_connection_t& ipc, const std::string& combo, const std::string& mode)
+{
+    wf::json_t data;
+    data["combo"] = combo;
+    data["mode"]  = mode;
+    ipc.call("stipc/feed_button", data);
+}
+
+static void move_cursor(ipc_connection_t& ipc, double x, double y)
+{
+    wf::json_t data;
+    data["x"] = x;
+    data["y"] = y;
+    ipc.call("stipc/move_cursor", data);
+}
+
+static void press_combo(ipc_connection_t& ipc, const std::vector<std::string>& keys)
+{
+    for (auto& key : keys)
+    {
+        feed_key(ipc, key, true);
+    }
+
+    for (auto it = keys.rbegin(); it != keys.rend(); ++it)
+    {
+        feed_key(ipc, *it, false);
+    }
+}
+
+static void run_benchmarks(const bench_options_t& options, wf::json_t& report)
+{
+    compositor_t compositor{options};
+    bench_runner_t runner{compositor};
+    auto& ipc = compositor.ipc;
+    std::vector<int> views;
+
+    runner.run("map-views", [&]
+    {
+        wf::json_t data;
+        data["cmd"] = std::string(BENCH_CLIENT_PATH) + " " + std::to_string(options.num_views);
+        ipc.call("stipc/run", data);
+
+        const auto start = bench_clock::now();
+        while ((int)(views = list_bench_views(ipc)).size() < options.num_views)
+        {
+            if (bench_clock::now() - start > 30s)
+            {
+                fail("Timed out waiting for the views to map");
+            }
+
+            std::this_thread::sleep_for(10ms);
+        }
+    });
+
+    runner.run("layout-grid", [&]
+    {
+        const int columns = std::max(1, (int)std::ceil(std::sqrt(views.size())));
+        const int rows    = (views.size() + columns - 1) / columns;
+        const int cell_w  = options.width / columns;
+        const int cell_h  = options.height / std::max(rows, 1);
+
+        for (int it = 0; it < options.iterations; it++)
+        {
+            wf::json_t layout = wf::json_t::array();
+            for (size_t i = 0; i < views.size(); i++)
+            {
+                // Shift the grid by a few pixels each iteration, so that every layout damages all views.
+                wf::json_t geometry;
+                geometry["id"]     = views[i];
+                geometry["x"]      = (int)(i % columns) * cell_w + (it % 2) * 4;
+                geometry["y"]      = (int)(i / columns) * cell_h + (it % 2) * 4;
+                geometry["width"]  = std::max(cell_w - 8, 16);
+                geometry["height"] = std::max(cell_h - 8, 16);
+                layout.append(geometry);
+            }
+
+            wf::json_t data;
+            data["views"] = layout;
+            ipc.call("stipc/layout_views", data);
+            std::this_thread::sleep_for(16ms);
+        }
+    });
+
+    runner.run("workspace-switch", [&]
+    {
+        for (int it = 0; it < options.iterations; it++)
+        {
+            const std::string direction = (it % 2 == 0) ? "KEY_RIGHT" : "KEY_LEFT";
+            press_combo(ipc, {"KEY_LEFTMETA", "KEY_LEFTALT", direction});
+            std::this_thread::sleep_for(150ms);
+        }
+    });
+
+    runner.run("interactive-move", [&]
+    {
+        const double start_x = options.width / 4.0;
+        const double start_y = options.height / 4.0;
+        move_cursor(ipc, start_x, start_y);
+        feed_button(ipc, "S-BTN_LEFT", "press");
+        const int steps = options.iterations * 10;
+        for (int i = 1; i <= steps; i++)
+        {
+            move_cursor(ipc, start_x + i * 2, start_y + i);
+            std::this_thread::sleep_for(4ms);
+        }
+
+        feed_button(ipc, "S-BTN_LEFT", "release");
+    });
+
+    runner.run("expo-toggle", [&]
+    {
+        for (int it = 0; it < options.iterations; it++)
+        {
+            press_combo(ipc, {"KEY_LEFTMETA", "KEY_E"});
+            std::this_thread::sleep_for(150ms);
+        }
+    });
+
+    report["config"]["views"]  = options.num_views;
+    report["config"]["iterations"] = options.iterations;
+    report["config"]["output"] = std::to_string(options.width) + "x" + std::to_string(options.height);
+    report["scenarios"] = runner.get_results();
+}
+
+static void print_usage()
+{
+    std::cout << "Usage: wayfire-bench [options]\n"
+                 "  --wayfire PATH      the wayfire binary to benchmark (default: wayfire from PATH)\n"
+                 "  --views N           number of views to map (default: 100)\n"
+                 "  --iterations N      repetitions of each scenario step (default: 20)\n"
+                 "  --size WxH          size of the headless output (default: 1920x1080)\n"
+                 "  --output FILE       write the JSON report to FILE instead of stdout\n"
+                 "  --verbose           show the compositor log\n";
+}
+
+int main(int argc, char **argv)
+{
+    bench_options_t options;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        auto next = [&] () -> std::string
+        {
+            if (i + 1 >= argc)
+            {
+                fail("Missing value for " + arg);
+            }
+
+            return argv[++i];
+        };
+
+        if (arg == "--wayfire")
+        {
+            options.wayfire = next();
+        } else if (arg == "--views")
+        {
+            options.num_views = std::stoi(next());
+        } else if (arg == "--iterations")
+        {
+            options.iterations = std::stoi(next());
+        } else if (arg == "--size")
+        {
+            if (sscanf(next().c_str(), "%dx%d", &options.width, &options.height) != 2)
+            {
+                fail("Invalid output size");
+            }
+        } else if (arg == "--output")
+        {
+            options.output_file = next();
+        } else if (arg == "--verbose")
+        {
+            options.verbose = true;
+        } else
+        {
+            print_usage();
+            return (arg == "--help") ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    wf::json_t report;
+    run_benchmarks(options, report);
+
+    const std::string serialized = report.serialize();
+    if (options.output_file.empty())
+    {
+        std::cout << serialized << std::endl;
+    } else
+    {
+        std::ofstream(options.output_file) << serialized << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
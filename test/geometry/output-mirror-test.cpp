@@ -0,0 +1,39 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include "core/output-mirror.hpp"
+
+TEST_CASE("Mirrored contents are letterboxed")
+{
+    // Same aspect ratio: the whole output is used.
+    REQUIRE(wf::get_mirror_destination_box({3840, 2160}, {1920, 1080}, true) ==
+        wf::geometry_t{0, 0, 1920, 1080});
+
+    // Wider source: bars at the top and bottom.
+    REQUIRE(wf::get_mirror_destination_box({3840, 2160}, {1024, 768}, true) ==
+        wf::geometry_t{0, 96, 1024, 576});
+
+    // Narrower source: bars on the sides.
+    REQUIRE(wf::get_mirror_destination_box({1024, 768}, {1920, 1080}, true) ==
+        wf::geometry_t{240, 0, 1440, 1080});
+
+    // Without letterboxing, the source is stretched.
+    REQUIRE(wf::get_mirror_destination_box({1024, 768}, {1920, 1080}, false) ==
+        wf::geometry_t{0, 0, 1920, 1080});
+}
+
+TEST_CASE("Source damage is scaled to the mirror")
+{
+    const wf::geometry_t destination = {0, 96, 1024, 576};
+    const wf::region_t source_damage = wf::geometry_t{1920, 1080, 100, 100};
+    auto damage = wf::get_mirror_damage(source_damage, {3840, 2160}, destination);
+
+    // 100x100 source pixels are about 27x27 mirror pixels, plus one pixel on each side for filtering.
+    auto extents = wlr_box_from_pixman_box(damage.get_extents());
+    REQUIRE(extents == wf::geometry_t{511, 383, 29, 29});
+
+    // Damage never leaks into the bars.
+    auto whole = wf::get_mirror_damage(wf::geometry_t{0, 0, 3840, 2160}, {3840, 2160}, destination);
+    REQUIRE(wlr_box_from_pixman_box(whole.get_extents()) == destination);
+    REQUIRE(wf::get_mirror_damage({}, {3840, 2160}, destination).empty());
+}
@@ -0,0 +1,181 @@
+#include <chrono>
+#include <string>
+#include <vector>
+#include <linux/input-event-codes.h>
+#include <wayfire/bindings-repository.hpp>
+#include <wayfire/config/option.hpp>
+#include "core/core-impl.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+static void ensure_core()
+{
+    // The bindings repository listens for config reloads on core.
+    static bool allocated = false;
+    if (!allocated)
+    {
+        wf::compositor_core_impl_t::allocate_core();
+        allocated = true;
+    }
+}
+
+template<class T>
+static wf::option_sptr_t<T> make_option(const std::string& value)
+{
+    auto parsed = wf::option_type::from_string<T>(value);
+    REQUIRE(parsed.has_value());
+    return std::make_shared<wf::config::option_t<T>>("test", parsed.value());
+}
+
+TEST_CASE("Key and button bindings are dispatched to matching callbacks")
+{
+    ensure_core();
+    wf::bindings_repository_t repo;
+    std::vector<std::string> calls;
+
+    auto alt_a = make_option<wf::keybinding_t>("<alt> KEY_A");
+    auto super_a = make_option<wf::keybinding_t>("<super> KEY_A");
+    auto activator = make_option<wf::activatorbinding_t>("<alt> KEY_A | <alt> BTN_LEFT");
+    auto button    = make_option<wf::buttonbinding_t>("<alt> BTN_LEFT");
+
+    wf::key_callback on_alt_a = [&] (const wf::keybinding_t&)
+    {
+        calls.push_back("alt-a");
+        return true;
+    };
+
+    wf::key_callback on_super_a = [&] (const wf::keybinding_t&)
+    {
+        calls.push_back("super-a");
+        return false;
+    };
+
+    wf::activator_callback on_activator = [&] (const wf::activator_data_t& data)
+    {
+        calls.push_back("activator " + std::to_string((int)data.source) + " " +
+            std::to_string(data.activation_data));
+        return false;
+    };
+
+    wf::button_callback on_button = [&] (const wf::buttonbinding_t&)
+    {
+        calls.push_back("button");
+        return false;
+    };
+
+    repo.add_activator(activator, &on_activator);
+    repo.add_key(alt_a, &on_alt_a);
+    repo.add_key(super_a, &on_super_a);
+    repo.add_button(button, &on_button);
+
+    // Plain bindings are called before activators.
+    REQUIRE(repo.handle_key(wf::keybinding_t{WLR_MODIFIER_ALT, KEY_A}, 0));
+    REQUIRE(calls == std::vector<std::string>{"alt-a",
+        "activator " + std::to_string((int)wf::activator_source_t::KEYBINDING) + " " + std::to_string(KEY_A)});
+
+    calls.clear();
+    REQUIRE(!repo.handle_key(wf::keybinding_t{WLR_MODIFIER_ALT, KEY_B}, 0));
+    REQUIRE(!repo.handle_key(wf::keybinding_t{WLR_MODIFIER_CTRL, KEY_A}, 0));
+    REQUIRE(calls.empty());
+
+    REQUIRE(!repo.handle_button(wf::buttonbinding_t{WLR_MODIFIER_ALT, BTN_LEFT}));
+    REQUIRE(calls == std::vector<std::string>{"button",
+        "activator " + std::to_string((int)wf::activator_source_t::BUTTONBINDING) + " " +
+        std::to_string(BTN_LEFT)});
+
+    // Changing the value of an option is picked up.
+    calls.clear();
+    super_a->set_value(wf::keybinding_t{WLR_MODIFIER_CTRL, KEY_A});
+    REQUIRE(!repo.handle_key(wf::keybinding_t{WLR_MODIFIER_CTRL, KEY_A}, 0));
+    REQUIRE(!repo.handle_key(wf::keybinding_t{WLR_MODIFIER_LOGO, KEY_A}, 0));
+    REQUIRE(calls == std::vector<std::string>{"super-a"});
+
+    // As are removed bindings.
+    calls.clear();
+    repo.rem_binding(&on_alt_a);
+    REQUIRE(!repo.handle_key(wf::keybinding_t{WLR_MODIFIER_ALT, KEY_A}, 0));
+    REQUIRE(calls.size() == 1);
+    repo.rem_binding(&on_activator);
+    repo.rem_binding(&on_super_a);
+    repo.rem_binding(&on_button);
+}
+
+TEST_CASE("Bindings may be removed while they are being dispatched")
+{
+    ensure_core();
+    wf::bindings_repository_t repo;
+    auto key = make_option<wf::keybinding_t>("<alt> KEY_A");
+
+    int calls = 0;
+    wf::key_callback second = [&] (const wf::keybinding_t&)
+    {
+        ++calls;
+        return false;
+    };
+
+    wf::key_callback first = [&] (const wf::keybinding_t&)
+    {
+        ++calls;
+        repo.rem_binding(&first);
+        return true;
+    };
+
+    repo.add_key(key, &first);
+    repo.add_key(key, &second);
+
+    REQUIRE(repo.handle_key(wf::keybinding_t{WLR_MODIFIER_ALT, KEY_A}, 0));
+    REQUIRE(calls == 2);
+    REQUIRE(!repo.handle_key(wf::keybinding_t{WLR_MODIFIER_ALT, KEY_A}, 0));
+    REQUIRE(calls == 3);
+    repo.rem_binding(&second);
+}
+
+TEST_CASE("Benchmark: key dispatch")
+{
+    ensure_core();
+    using clock = std::chrono::steady_clock;
+    static constexpr int ITERATIONS = 100000;
+
+    for (int num_bindings : {10, 100, 500})
+    {
+        wf::bindings_repository_t repo;
+        std::vector<wf::option_sptr_t<wf::keybinding_t>> keys;
+        std::vector<wf::option_sptr_t<wf::activatorbinding_t>> activators;
+
+        int calls = 0;
+        wf::key_callback on_key = [&] (const wf::keybinding_t&)
+        {
+            ++calls;
+            return true;
+        };
+
+        wf::activator_callback on_activator = [&] (const wf::activator_data_t&)
+        {
+            return false;
+        };
+
+        for (int i = 0; i < num_bindings; i++)
+        {
+            // Spread the bindings over modifiers and keys, as in a typical config.
+            keys.push_back(std::make_shared<wf::config::option_t<wf::keybinding_t>>("key",
+                wf::keybinding_t{(uint32_t)(i % 8), (uint32_t)(KEY_ESC + i / 8)}));
+            activators.push_back(make_option<wf::activatorbinding_t>("<super> <shift> KEY_F" +
+                std::to_string(1 + i % 10)));
+
+            repo.add_key(keys.back(), &on_key);
+            repo.add_activator(activators.back(), &on_activator);
+        }
+
+        auto start = clock::now();
+        for (int i = 0; i < ITERATIONS; i++)
+        {
+            repo.handle_key(wf::keybinding_t{(uint32_t)(i % 8), (uint32_t)KEY_ESC}, 0);
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+        MESSAGE(num_bindings << " bindings: " << elapsed / (double)ITERATIONS << "ns per key press");
+        REQUIRE(calls == ITERATIONS);
+        repo.rem_binding(&on_key);
+        repo.rem_binding(&on_activator);
+    }
+}
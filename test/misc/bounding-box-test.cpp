@@ -0,0 +1,204 @@
+#include <chrono>
+#include <wayfire/scene.hpp>
+#include <wayfire/scene-operations.hpp>
+#include <wayfire/scene-render.hpp>
+#include <wayfire/unstable/translation-node.hpp>
+#include "core/core-impl.hpp"
+#include "core/scene-priv.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+using namespace wf::scene;
+
+/**
+ * A leaf node with a fixed geometry, which counts how often its bounding box is queried.
+ */
+class box_node_t : public node_t
+{
+  public:
+    wf::geometry_t geometry;
+    int queries = 0;
+
+    box_node_t(wf::geometry_t geometry) : node_t(false), geometry(geometry)
+    {}
+
+    wf::geometry_t get_bounding_box() override
+    {
+        ++queries;
+        return geometry;
+    }
+
+    std::optional<input_node_t> find_node_at(const wf::pointf_t& at) override
+    {
+        if ((at.x >= geometry.x) && (at.x < geometry.x + geometry.width) &&
+            (at.y >= geometry.y) && (at.y < geometry.y + geometry.height))
+        {
+            return input_node_t{.node = this, .local_coords = at};
+        }
+
+        return {};
+    }
+};
+
+static void ensure_core()
+{
+    // scene::update() needs to compare nodes against the real scenegraph root.
+    static bool allocated = false;
+    if (!allocated)
+    {
+        wf::compositor_core_impl_t::allocate_core();
+        allocated = true;
+    }
+}
+
+TEST_CASE("Children bounding boxes are cached until invalidated")
+{
+    ensure_core();
+    auto root = std::make_shared<floating_inner_node_t>(false);
+    auto translation = std::make_shared<translation_node_t>();
+    auto a = std::make_shared<box_node_t>(wf::geometry_t{0, 0, 10, 10});
+    auto b = std::make_shared<box_node_t>(wf::geometry_t{20, 20, 10, 10});
+
+    add_back(root, translation);
+    add_back(translation, a);
+    add_back(root, b);
+
+    REQUIRE(root->get_bounding_box() == wf::geometry_t{0, 0, 30, 30});
+    const int queries_a = a->queries;
+    const int queries_b = b->queries;
+
+    // Nothing changed, the cached boxes are used.
+    REQUIRE(root->get_bounding_box() == wf::geometry_t{0, 0, 30, 30});
+    REQUIRE(a->queries == queries_a);
+    REQUIRE(b->queries == queries_b);
+
+    // Changes followed by damage, an update or a new offset are picked up.
+    a->geometry = {-10, -10, 10, 10};
+    damage_node(a, a->geometry);
+    REQUIRE(root->get_bounding_box() == wf::geometry_t{-10, -10, 40, 40});
+
+    b->geometry = {20, 20, 20, 20};
+    update(b, update_flag::GEOMETRY);
+    REQUIRE(root->get_bounding_box() == wf::geometry_t{-10, -10, 50, 50});
+
+    translation->set_offset({-10, 0});
+    REQUIRE(root->get_bounding_box() == wf::geometry_t{-20, -10, 60, 50});
+
+    remove_child(b);
+    REQUIRE(root->get_bounding_box() == wf::geometry_t{-20, -10, 10, 10});
+}
+
+TEST_CASE("Damage invalidates only the damaged node and its ancestors")
+{
+    ensure_core();
+    auto root  = std::make_shared<floating_inner_node_t>(false);
+    auto left  = std::make_shared<floating_inner_node_t>(false);
+    auto right = std::make_shared<floating_inner_node_t>(false);
+    auto a     = std::make_shared<box_node_t>(wf::geometry_t{0, 0, 10, 10});
+    auto b     = std::make_shared<box_node_t>(wf::geometry_t{20, 20, 10, 10});
+
+    add_back(root, left);
+    add_back(root, right);
+    add_back(left, a);
+    add_back(right, b);
+    REQUIRE(root->get_bounding_box() == wf::geometry_t{0, 0, 30, 30});
+    const int queries_b = b->queries;
+
+    a->geometry = {-10, -10, 10, 10};
+    damage_node(a, a->geometry);
+    REQUIRE(root->get_bounding_box() == wf::geometry_t{-10, -10, 40, 40});
+    // The other subtree was not damaged, so its cached box is reused.
+    REQUIRE(b->queries == queries_b);
+}
+
+TEST_CASE("The input index follows damaged children")
+{
+    ensure_core();
+    auto root = std::make_shared<floating_inner_node_t>(false);
+    auto a    = std::make_shared<box_node_t>(wf::geometry_t{0, 0, 10, 10});
+    auto b    = std::make_shared<box_node_t>(wf::geometry_t{20, 20, 10, 10});
+    add_back(root, a);
+    add_back(root, b);
+    root->set_input_index_enabled(true);
+
+    auto node_at = [&] (double x, double y) -> node_t*
+    {
+        auto result = root->find_node_at({x, y});
+        return result ? result->node.get() : nullptr;
+    };
+
+    REQUIRE(node_at(5, 5) == a.get());
+    REQUIRE(node_at(25, 25) == b.get());
+
+    // Moving a child is followed by damage, which is enough to update the index.
+    b->geometry = {40, 40, 10, 10};
+    damage_node(b, b->geometry);
+    REQUIRE(node_at(25, 25) == nullptr);
+    REQUIRE(node_at(45, 45) == b.get());
+    REQUIRE(node_at(5, 5) == a.get());
+}
+
+TEST_CASE("Validation mode detects stale cached bounding boxes")
+{
+    ensure_core();
+    auto root = std::make_shared<floating_inner_node_t>(false);
+    auto a    = std::make_shared<box_node_t>(wf::geometry_t{0, 0, 10, 10});
+    add_back(root, a);
+    REQUIRE(root->get_bounding_box() == wf::geometry_t{0, 0, 10, 10});
+
+    // A change without damage or update is not seen ...
+    a->geometry = {0, 0, 20, 20};
+    REQUIRE(root->get_bounding_box() == wf::geometry_t{0, 0, 10, 10});
+
+    // ... unless the cache is validated.
+    validate_bounding_box_cache = true;
+    REQUIRE(root->get_bounding_box() == wf::geometry_t{0, 0, 20, 20});
+    validate_bounding_box_cache = false;
+    REQUIRE(root->get_bounding_box() == wf::geometry_t{0, 0, 20, 20});
+}
+
+TEST_CASE("Benchmark: cached vs. recomputed bounding boxes")
+{
+    ensure_core();
+    using clock = std::chrono::steady_clock;
+    static constexpr int ITERATIONS = 1000;
+
+    for (int nr_views : {10, 100, 1000})
+    {
+        auto root = std::make_shared<floating_inner_node_t>(false);
+        for (int i = 0; i < nr_views; i++)
+        {
+            auto view = std::make_shared<translation_node_t>();
+            add_back(view, std::make_shared<box_node_t>(wf::geometry_t{i, i, 100, 100}));
+            add_back(view, std::make_shared<box_node_t>(wf::geometry_t{i - 5, i - 5, 10, 10}));
+            add_back(root, view);
+        }
+
+        // In validation mode, every bounding box is recomputed.
+        validate_bounding_box_cache = true;
+        auto start = clock::now();
+        for (int i = 0; i < ITERATIONS; i++)
+        {
+            root->get_bounding_box();
+        }
+
+        auto uncached = clock::now() - start;
+        validate_bounding_box_cache = false;
+
+        start = clock::now();
+        for (int i = 0; i < ITERATIONS; i++)
+        {
+            root->get_bounding_box();
+        }
+
+        auto cached = clock::now() - start;
+
+        auto to_ns = [] (clock::duration d)
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count() / (double)ITERATIONS;
+        };
+
+        MESSAGE(nr_views << " views: recomputed " << to_ns(uncached) << "ns, cached " << to_ns(cached) << "ns");
+        REQUIRE(root->get_bounding_box() == wf::geometry_t{-5, -5, nr_views + 104, nr_views + 104});
+    }
+}
@@ -0,0 +1,171 @@
+#include <wayfire/frame-arena.hpp>
+#include <wayfire/render.hpp>
+#include <wayfire/scene-render.hpp>
+#include <wayfire/nonstd/wlroots-full.hpp>
+#include <drm_fourcc.h>
+#include <cstdlib>
+#include <new>
+#include <optional>
+
+extern "C"
+{
+#include <wlr/interfaces/wlr_buffer.h>
+#include <wlr/render/pixman.h>
+}
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+static size_t allocation_count = 0;
+
+void*operator new(size_t size)
+{
+    ++allocation_count;
+    if (void *ptr = std::malloc(size ?: 1))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+/** A buffer in main memory, which the pixman renderer can render to. */
+struct memory_buffer_t
+{
+    wlr_buffer base;
+    std::vector<uint32_t> pixels;
+};
+
+static const wlr_buffer_impl memory_buffer_impl = {
+    .destroy = [] (wlr_buffer *buffer)
+    {
+        delete (memory_buffer_t*)buffer;
+    },
+    .get_dmabuf = nullptr,
+    .get_shm    = nullptr,
+    .begin_data_ptr_access = [] (wlr_buffer *buffer, uint32_t, void **data, uint32_t *format, size_t *stride)
+    {
+        auto self = (memory_buffer_t*)buffer;
+        *data   = self->pixels.data();
+        *format = DRM_FORMAT_ARGB8888;
+        *stride = buffer->width * sizeof(uint32_t);
+        return true;
+    },
+    .end_data_ptr_access = [] (wlr_buffer*) {},
+};
+
+static wf::render_target_t create_target(int width, int height)
+{
+    auto buffer = new memory_buffer_t;
+    buffer->pixels.resize(width * height);
+    wlr_buffer_init(&buffer->base, &memory_buffer_impl, width, height);
+
+    wf::render_target_t target{wf::render_buffer_t{&buffer->base, {width, height}}};
+    target.geometry = {0, 0, width, height};
+    return target;
+}
+
+/**
+ * A render instance which fills a rectangle with a solid color. It can also render other instances to
+ * another target in a nested render pass, like the instances of views with transformers do.
+ */
+struct rect_instance_t : public wf::scene::render_instance_t
+{
+    wf::geometry_t box;
+    std::optional<wf::render_target_t> nested_target;
+    std::vector<wf::scene::render_instance_uptr> nested_instances;
+
+    rect_instance_t(wf::geometry_t box) : box(box)
+    {}
+
+    void schedule_instructions(std::vector<wf::scene::render_instruction_t>& instructions,
+        const wf::render_target_t& target, wf::region_t& damage) override
+    {
+        instructions.push_back(wf::scene::render_instruction_t{
+                        .instance = this,
+                        .target   = target,
+                        .damage   = damage & box,
+                    });
+    }
+
+    void render(const wf::scene::render_instruction_t& data) override
+    {
+        if (nested_target)
+        {
+            wf::render_pass_params_t params;
+            params.instances = &nested_instances;
+            params.target    = *nested_target;
+            params.damage    = nested_target->geometry;
+            params.renderer  = data.pass->get_wlr_renderer();
+            wf::render_pass_t::run(params);
+        }
+
+        data.pass->clear(data.damage, {1, 0, 0, 1});
+    }
+};
+
+TEST_CASE("Steady-state render passes do not allocate")
+{
+    wlr_renderer *renderer = wlr_pixman_renderer_create();
+    REQUIRE(renderer);
+
+    static constexpr int NUM_INSTANCES = 50;
+    std::vector<wf::scene::render_instance_uptr> instances;
+    for (int i = 0; i < NUM_INSTANCES; i++)
+    {
+        instances.push_back(std::make_unique<rect_instance_t>(wf::geometry_t{i * 10, 0, 10, 10}));
+    }
+
+    auto target = create_target(NUM_INSTANCES * 10, 10);
+    auto nested = (rect_instance_t*)instances.front().get();
+    nested->nested_target = create_target(10, 10);
+    nested->nested_instances.push_back(std::make_unique<rect_instance_t>(wf::geometry_t{0, 0, 10, 10}));
+
+    wf::frame_arena_t arena;
+    std::optional<wf::render_pass_t> pass;
+    auto render_frame = [&] ()
+    {
+        wf::render_pass_params_t params;
+        params.instances = &instances;
+        params.target    = target;
+        params.damage    = target.geometry;
+        params.renderer  = renderer;
+        params.arena     = &arena;
+
+        // Like the render manager does for the output pass.
+        wf::frame_arena_t::set_current(&arena);
+        pass.emplace(params);
+        pass->run_partial();
+        REQUIRE(pass->submit());
+        pass.reset();
+        wf::frame_arena_t::set_current(nullptr);
+        arena.reset();
+    };
+
+    // The first frames warm up the arena
+    for (int i = 0; i < 2; i++)
+    {
+        render_frame();
+    }
+
+    // Only memory managed by pixman and wlroots (allocated with malloc) is not counted here.
+    for (int i = 0; i < 10; i++)
+    {
+        const size_t start = allocation_count;
+        render_frame();
+        REQUIRE(allocation_count - start == 0);
+    }
+
+    wlr_buffer_drop(nested->nested_target->get_buffer());
+    wlr_buffer_drop(target.get_buffer());
+    wlr_renderer_destroy(renderer);
+}
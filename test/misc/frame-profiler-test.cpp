@@ -0,0 +1,92 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <wayfire/frame-profiler.hpp>
+
+static void record_frame(wf::frame_profiler_t& profiler, wf::frame_result_t result)
+{
+    profiler.begin_frame();
+    profiler.begin_phase(wf::frame_phase_t::EFFECTS_PRE);
+    profiler.end_phase(wf::frame_phase_t::EFFECTS_PRE);
+    profiler.end_frame(result);
+}
+
+TEST_CASE("Disabled frame profiler records nothing")
+{
+    wf::frame_profiler_t profiler{"test", 0};
+    record_frame(profiler, wf::frame_result_t::RENDERED);
+    REQUIRE(profiler.get_frames().empty());
+}
+
+TEST_CASE("Frame profiler records phases and results")
+{
+    wf::frame_profiler_t profiler{"test", 0};
+    profiler.set_enabled(true);
+
+    record_frame(profiler, wf::frame_result_t::RENDERED);
+    record_frame(profiler, wf::frame_result_t::SKIPPED);
+    record_frame(profiler, wf::frame_result_t::SCANOUT);
+
+    // Skipped frames are counted, but not kept.
+    auto frames = profiler.get_frames();
+    REQUIRE(frames.size() == 2);
+    REQUIRE(profiler.get_num_skipped_frames() == 1);
+    REQUIRE(frames[0].sequence == 0);
+    REQUIRE(frames[0].result == wf::frame_result_t::RENDERED);
+    REQUIRE(frames[1].sequence == 1);
+    REQUIRE(frames[1].result == wf::frame_result_t::SCANOUT);
+
+    const auto& pre = frames[0].phases[(size_t)wf::frame_phase_t::EFFECTS_PRE];
+    REQUIRE(pre.start_ns >= frames[0].frame.start_ns);
+    REQUIRE(pre.duration_ns >= 0);
+    REQUIRE(frames[0].phases[(size_t)wf::frame_phase_t::SWAP].start_ns == -1);
+}
+
+TEST_CASE("Frame profiler ring buffer wraps around")
+{
+    wf::frame_profiler_t profiler{"test", 0};
+    profiler.set_enabled(true);
+
+    const size_t total = wf::frame_profiler_t::CAPACITY * 2 + 5;
+    for (size_t i = 0; i < total; i++)
+    {
+        record_frame(profiler, wf::frame_result_t::RENDERED);
+        record_frame(profiler, wf::frame_result_t::SKIPPED);
+    }
+
+    auto frames = profiler.get_frames();
+    REQUIRE(frames.size() == wf::frame_profiler_t::CAPACITY - 1);
+    REQUIRE(frames.back().sequence == total - 1);
+    REQUIRE(frames.front().sequence == total - (wf::frame_profiler_t::CAPACITY - 1));
+
+    auto last = profiler.get_frames(3);
+    REQUIRE(last.size() == 3);
+    REQUIRE(last[0].sequence == total - 3);
+
+    // Unfinished frames are not visible to readers
+    profiler.begin_frame();
+    REQUIRE(profiler.get_frames(1)[0].sequence == total - 1);
+}
+
+TEST_CASE("Frame profiler keeps the most expensive instance samples")
+{
+    wf::frame_profiler_t profiler{"test", 0};
+    profiler.set_enabled(true);
+
+    profiler.begin_frame();
+    const size_t max = wf::frame_profile_t::MAX_INSTANCE_SAMPLES;
+    for (size_t i = 0; i < max * 2; i++)
+    {
+        profiler.add_instance_sample(wf::frame_instance_sample_t::RENDER, nullptr, 0, i);
+    }
+
+    profiler.end_frame(wf::frame_result_t::RENDERED);
+
+    auto frames = profiler.get_frames();
+    REQUIRE(frames.size() == 1);
+    REQUIRE(frames[0].num_instance_samples == max);
+    for (size_t i = 0; i < max; i++)
+    {
+        REQUIRE(frames[0].instance_samples[i].interval.duration_ns >= (int64_t)max);
+    }
+}
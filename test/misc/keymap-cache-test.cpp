@@ -0,0 +1,103 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <unistd.h>
+#include <xkbcommon/xkbcommon.h>
+#include "core/seat/keymap-cache.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+static std::string keymap_as_string(xkb_keymap *keymap)
+{
+    char *text = xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1);
+    std::string result = text;
+    std::free(text);
+    return result;
+}
+
+static const wf::keymap_names_t names = {"evdev", "", "us,de", "", "grp:alt_shift_toggle"};
+
+TEST_CASE("Keyboards with the same configuration share a keymap")
+{
+    wf::keymap_cache_t cache;
+    auto a = cache.get_keymap(names);
+    auto b = cache.get_keymap(names);
+    REQUIRE(a != nullptr);
+    REQUIRE(a == b);
+    REQUIRE(cache.get_stats().compiled == 1);
+    REQUIRE(cache.get_stats().hits == 1);
+
+    auto other_names = names;
+    other_names.layout = "us";
+    auto c = cache.get_keymap(other_names);
+    REQUIRE(c != nullptr);
+    REQUIRE(c != a);
+    REQUIRE(cache.get_stats().compiled == 2);
+
+    // Keymaps stay valid after the cache drops them.
+    cache.clear();
+    REQUIRE(!keymap_as_string(a).empty());
+
+    xkb_keymap_unref(a);
+    xkb_keymap_unref(b);
+    xkb_keymap_unref(c);
+}
+
+TEST_CASE("Keymaps are stored on disk")
+{
+    auto dir = std::filesystem::temp_directory_path() / ("wayfire-keymap-test-" + std::to_string(getpid()));
+    std::filesystem::remove_all(dir);
+
+    std::string compiled;
+    {
+        wf::keymap_cache_t cache;
+        cache.set_disk_cache_dir(dir);
+        auto keymap = cache.get_keymap(names);
+        REQUIRE(keymap != nullptr);
+        REQUIRE(cache.get_stats().compiled == 1);
+        compiled = keymap_as_string(keymap);
+        xkb_keymap_unref(keymap);
+    }
+
+    {
+        wf::keymap_cache_t cache;
+        cache.set_disk_cache_dir(dir);
+        auto keymap = cache.get_keymap(names);
+        REQUIRE(keymap != nullptr);
+        REQUIRE(cache.get_stats().compiled == 0);
+        REQUIRE(cache.get_stats().disk_hits == 1);
+        REQUIRE(keymap_as_string(keymap) == compiled);
+        xkb_keymap_unref(keymap);
+    }
+
+    // The environment fills in the empty names, so it is part of the key.
+    setenv("XKB_DEFAULT_MODEL", "pc104", 1);
+    {
+        wf::keymap_cache_t cache;
+        cache.set_disk_cache_dir(dir);
+        auto keymap = cache.get_keymap(names);
+        REQUIRE(keymap != nullptr);
+        REQUIRE(cache.get_stats().compiled == 1);
+        xkb_keymap_unref(keymap);
+    }
+
+    unsetenv("XKB_DEFAULT_MODEL");
+
+    // Damaged files are ignored.
+    for (auto& entry : std::filesystem::directory_iterator(dir))
+    {
+        std::filesystem::resize_file(entry.path(), 100);
+    }
+
+    {
+        wf::keymap_cache_t cache;
+        cache.set_disk_cache_dir(dir);
+        auto keymap = cache.get_keymap(names);
+        REQUIRE(keymap != nullptr);
+        REQUIRE(cache.get_stats().compiled == 1);
+        xkb_keymap_unref(keymap);
+    }
+
+    std::filesystem::remove_all(dir);
+}
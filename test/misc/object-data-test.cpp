@@ -0,0 +1,160 @@
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <wayfire/object.hpp>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+struct test_object_t : public wf::object_base_t
+{
+    ~test_object_t()
+    {
+        _clear_data();
+    }
+};
+
+struct data_a : public wf::custom_data_t
+{
+    int value = 1;
+};
+
+struct data_b : public wf::custom_data_t
+{
+    int value = 2;
+};
+
+template<int N>
+struct numbered_data_t : public wf::custom_data_t
+{
+    int value = N;
+};
+
+TEST_CASE("Typed and named custom data")
+{
+    test_object_t object;
+    REQUIRE(!object.has_data<data_a>());
+    REQUIRE(object.get_data<data_a>() == nullptr);
+
+    object.get_data_safe<data_a>()->value = 5;
+    REQUIRE(object.has_data<data_a>());
+    REQUIRE(object.get_data<data_a>()->value == 5);
+    REQUIRE(object.get_data<data_b>() == nullptr);
+
+    // Typed data can also be accessed via its type name and vice versa
+    REQUIRE(object.has_data(typeid(data_a).name()));
+    REQUIRE(object.get_data<data_a>(typeid(data_a).name())->value == 5);
+
+    object.store_data(std::make_unique<data_b>(), "custom-name");
+    REQUIRE(object.has_data("custom-name"));
+    REQUIRE(!object.has_data<data_b>());
+    REQUIRE(object.get_data<data_a>("custom-name") == nullptr);
+    REQUIRE(object.get_data<data_b>("custom-name")->value == 2);
+
+    // Replacing data
+    auto replacement = std::make_unique<data_a>();
+    replacement->value = 7;
+    object.store_data(std::move(replacement));
+    REQUIRE(object.get_data<data_a>()->value == 7);
+
+    auto released = object.release_data<data_a>();
+    REQUIRE(released->value == 7);
+    REQUIRE(!object.has_data<data_a>());
+    REQUIRE(object.get_data<data_b>("custom-name")->value == 2);
+
+    object.erase_data("custom-name");
+    REQUIRE(!object.has_data("custom-name"));
+    REQUIRE(object.release_data<data_b>("custom-name") == nullptr);
+}
+
+struct erasing_data_t : public wf::custom_data_t
+{
+    wf::object_base_t *object;
+    ~erasing_data_t()
+    {
+        // Destructors of custom data may access the object's other data.
+        object->erase_data<data_a>();
+    }
+};
+
+TEST_CASE("Custom data destructors may modify the object")
+{
+    test_object_t object;
+    object.get_data_safe<data_a>();
+    object.get_data_safe<erasing_data_t>()->object = &object;
+    object.get_data_safe<data_b>();
+
+    object.erase_data<erasing_data_t>();
+    REQUIRE(!object.has_data<data_a>());
+    REQUIRE(object.has_data<data_b>());
+
+    object.get_data_safe<erasing_data_t>()->object = &object;
+    object.get_data_safe<data_a>();
+}
+
+template<int... N>
+static void attach_data(wf::object_base_t& object, std::integer_sequence<int, N...>)
+{
+    (object.get_data_safe<numbered_data_t<N>>(), ...);
+}
+
+template<int... N>
+static void attach_data(std::unordered_map<std::string, std::unique_ptr<wf::custom_data_t>>& map,
+    std::integer_sequence<int, N...>)
+{
+    ((map[typeid(numbered_data_t<N>).name()] = std::make_unique<numbered_data_t<N>>()), ...);
+}
+
+template<int Count>
+static void benchmark_lookup()
+{
+    using clock = std::chrono::steady_clock;
+    static constexpr int ITERATIONS = 1000000;
+
+    test_object_t object;
+    attach_data(object, std::make_integer_sequence<int, Count>{});
+
+    // The previous storage: a map keyed by the type name
+    std::unordered_map<std::string, std::unique_ptr<wf::custom_data_t>> map;
+    attach_data(map, std::make_integer_sequence<int, Count>{});
+
+    // Look up the data which was attached first, last, and one in the middle.
+    using first  = numbered_data_t<0>;
+    using middle = numbered_data_t<Count / 2>;
+    using last   = numbered_data_t<Count - 1>;
+
+    int64_t sum = 0;
+    auto start  = clock::now();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        sum += object.get_data<first>()->value + object.get_data<middle>()->value +
+            object.get_data<last>()->value;
+    }
+
+    auto typed = clock::now() - start;
+
+    start = clock::now();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        sum += dynamic_cast<first*>(map[typeid(first).name()].get())->value +
+            dynamic_cast<middle*>(map[typeid(middle).name()].get())->value +
+            dynamic_cast<last*>(map[typeid(last).name()].get())->value;
+    }
+
+    auto hashed = clock::now() - start;
+
+    auto to_ns = [] (clock::duration d)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count() / (3.0 * ITERATIONS);
+    };
+
+    MESSAGE(Count << " data objects: slot lookup " << to_ns(typed) << "ns, name lookup " <<
+        to_ns(hashed) << "ns");
+    REQUIRE(sum == 2 * (int64_t)ITERATIONS * (0 + Count / 2 + Count - 1));
+}
+
+TEST_CASE("Benchmark: custom data lookup")
+{
+    benchmark_lookup<5>();
+    benchmark_lookup<20>();
+    benchmark_lookup<50>();
+}
@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <wayfire/scene.hpp>
+#include <wayfire/scene-operations.hpp>
+#include <wayfire/scene-render.hpp>
+#include <wayfire/unstable/translation-node.hpp>
+#include "core/core-impl.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+using namespace wf::scene;
+
+/**
+ * A mock scenegraph: root -> workspace -> N views, each view consisting of a few nested nodes.
+ */
+struct mock_scene_t
+{
+    floating_inner_ptr root = std::make_shared<floating_inner_node_t>(true);
+    floating_inner_ptr workspace = std::make_shared<floating_inner_node_t>(true);
+
+    mock_scene_t(int nr_views)
+    {
+        add_back(root, workspace);
+        for (int i = 0; i < nr_views; i++)
+        {
+            add_back(workspace, make_view());
+        }
+    }
+
+    static node_ptr make_view()
+    {
+        auto view = std::make_shared<floating_inner_node_t>(false);
+        auto surface = std::make_shared<floating_inner_node_t>(false);
+        add_back(surface, std::make_shared<floating_inner_node_t>(false));
+        add_back(view, surface);
+        add_back(view, std::make_shared<floating_inner_node_t>(false));
+        return view;
+    }
+};
+
+static void no_damage(const wf::region_t&)
+{}
+
+/**
+ * A node which shows another part of the scenegraph, like a workspace stream shows the views of an output.
+ * It does not override depends_on_whole_scene(), like most plugin nodes.
+ */
+struct mock_stream_node_t : public node_t
+{
+    struct instance_t : public render_instance_t
+    {
+        std::vector<render_instance_uptr> children;
+
+        void schedule_instructions(std::vector<render_instruction_t>&, const wf::render_target_t&,
+            wf::region_t&) override
+        {}
+    };
+
+    node_ptr source;
+    instance_t *last_instance = nullptr;
+
+    mock_stream_node_t(node_ptr source) : node_t(false), source(source)
+    {}
+
+    void gen_render_instances(std::vector<render_instance_uptr>& instances, damage_callback,
+        wf::output_t *output) override
+    {
+        auto instance = std::make_unique<instance_t>();
+        source->gen_render_instances(instance->children, no_damage, output);
+        last_instance = instance.get();
+        instances.push_back(std::move(instance));
+    }
+};
+
+/** A leaf node whose render instance remembers the node which generated it. */
+struct mock_leaf_node_t : public node_t
+{
+    struct instance_t : public render_instance_t
+    {
+        node_t *node;
+        void schedule_instructions(std::vector<render_instruction_t>&, const wf::render_target_t&,
+            wf::region_t&) override
+        {}
+    };
+
+    mock_leaf_node_t() : node_t(false)
+    {}
+
+    void gen_render_instances(std::vector<render_instance_uptr>& instances, damage_callback,
+        wf::output_t*) override
+    {
+        auto instance = std::make_unique<instance_t>();
+        instance->node = this;
+        instances.push_back(std::move(instance));
+    }
+
+    bool depends_on_whole_scene() const override
+    {
+        return false;
+    }
+};
+
+/** A leaf node which covers its box with opaque content and counts how often it was scheduled. */
+struct mock_opaque_node_t : public node_t
+{
+    struct instance_t : public render_instance_t
+    {
+        mock_opaque_node_t *node;
+        void schedule_instructions(std::vector<render_instruction_t>& instructions,
+            const wf::render_target_t& target, wf::region_t& damage) override
+        {
+            ++node->scheduled;
+            instructions.push_back(render_instruction_t{
+                    .instance = this,
+                    .target   = target,
+                    .damage   = damage & node->box,
+                });
+            damage ^= node->box;
+        }
+    };
+
+    wf::geometry_t box;
+    int scheduled = 0;
+
+    mock_opaque_node_t(wf::geometry_t box) : node_t(false), box(box)
+    {}
+
+    void gen_render_instances(std::vector<render_instance_uptr>& instances, damage_callback,
+        wf::output_t*) override
+    {
+        auto instance = std::make_unique<instance_t>();
+        instance->node = this;
+        instances.push_back(std::move(instance));
+    }
+
+    wf::geometry_t get_bounding_box() override
+    {
+        return box;
+    }
+};
+
+static std::vector<render_instance_uptr> full_rebuild(node_ptr root)
+{
+    std::vector<render_instance_uptr> instances;
+    root->gen_render_instances(instances, no_damage, nullptr);
+    return instances;
+}
+
+static void ensure_core()
+{
+    // scene::update() needs to compare nodes against the real scenegraph root.
+    static bool allocated = false;
+    if (!allocated)
+    {
+        wf::compositor_core_impl_t::allocate_core();
+        allocated = true;
+    }
+}
+
+TEST_CASE("Incremental regeneration reuses instances of unchanged subtrees")
+{
+    ensure_core();
+    mock_scene_t scene{10};
+
+    std::vector<render_instance_uptr> instances;
+    regen_render_instances(scene.root, instances, no_damage, nullptr);
+    REQUIRE(instances.size() == full_rebuild(scene.root).size());
+
+    std::set<render_instance_t*> before;
+    for (auto& inst : instances)
+    {
+        before.insert(inst.get());
+    }
+
+    // Map a new view
+    auto view = mock_scene_t::make_view();
+    add_front(scene.workspace, view);
+    regen_render_instances(scene.root, instances, no_damage, nullptr);
+
+    auto expected = full_rebuild(scene.root);
+    REQUIRE(instances.size() == expected.size());
+
+    int reused = 0;
+    for (auto& inst : instances)
+    {
+        reused += before.count(inst.get());
+    }
+
+    // Only the instances of the new view (4 nodes) are new
+    REQUIRE(reused == (int)instances.size() - 4);
+
+    // Disable the view again
+    set_node_enabled(view, false);
+    regen_render_instances(scene.root, instances, no_damage, nullptr);
+    REQUIRE(instances.size() == before.size());
+    for (auto& inst : instances)
+    {
+        REQUIRE(before.count(inst.get()));
+    }
+
+    // Remove a view and reorder the rest
+    auto children = scene.workspace->get_children();
+    remove_child(children[3]);
+    raise_to_front(children.back());
+    regen_render_instances(scene.root, instances, no_damage, nullptr);
+    REQUIRE(instances.size() == full_rebuild(scene.root).size());
+}
+
+TEST_CASE("Nodes which depend on the whole scene are regenerated")
+{
+    ensure_core();
+    mock_scene_t scene{3};
+    auto stream = std::make_shared<mock_stream_node_t>(scene.workspace);
+    add_front(scene.root, stream);
+
+    std::vector<render_instance_uptr> instances;
+    regen_render_instances(scene.root, instances, no_damage, nullptr);
+
+    auto shows = [] (mock_stream_node_t& stream, node_t *node)
+    {
+        auto& children = stream.last_instance->children;
+        return std::any_of(children.begin(), children.end(), [&] (const render_instance_uptr& inst)
+        {
+            auto leaf = dynamic_cast<mock_leaf_node_t::instance_t*>(inst.get());
+            return leaf && (leaf->node == node);
+        });
+    };
+
+    // Map a view while the stream exists: only the workspace changed, but the stream has to show the view.
+    auto view = std::make_shared<mock_leaf_node_t>();
+    add_front(scene.workspace, view);
+    regen_render_instances(scene.root, instances, no_damage, nullptr);
+    REQUIRE(shows(*stream, view.get()));
+    REQUIRE(instances.size() == full_rebuild(scene.root).size());
+
+    // Unmapping the view removes it from the stream as well.
+    remove_child(view);
+    regen_render_instances(scene.root, instances, no_damage, nullptr);
+    REQUIRE(!shows(*stream, view.get()));
+
+    // A stream nested in an unchanged subtree is regenerated too.
+    auto overlay = std::make_shared<floating_inner_node_t>(false);
+    auto nested_stream = std::make_shared<mock_stream_node_t>(scene.workspace);
+    add_back(overlay, nested_stream);
+    add_back(scene.root, overlay);
+    regen_render_instances(scene.root, instances, no_damage, nullptr);
+
+    add_front(scene.workspace, view);
+    regen_render_instances(scene.root, instances, no_damage, nullptr);
+    REQUIRE(shows(*nested_stream, view.get()));
+}
+
+TEST_CASE("Custom render instances are reused only if the node opts in")
+{
+    ensure_core();
+    mock_scene_t scene{3};
+    auto leaf   = std::make_shared<mock_leaf_node_t>();
+    auto stream = std::make_shared<mock_stream_node_t>(scene.workspace);
+    add_back(scene.root, leaf);
+    add_back(scene.root, stream);
+
+    std::vector<render_instance_uptr> instances;
+    regen_render_instances(scene.root, instances, no_damage, nullptr);
+    auto find_leaf_instance = [&] () -> render_instance_t*
+    {
+        for (auto& inst : instances)
+        {
+            if (auto leaf_instance = dynamic_cast<mock_leaf_node_t::instance_t*>(inst.get());
+                leaf_instance && (leaf_instance->node == leaf.get()))
+            {
+                return leaf_instance;
+            }
+        }
+
+        return nullptr;
+    };
+
+    auto leaf_instance   = find_leaf_instance();
+    auto stream_instance = stream->last_instance;
+    REQUIRE(leaf_instance != nullptr);
+
+    add_front(scene.workspace, mock_scene_t::make_view());
+    regen_render_instances(scene.root, instances, no_damage, nullptr);
+    REQUIRE(find_leaf_instance() == leaf_instance);
+    REQUIRE(stream->last_instance != stream_instance);
+}
+
+TEST_CASE("Instances below an opaque fullscreen node are not scheduled")
+{
+    ensure_core();
+    const wf::geometry_t screen = {0, 0, 1920, 1080};
+    auto translation = std::make_shared<translation_node_t>();
+    auto fullscreen  = std::make_shared<mock_opaque_node_t>(screen);
+    auto below = std::make_shared<mock_opaque_node_t>(wf::geometry_t{100, 100, 500, 500});
+    add_back(translation, fullscreen);
+    add_back(translation, below);
+
+    std::vector<render_instance_uptr> instances;
+    translation->gen_render_instances(instances, no_damage, nullptr);
+    REQUIRE(instances.size() == 1);
+
+    std::vector<render_instruction_t> instructions;
+    wf::render_target_t target;
+    target.geometry = screen;
+    wf::region_t damage{screen};
+    instances[0]->schedule_instructions(instructions, target, damage);
+    REQUIRE(damage.empty());
+    REQUIRE(fullscreen->scheduled == 1);
+    REQUIRE(below->scheduled == 0);
+
+    // Once the fullscreen node is gone, the node below it is visible again.
+    remove_child(fullscreen);
+    instructions.clear();
+    damage = screen;
+    instances[0]->schedule_instructions(instructions, target, damage);
+    REQUIRE(below->scheduled == 1);
+}
+
+TEST_CASE("Benchmark: full vs. incremental regeneration of render instances")
+{
+    ensure_core();
+    using clock = std::chrono::steady_clock;
+    static constexpr int ITERATIONS = 50;
+
+    for (int nr_views : {10, 100, 500})
+    {
+        mock_scene_t scene{nr_views};
+        std::vector<render_instance_uptr> instances;
+        regen_render_instances(scene.root, instances, no_damage, nullptr);
+
+        clock::duration full{0}, incremental{0};
+        for (int i = 0; i < ITERATIONS; i++)
+        {
+            // A view is mapped and unmapped again
+            auto view = mock_scene_t::make_view();
+            add_front(scene.workspace, view);
+
+            auto start = clock::now();
+            instances.clear();
+            scene.root->gen_render_instances(instances, no_damage, nullptr);
+            full += clock::now() - start;
+
+            remove_child(view);
+            add_front(scene.workspace, view);
+
+            start = clock::now();
+            regen_render_instances(scene.root, instances, no_damage, nullptr);
+            incremental += clock::now() - start;
+
+            remove_child(view);
+            regen_render_instances(scene.root, instances, no_damage, nullptr);
+        }
+
+        auto to_us = [] (clock::duration d)
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>(d).count() / (double)ITERATIONS;
+        };
+
+        MESSAGE(nr_views << " views: full rebuild " << to_us(full) << "us, incremental " <<
+            to_us(incremental) << "us");
+        REQUIRE(instances.size() == full_rebuild(scene.root).size());
+    }
+}
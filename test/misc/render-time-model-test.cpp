@@ -0,0 +1,61 @@
+#include "output/render-time-model.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+using model_t = wf::render_time_model_t;
+
+TEST_CASE("Render time model needs enough samples")
+{
+    model_t model;
+    REQUIRE(model.predict() == -1);
+    for (size_t i = 0; i < model_t::MIN_SAMPLES - 1; i++)
+    {
+        model.add_sample(1000);
+        REQUIRE(model.predict() == -1);
+    }
+
+    model.add_sample(1000);
+    REQUIRE(model.predict() == 1000);
+}
+
+TEST_CASE("Render time model ignores single outliers")
+{
+    model_t model;
+    for (size_t i = 0; i < model_t::HISTORY; i++)
+    {
+        model.add_sample((i == 10) ? 50'000 : 1000 + (int64_t)i);
+    }
+
+    // The prediction covers almost all regular frames, but not the outlier.
+    const int64_t predicted = model.predict();
+    REQUIRE(predicted < 50'000);
+    REQUIRE(predicted >= 1000 + (int64_t)(model_t::HISTORY * model_t::PERCENTILE) - 1);
+}
+
+TEST_CASE("Render time model follows the latest frames")
+{
+    model_t model;
+    for (size_t i = 0; i < model_t::HISTORY; i++)
+    {
+        model.add_sample(8000);
+    }
+
+    REQUIRE(model.predict() == 8000);
+
+    // Old samples are replaced once the history is full.
+    for (size_t i = 0; i < model_t::HISTORY; i++)
+    {
+        model.add_sample(2000);
+    }
+
+    REQUIRE(model.predict() == 2000);
+
+    model.clear();
+    REQUIRE(model.predict() == -1);
+    for (size_t i = 0; i < model_t::MIN_SAMPLES; i++)
+    {
+        model.add_sample(3000);
+    }
+
+    REQUIRE(model.predict() == 3000);
+}
@@ -0,0 +1,116 @@
+#include <chrono>
+#include <wayfire/signal-provider.hpp>
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+struct signal_a
+{
+    int value = 0;
+};
+
+struct signal_b
+{
+    int value = 0;
+};
+
+TEST_CASE("Signals are dispatched by type")
+{
+    wf::signal::provider_t provider;
+    int a = 0, b = 0;
+    wf::signal::connection_t<signal_a> on_a = [&] (signal_a *ev) { a += ev->value; };
+    wf::signal::connection_t<signal_b> on_b = [&] (signal_b *ev) { b += ev->value; };
+
+    provider.connect(&on_a);
+    provider.connect(&on_b);
+
+    signal_a ev_a{1};
+    signal_b ev_b{10};
+    provider.emit(&ev_a);
+    provider.emit(&ev_b);
+    REQUIRE(a == 1);
+    REQUIRE(b == 10);
+
+    on_a.disconnect();
+    provider.emit(&ev_a);
+    REQUIRE(a == 1);
+    REQUIRE(!on_a.is_connected());
+    REQUIRE(on_b.is_connected());
+}
+
+TEST_CASE("Connections can be changed during emission")
+{
+    wf::signal::provider_t provider;
+    int first = 0, second = 0, added = 0;
+
+    wf::signal::connection_t<signal_a> on_added = [&] (signal_a*) { ++added; };
+    wf::signal::connection_t<signal_b> on_other_type = [&] (signal_b*) {};
+    wf::signal::connection_t<signal_a> on_second = [&] (signal_a*) { ++second; };
+    wf::signal::connection_t<signal_a> on_first  = [&] (signal_a*)
+    {
+        ++first;
+        on_second.disconnect();
+        provider.connect(&on_added);
+        provider.connect(&on_other_type);
+    };
+
+    provider.connect(&on_first);
+    provider.connect(&on_second);
+
+    signal_a ev;
+    provider.emit(&ev);
+    REQUIRE(first == 1);
+    REQUIRE(second == 0);
+    REQUIRE(added == 0);
+
+    on_first.disconnect();
+    provider.emit(&ev);
+    REQUIRE(first == 1);
+    REQUIRE(added == 1);
+}
+
+TEST_CASE("Destroying the provider disconnects its connections")
+{
+    wf::signal::connection_t<signal_a> conn = [&] (signal_a*) {};
+    {
+        wf::signal::provider_t provider;
+        provider.connect(&conn);
+        REQUIRE(conn.is_connected());
+    }
+
+    REQUIRE(!conn.is_connected());
+}
+
+TEST_CASE("Benchmark: signal emission")
+{
+    using clock = std::chrono::steady_clock;
+    static constexpr int EMISSIONS = 100'000;
+
+    for (int nr_listeners : {1, 10, 100})
+    {
+        wf::signal::provider_t provider;
+        int64_t sum = 0;
+
+        // A few unrelated signal types, as is typical for nodes and views
+        wf::signal::connection_t<signal_b> other = [&] (signal_b*) {};
+        provider.connect(&other);
+
+        std::vector<std::unique_ptr<wf::signal::connection_t<signal_a>>> connections;
+        for (int i = 0; i < nr_listeners; i++)
+        {
+            connections.push_back(std::make_unique<wf::signal::connection_t<signal_a>>(
+                [&] (signal_a *ev) { sum += ev->value; }));
+            provider.connect(connections.back().get());
+        }
+
+        signal_a ev{1};
+        auto start = clock::now();
+        for (int i = 0; i < EMISSIONS; i++)
+        {
+            provider.emit(&ev);
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start);
+        MESSAGE(nr_listeners << " listeners: " << elapsed.count() / (double)EMISSIONS << "ns per emit");
+        REQUIRE(sum == (int64_t)EMISSIONS * nr_listeners);
+    }
+}
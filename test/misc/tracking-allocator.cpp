@@ -1,5 +1,8 @@
 #include "wayfire/nonstd/tracking-allocator.hpp"
 #include "wayfire/signal-provider.hpp"
+#include <algorithm>
+#include <chrono>
+#include <vector>
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <doctest/doctest.h>
 
@@ -55,3 +58,161 @@ TEST_CASE("Misc factory works")
     REQUIRE(destruct_events == 1);
     REQUIRE(allocator.get_all().size() == 1);
 }
+
+TEST_CASE("Objects can be freed while iterating over a range")
+{
+    auto& allocator = wf::tracking_allocator_t<base_t>::get();
+    std::vector<std::shared_ptr<base_t>> objects;
+    for (int i = 0; i < 10; i++)
+    {
+        objects.push_back(allocator.allocate<base_t>());
+    }
+
+    int visited = 0;
+    for (auto& obj : allocator.get_range())
+    {
+        REQUIRE(obj != nullptr);
+        ++visited;
+
+        // Free the first object and one which has not been visited yet.
+        if (obj.get() == objects[0].get())
+        {
+            objects[0].reset();
+            objects[9].reset();
+        }
+    }
+
+    REQUIRE(visited >= 9);
+    REQUIRE(allocator.get_all().size() == 8);
+    for (auto& obj : allocator.get_all())
+    {
+        REQUIRE(obj != nullptr);
+    }
+
+    objects.clear();
+    REQUIRE(allocator.get_all().empty());
+    REQUIRE(allocator.get_range().empty());
+}
+
+TEST_CASE("Objects stay in allocation order")
+{
+    auto& allocator = wf::tracking_allocator_t<base_t>::get();
+    std::vector<std::shared_ptr<base_t>> objects;
+    for (int i = 0; i < 10; i++)
+    {
+        objects.push_back(allocator.allocate<base_t>());
+    }
+
+    auto check_order = [&] ()
+    {
+        std::vector<base_t*> expected;
+        for (auto& obj : objects)
+        {
+            if (obj)
+            {
+                expected.push_back(obj.get());
+            }
+        }
+
+        std::vector<base_t*> all;
+        for (auto& obj : allocator.get_all())
+        {
+            all.push_back(obj.get());
+        }
+
+        std::vector<base_t*> ranged;
+        for (auto& obj : allocator.get_range())
+        {
+            ranged.push_back(obj.get());
+        }
+
+        REQUIRE(all == expected);
+        REQUIRE(ranged == expected);
+    };
+
+    objects[2].reset();
+    check_order();
+
+    {
+        // Holes are not exposed by get_all() while a range is alive.
+        auto range = allocator.get_range();
+        objects[5].reset();
+        objects[0].reset();
+        check_order();
+    }
+
+    for (int i = 0; i < 5; i++)
+    {
+        objects.push_back(allocator.allocate<base_t>());
+        objects[3 + i].reset();
+        check_order();
+    }
+
+    objects.clear();
+    REQUIRE(allocator.get_all().empty());
+}
+
+TEST_CASE("get_all() does not copy the list of objects")
+{
+    auto& allocator = wf::tracking_allocator_t<base_t>::get();
+    std::vector<std::shared_ptr<base_t>> objects;
+    for (int i = 0; i < 10; i++)
+    {
+        objects.push_back(allocator.allocate<base_t>());
+    }
+
+    const auto *list = &allocator.get_all();
+    objects[4].reset();
+    REQUIRE(&allocator.get_all() == list);
+    REQUIRE(allocator.get_all().size() == 9);
+    REQUIRE(std::count(list->begin(), list->end(), nullptr) == 0);
+
+    objects.clear();
+    REQUIRE(allocator.get_all().empty());
+}
+
+TEST_CASE("Benchmark: allocate and free many objects")
+{
+    using clock = std::chrono::steady_clock;
+    auto& allocator = wf::tracking_allocator_t<base_t>::get();
+
+    for (int nr_objects : {100, 1000, 10000})
+    {
+        std::vector<std::shared_ptr<base_t>> objects;
+        auto start = clock::now();
+        for (int i = 0; i < nr_objects; i++)
+        {
+            objects.push_back(allocator.allocate<base_t>());
+        }
+
+        // Free the objects in allocation order, which is the worst case for a linear search.
+        for (auto& obj : objects)
+        {
+            obj.reset();
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+        MESSAGE(nr_objects << " objects: " << elapsed.count() << "us to allocate and free");
+        REQUIRE(allocator.get_all().empty());
+
+        for (int i = 0; i < nr_objects; i++)
+        {
+            objects[i] = allocator.allocate<base_t>();
+        }
+
+        start = clock::now();
+        size_t count = 0;
+        for (int i = 0; i < 100; i++)
+        {
+            for (auto& obj : allocator.get_range())
+            {
+                count += (obj != nullptr);
+            }
+        }
+
+        elapsed = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+        MESSAGE(nr_objects << " objects: " << elapsed.count() / 100.0 << "us per iteration");
+        REQUIRE(count == 100 * (size_t)nr_objects);
+        objects.clear();
+    }
+}
@@ -0,0 +1,250 @@
+#include <chrono>
+#include <string>
+#include <vector>
+#include <wayfire/lexer/lexer.hpp>
+#include <wayfire/parser/rule_parser.hpp>
+#include "rules-engine.hpp"
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+struct fake_view_t : public wf::object_base_t
+{
+    std::string app_id;
+    std::string title;
+    bool maximized = false;
+    int reads = 0;
+
+    // The actions executed on the view, in order.
+    std::vector<std::string> actions;
+
+    ~fake_view_t()
+    {
+        _clear_data();
+    }
+};
+
+class fake_access_t : public wf::access_interface_t
+{
+  public:
+    fake_view_t *view;
+
+    wf::variant_t get(const std::string & identifier, bool & error) override
+    {
+        error = false;
+        view->reads++;
+        if (identifier == "app_id")
+        {
+            return view->app_id;
+        } else if (identifier == "title")
+        {
+            return view->title;
+        } else if (identifier == "maximized")
+        {
+            return std::string(view->maximized ? "yes" : "no");
+        }
+
+        error = true;
+        return std::string("");
+    }
+};
+
+class fake_action_t : public wf::action_interface_t
+{
+  public:
+    fake_view_t *view;
+
+    bool execute(const std::string & name, const std::vector<wf::variant_t> & args) override
+    {
+        std::string action = name;
+        for (auto& arg : args)
+        {
+            action += " " + wf::get_string(arg);
+        }
+
+        view->actions.push_back(action);
+        if (name == "maximize")
+        {
+            view->maximized = true;
+        }
+
+        return false;
+    }
+};
+
+static std::vector<std::shared_ptr<wf::rule_t>> parse_rules(const std::vector<std::string>& texts)
+{
+    std::vector<std::shared_ptr<wf::rule_t>> rules;
+    wf::lexer_t lexer;
+    for (auto& text : texts)
+    {
+        lexer.reset(text);
+        auto rule = wf::rule_parser_t().parse(lexer);
+        REQUIRE(rule != nullptr);
+        rules.push_back(rule);
+    }
+
+    return rules;
+}
+
+// Applies the rules one after another, as window-rules did without the engine.
+static void apply_naive(const std::vector<std::shared_ptr<wf::rule_t>>& rules, const std::string& signal,
+    fake_view_t& view)
+{
+    fake_access_t access;
+    fake_action_t action;
+    access.view = action.view = &view;
+    for (auto& rule : rules)
+    {
+        rule->apply(signal, access, action);
+    }
+}
+
+static void apply_engine(wf::window_rules_engine_t& engine, const std::string& signal, fake_view_t& view)
+{
+    fake_access_t access;
+    fake_action_t action;
+    access.view = action.view = &view;
+    engine.apply(signal, view, access, action);
+}
+
+TEST_CASE("Window rules engine executes the same actions as applying each rule")
+{
+    auto rules = parse_rules({
+        "on created if app_id is \"term\" then maximize",
+        "on created if app_id is \"term\" & maximized is \"yes\" then set alpha 0.9",
+        "on created if title contains \"secret\" then minimize",
+        "on maximized if app_id is \"editor\" & title contains \"draft\" then set alpha 0.5",
+        "on maximized if app_id is \"term\" | title is \"notes\" then set alpha 0.7",
+        "on minimized if app_id is \"editor\" then set alpha 1.0",
+    });
+
+    wf::window_rules_engine_t engine;
+    engine.set_rules(rules);
+
+    const std::vector<std::pair<std::string, std::string>> views = {
+        {"term", "shell"}, {"term", "secret shell"}, {"editor", "draft 1"}, {"editor", "notes"},
+        {"browser", "secret"}, {"browser", "notes"}, {"term", "notes"},
+    };
+
+    for (int round = 0; round < 3; round++)
+    {
+        for (auto& [app_id, title] : views)
+        {
+            fake_view_t expected, actual;
+            expected.app_id = actual.app_id = app_id;
+            expected.title  = actual.title = title;
+
+            for (auto& signal : {"created", "maximized", "maximized", "minimized", "unmaximized"})
+            {
+                apply_naive(rules, signal, expected);
+                apply_engine(engine, signal, actual);
+                REQUIRE(actual.actions == expected.actions);
+            }
+
+            // Rules which read several properties see changes to any of them.
+            expected.title = actual.title = "draft 2";
+            apply_naive(rules, "maximized", expected);
+            apply_engine(engine, "maximized", actual);
+            REQUIRE(actual.actions == expected.actions);
+        }
+    }
+}
+
+TEST_CASE("Window rules engine reads each property once per signal")
+{
+    std::vector<std::string> texts;
+    for (int i = 0; i < 50; i++)
+    {
+        texts.push_back("on created if app_id is \"app-" + std::to_string(i) + "\" then minimize");
+    }
+
+    wf::window_rules_engine_t engine;
+    engine.set_rules(parse_rules(texts));
+
+    fake_view_t view;
+    view.app_id = "app-7";
+    apply_engine(engine, "created", view);
+    REQUIRE(view.actions == std::vector<std::string>{"minimize"});
+    // Once for the rules before the action, and once for the rules after it, since the action changes the view.
+    REQUIRE(view.reads == 2);
+
+    // No rule reacts to other signals.
+    apply_engine(engine, "maximized", view);
+    REQUIRE(view.reads == 2);
+
+    // Reloading the rules drops all cached results.
+    engine.set_rules(parse_rules({"on created if app_id is \"app-8\" then maximize"}));
+    view.app_id = "app-8";
+    apply_engine(engine, "created", view);
+    REQUIRE(view.actions == std::vector<std::string>{"minimize", "maximize"});
+}
+
+TEST_CASE("Benchmark: applying window rules")
+{
+    using clock = std::chrono::steady_clock;
+    static constexpr int NUM_VIEWS = 100;
+
+    for (int num_rules : {30, 300, 1000})
+    {
+        std::vector<std::string> texts;
+        for (int i = 0; i < num_rules; i++)
+        {
+            const auto id = std::to_string(i);
+            if (i % 3 == 0)
+            {
+                texts.push_back("on created if app_id is \"app-" + id + "\" then set alpha 0.9");
+            } else if (i % 3 == 1)
+            {
+                texts.push_back("on created if title contains \"title-" + id + "\" then minimize");
+            } else
+            {
+                texts.push_back("on maximized if app_id is \"app-" + id + "\" & title contains \"x\" then "
+                                                                          "set alpha 0.5");
+            }
+        }
+
+        auto rules = parse_rules(texts);
+        wf::window_rules_engine_t engine;
+        engine.set_rules(rules);
+
+        // Views of a few different applications, as in a typical session.
+        std::vector<fake_view_t> naive_views(NUM_VIEWS), engine_views(NUM_VIEWS);
+        for (int i = 0; i < NUM_VIEWS; i++)
+        {
+            naive_views[i].app_id = engine_views[i].app_id = "app-" + std::to_string(i % 10);
+            naive_views[i].title  = engine_views[i].title = "title " + std::to_string(i);
+        }
+
+        auto run = [&] (std::vector<fake_view_t>& views, auto apply)
+        {
+            auto start = clock::now();
+            for (auto& view : views)
+            {
+                apply("created", view);
+                apply("maximized", view);
+                apply("unmaximized", view);
+                apply("maximized", view);
+            }
+
+            return std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start).count();
+        };
+
+        auto naive = run(naive_views, [&] (auto signal, fake_view_t& view)
+        {
+            apply_naive(rules, signal, view);
+        });
+
+        auto compiled = run(engine_views, [&] (auto signal, fake_view_t& view)
+        {
+            apply_engine(engine, signal, view);
+        });
+
+        for (int i = 0; i < NUM_VIEWS; i++)
+        {
+            REQUIRE(engine_views[i].actions == naive_views[i].actions);
+        }
+
+        MESSAGE(num_rules << " rules, " << NUM_VIEWS << " views: per rule " << naive << "us, compiled " <<
+            compiled << "us");
+    }
+}
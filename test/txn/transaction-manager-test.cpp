@@ -10,6 +10,7 @@
 #include "transaction-test-object.hpp"
 #include <wayfire/txn/transaction.hpp>
 #include "../../src/core/txn/transaction-manager-impl.hpp"
+#include <chrono>
 
 static wf::txn::transaction_uptr new_tx()
 {
@@ -290,3 +291,171 @@ TEST_CASE("Concurrent committed")
     REQUIRE(mgr.pending.size() == 0);
     REQUIRE(mgr.done.size() == 2);
 }
+
+TEST_CASE("Transactions scheduled in a batch are merged")
+{
+    setup_wayfire_debugging_state();
+    wf::txn::transaction_manager_t::impl mgr;
+
+    auto obj_a = std::make_shared<txn_test_object_t>(false);
+    auto obj_b = std::make_shared<txn_test_object_t>(false);
+
+    auto tx1 = new_tx();
+    tx1->add_object(obj_a);
+    auto tx2 = new_tx();
+    tx2->add_object(obj_b);
+
+    mgr.begin_batch();
+    mgr.schedule_transaction(std::move(tx1));
+    mgr.begin_batch();
+    mgr.schedule_transaction(std::move(tx2));
+    mgr.end_batch();
+
+    // Nothing is scheduled until the outermost batch ends
+    REQUIRE(mgr.committed.size() == 0);
+    REQUIRE(mgr.pending.size() == 0);
+    REQUIRE(obj_a->number_committed == 0);
+
+    mgr.end_batch();
+    REQUIRE(mgr.committed.size() == 1);
+    REQUIRE(mgr.committed.front()->get_objects().size() == 2);
+    REQUIRE(obj_a->number_committed == 1);
+    REQUIRE(obj_b->number_committed == 1);
+
+    // The objects are applied together
+    obj_a->emit_ready();
+    REQUIRE(obj_a->number_applied == 0);
+    obj_b->emit_ready();
+    REQUIRE(obj_a->number_applied == 1);
+    REQUIRE(obj_b->number_applied == 1);
+    REQUIRE(mgr.committed.size() == 0);
+
+    // An empty batch does nothing
+    mgr.begin_batch();
+    mgr.end_batch();
+    REQUIRE(mgr.committed.size() == 0);
+    REQUIRE(mgr.pending.size() == 0);
+}
+
+TEST_CASE("Pending and committed objects are indexed")
+{
+    setup_wayfire_debugging_state();
+    wf::txn::transaction_manager_t::impl mgr;
+
+    auto obj_a = std::make_shared<txn_test_object_t>(false);
+    auto obj_b = std::make_shared<txn_test_object_t>(false);
+    auto obj_c = std::make_shared<txn_test_object_t>(false);
+
+    auto tx1 = new_tx();
+    tx1->add_object(obj_a);
+    mgr.schedule_transaction(std::move(tx1));
+    REQUIRE(mgr.committed_index.count(obj_a.get()));
+    REQUIRE(mgr.pending_index.empty());
+
+    // tx2 waits for tx1, tx3 is merged into tx2 because they share obj_b
+    auto tx2 = new_tx();
+    tx2->add_object(obj_a);
+    tx2->add_object(obj_b);
+    mgr.schedule_transaction(std::move(tx2));
+
+    auto tx3 = new_tx();
+    tx3->add_object(obj_b);
+    tx3->add_object(obj_c);
+    auto tx3_ptr = tx3.get();
+    mgr.schedule_transaction(std::move(tx3));
+
+    REQUIRE(mgr.pending.size() == 1);
+    REQUIRE(mgr.pending_index.size() == 3);
+    for (auto& obj : {obj_a, obj_b, obj_c})
+    {
+        REQUIRE(mgr.pending_index[obj.get()] == tx3_ptr);
+    }
+
+    obj_a->emit_ready();
+    REQUIRE(mgr.pending_index.empty());
+    REQUIRE(mgr.committed_index.size() == 3);
+
+    obj_a->emit_ready();
+    obj_b->emit_ready();
+    obj_c->emit_ready();
+    REQUIRE(mgr.committed.empty());
+    REQUIRE(mgr.committed_index.empty());
+}
+
+TEST_CASE("Benchmark: scheduling transactions with many objects in flight")
+{
+    setup_wayfire_debugging_state();
+    wf::log::enabled_categories.reset();
+    using clock = std::chrono::steady_clock;
+    static constexpr int ROUNDS = 10;
+
+    auto per_tx_ns = [] (clock::duration elapsed, int nr_tx)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / (double)nr_tx;
+    };
+
+    for (int nr_objects : {10, 40, 160, 640})
+    {
+        std::vector<std::shared_ptr<txn_test_object_t>> objects;
+        for (int i = 0; i < nr_objects; i++)
+        {
+            objects.push_back(std::make_shared<txn_test_object_t>(false));
+        }
+
+        // Independent views: each view waits for its previous configure, while new ones keep arriving.
+        wf::txn::transaction_manager_t::impl independent;
+        auto start = clock::now();
+        for (int round = 0; round < ROUNDS; round++)
+        {
+            for (auto& obj : objects)
+            {
+                auto tx = new_tx();
+                tx->add_object(obj);
+                independent.schedule_transaction(std::move(tx));
+            }
+        }
+
+        auto independent_time = clock::now() - start;
+        REQUIRE(independent.committed.size() == (size_t)nr_objects);
+        REQUIRE(independent.pending.size() == (size_t)nr_objects);
+
+        // Tiled views during a resize: each view is configured together with its neighbour, so all
+        // transactions are coalesced into a single one.
+        wf::txn::transaction_manager_t::impl tiled;
+        auto blocker = new_tx();
+        for (auto& obj : objects)
+        {
+            blocker->add_object(obj);
+        }
+
+        tiled.schedule_transaction(std::move(blocker));
+        start = clock::now();
+        for (int round = 0; round < ROUNDS; round++)
+        {
+            for (int i = 0; i < nr_objects; i++)
+            {
+                auto tx = new_tx();
+                tx->add_object(objects[i]);
+                tx->add_object(objects[(i + 1) % nr_objects]);
+                tiled.schedule_transaction(std::move(tx));
+            }
+        }
+
+        auto tiled_time = clock::now() - start;
+        REQUIRE(tiled.pending.size() == 1);
+        REQUIRE(tiled.pending.front()->get_objects().size() == (size_t)nr_objects);
+
+        MESSAGE(nr_objects << " objects: independent " << per_tx_ns(independent_time, ROUNDS * nr_objects) <<
+            "ns, coalesced " << per_tx_ns(tiled_time, ROUNDS * nr_objects) << "ns per scheduled transaction");
+
+        // Both managers apply everything once the objects become ready.
+        for (auto& obj : objects)
+        {
+            obj->emit_ready();
+        }
+
+        REQUIRE(independent.pending.empty());
+        REQUIRE(tiled.pending.empty());
+        REQUIRE(tiled.committed.size() == 1);
+    }
+}
@@ -138,3 +138,119 @@ TEST_CASE("Edge cases")
     tx.commit();
     REQUIRE(applied == 1);
 }
+
+TEST_CASE("Readiness of transaction objects is tracked")
+{
+    setup_wayfire_debugging_state();
+    wf::wl_timer<false>::callback_t tx_timeout_callback;
+    wf::txn::transaction_t::timer_setter_t timer_setter =
+        [&] (uint64_t, wf::wl_timer<false>::callback_t cb)
+    {
+        tx_timeout_callback = cb;
+    };
+
+    auto fast = std::make_shared<txn_test_object_t>(false);
+    auto slow = std::make_shared<txn_test_object_t>(false);
+
+    // Runs a transaction with both objects in which only the fast object becomes ready on its own.
+    // Returns whether the transaction was applied before the timeout.
+    auto run_transaction = [&] (bool slow_ready_in_time)
+    {
+        bool applied = false;
+        wf::signal::connection_t<wf::txn::transaction_applied_signal> on_apply =
+            [&] (wf::txn::transaction_applied_signal *ev) { applied = true; };
+
+        wf::txn::transaction_t tx(100, timer_setter);
+        tx.set_slow_object_threshold(2);
+        tx.connect(&on_apply);
+        tx.add_object(fast);
+        tx.add_object(slow);
+        tx.commit();
+
+        if (slow_ready_in_time)
+        {
+            slow->emit_ready();
+        }
+
+        fast->emit_ready();
+        const bool applied_early = applied;
+        if (!applied)
+        {
+            tx_timeout_callback();
+        }
+
+        REQUIRE(applied);
+        return applied_early;
+    };
+
+    REQUIRE(run_transaction(true));
+    REQUIRE(slow->get_readiness_stats().commits == 1);
+    REQUIRE(slow->get_readiness_stats().timeouts == 0);
+    REQUIRE(fast->get_readiness_stats().last_latency_us >= 0);
+    REQUIRE(fast->get_readiness_stats().max_latency_us >= fast->get_readiness_stats().last_latency_us);
+
+    // The slow object times out twice and is then considered slow.
+    REQUIRE(!run_transaction(false));
+    REQUIRE(!run_transaction(false));
+    REQUIRE(slow->get_readiness_stats().timeouts == 2);
+    REQUIRE(slow->get_readiness_stats().consecutive_timeouts == 2);
+    REQUIRE(fast->get_readiness_stats().timeouts == 0);
+    REQUIRE(slow->get_readiness_stats().is_slow(2));
+    REQUIRE(!slow->get_readiness_stats().is_slow(0));
+    REQUIRE(!fast->get_readiness_stats().is_slow(2));
+
+    // From now on, transactions do not wait for it anymore, but still apply its state.
+    REQUIRE(run_transaction(false));
+    REQUIRE(slow->number_applied == 4);
+    REQUIRE(slow->get_readiness_stats().skipped == 1);
+    REQUIRE(slow->get_readiness_stats().timeouts == 2);
+
+    // After being skipped several times, it is waited for again to check whether it has recovered.
+    int skipped_in_row = 1;
+    while (run_transaction(false))
+    {
+        ++skipped_in_row;
+    }
+
+    REQUIRE(skipped_in_row == 10);
+    REQUIRE(slow->get_readiness_stats().timeouts == 3);
+    REQUIRE(slow->get_readiness_stats().consecutive_timeouts == 3);
+
+    // Becoming ready in time again makes it a regular object.
+    REQUIRE(run_transaction(true));
+    REQUIRE(slow->get_readiness_stats().consecutive_timeouts == 0);
+    REQUIRE(!run_transaction(false));
+    REQUIRE(slow->get_readiness_stats().consecutive_timeouts == 1);
+}
+
+TEST_CASE("Transactions wait for slow objects if there is nothing else")
+{
+    setup_wayfire_debugging_state();
+    wf::wl_timer<false>::callback_t tx_timeout_callback;
+    wf::txn::transaction_t::timer_setter_t timer_setter =
+        [&] (uint64_t, wf::wl_timer<false>::callback_t cb)
+    {
+        tx_timeout_callback = cb;
+    };
+
+    auto slow = std::make_shared<txn_test_object_t>(false);
+    for (int i = 0; i < 3; i++)
+    {
+        int applied = 0;
+        wf::signal::connection_t<wf::txn::transaction_applied_signal> on_apply =
+            [&] (wf::txn::transaction_applied_signal *ev) { ++applied; };
+
+        wf::txn::transaction_t tx(100, timer_setter);
+        tx.set_slow_object_threshold(1);
+        tx.connect(&on_apply);
+        tx.add_object(slow);
+        tx.commit();
+        REQUIRE(applied == 0);
+
+        tx_timeout_callback();
+        REQUIRE(applied == 1);
+    }
+
+    REQUIRE(slow->get_readiness_stats().timeouts == 3);
+    REQUIRE(slow->get_readiness_stats().skipped == 0);
+}